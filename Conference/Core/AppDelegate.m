@@ -47,12 +47,16 @@
     NuInit();
     [[Nu sharedParser] parseEval:@"(macro render (path *body) `((RadRequestRouter sharedRouter) addHandler:(RadRequestHandler handlerWithPath:,path block:(quote (progn ,@*body)))))"];
     NSString *filepath = [[NSBundle mainBundle] pathForResource:@"routes" ofType:@"nu"];
+    NSString *imagepath = [[NSBundle mainBundle] pathForResource:@"routes" ofType:@"nuimage"];
     @try {
         NSString *routes =
         [NSString stringWithContentsOfFile:filepath
                                   encoding:NSUTF8StringEncoding
                                      error:NULL];
-        [[Nu sharedParser] parseEval:routes];
+        // routes.nuimage is optional; without it (or if it is stale) routes.nu is parsed
+        NSData *image = imagepath ? [NSData dataWithContentsOfFile:imagepath options:NSDataReadingMappedIfSafe error:NULL] : nil;
+        NuParser *parser = [Nu sharedParser];
+        [parser eval:[parser parseImage:image source:routes asIfFromFilename:"routes.nu"]];
     }
     @catch (NSException *exception) {
         NSLog(@"Fatal: exception in renderer installation %@", [exception description]);
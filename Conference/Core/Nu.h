@@ -70,6 +70,8 @@
 + (NuSymbolTable *) sharedSymbolTable;
 /*! Get a symbol with the specified string. */
 - (NuSymbol *) symbolWithString:(NSString *)string;
+/*! Get a symbol with the specified name, given as UTF-8 bytes that needn't be null-terminated. */
+- (NuSymbol *) symbolWithUTF8String:(const char *)name length:(NSUInteger)length;
 /*! Lookup a symbol in a symbol table. */
 - (NuSymbol *) lookup:(NSString *) string;
 /*! Get an array containing all of the symbols in a symbol table. */
@@ -198,6 +200,13 @@
 - (id) parse:(NSString *)string;
 /*! Call -parse: while specifying the name of the source file for the string to be parsed. */
 - (id) parse:(NSString *)string asIfFromFilename:(const char *) filename;
+/*! Parse Nu source and return a binary image of the resulting expression.
+ Images can be made ahead of time (see the <b>-image</b> option of nush) and read with -parseImage:source:asIfFromFilename:.
+ Returns nil if the source is incomplete. */
+- (NSData *) imageWithString:(NSString *)string asIfFromFilename:(const char *) filename;
+/*! Read an expression from an image made by -imageWithString:asIfFromFilename:.
+ If the image is missing or damaged, or was made from different source, the source is parsed instead. */
+- (id) parseImage:(NSData *)image source:(NSString *)string asIfFromFilename:(const char *) filename;
 /*! Evaluate a parsed Nu expression in the parser's evaluation context. */
 - (id) eval: (id) code;
 /*! Parse Nu source text and evaluate it in the parser's evalation context. */
@@ -270,6 +279,11 @@
 - (id) evalWithArguments:(id)cdr context:(NSMutableDictionary *)calling_context self:(id)object;
 /*! Get a string representation of the block. */
 - (NSString *) stringValue;
+/*! Set whether blocks are compiled to bytecode after they have been called more than once.
+ Compilation is off by default. Blocks that have already been compiled keep their bytecode. */
++ (void) setCompilesToBytecode:(BOOL) flag;
+/*! Get whether blocks are compiled to bytecode. */
++ (BOOL) compilesToBytecode;
 
 @end
 
@@ -319,6 +333,11 @@
 - (id) body:(NuCell *) oldBody withGensymPrefix:(NSString *) prefix symbolTable:(NuSymbolTable *) symbolTable;
 /*! Expand unquotes in macro body. */
 - (id) expandUnquotes:(id) oldBody withContext:(NSMutableDictionary *) context;
+/*! Turn caching of macro expansions at their call sites on or off. Off by default.
+ Only macros whose expansions depend on nothing but the code at the call site are cached. */
++ (void) setCachesExpansions:(BOOL) flag;
+/*! Test whether macro expansions are cached at their call sites. */
++ (BOOL) cachesExpansions;
 
 @end
 
@@ -1160,6 +1179,28 @@
 @interface NuProfiler : NSObject
 
 + (NuProfiler *) defaultProfiler;
+/*! Start timing a named section. Sections can be nested. */
+- (void) start:(NSString *) name;
+/*! Stop timing the innermost section. */
+- (void) stop;
+/*! Get the total time and count of each section that has been timed. */
+- (NSMutableDictionary *) sections;
+/*! Discard everything that has been recorded. */
+- (void) reset;
+/*! Time every call of a block, operator or macro made on the current thread. */
+- (void) startTracing;
+/*! Stop timing calls. */
+- (void) stopTracing;
+/*! Record the names on the current thread's evaluation stack at a regular interval. */
+- (void) startSamplingWithInterval:(double) seconds;
+/*! Stop sampling. */
+- (void) stopSampling;
+/*! Get the timed call tree as collapsed stacks for flame graph tools, weighted in microseconds of exclusive time. */
+- (NSString *) collapsedStacks;
+/*! Get the sampled evaluation stacks as collapsed stacks, weighted by sample count. */
+- (NSString *) sampledStacks;
+/*! Get a JSON summary of the calls, sections and samples that have been recorded. */
+- (NSString *) JSONSummary;
 
 @end
 
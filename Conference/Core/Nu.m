@@ -29,10 +29,13 @@
 #import <mach/mach.h>
 #import <mach/mach_time.h>
 #import <math.h>
+#import <pthread.h>
+#import <signal.h>
 #import <stdio.h>
 #import <stdlib.h>
 #import <string.h>
 #import <stdint.h>
+#import <stdatomic.h>
 #import <sys/mman.h>
 #import <sys/stat.h>
 #import <time.h>
@@ -85,6 +88,99 @@ static id Nu__null = 0;
 // This macro helps us identify non-null values.
 #define IS_NOT_NULL(xyz) ((xyz) && (((id) (xyz)) != Nu__null))
 
+// Each thread keeps a stack of the lists it is evaluating, for error reporting.
+// Entries are pushed and popped by -[NuCell evalWithContext:]. When an exception
+// is thrown, the pops are skipped, so the stack still describes where it was thrown.
+// Code that catches an exception and keeps going must call nu_eval_unwind
+// with the depth it saved before its @try. Entries aren't retained, so every
+// exception that leaves a block or the outermost evaluation is passed through
+// nu_eval_unwind there: Objective-C code that calls into Nu and catches what it
+// throws never sees entries for lists that are gone.
+//
+// When nothing but core control operators lies between a break, continue or return
+// and the loop or block it leaves, it sets the unwinding field instead of throwing
+// (see nu_unwind_signal). Those operators stop evaluating when they see it set,
+// and the loop or block that it's for clears it.
+//
+// A list evaluated in tail position of a block body, through the last expressions
+// of if, unless, cond, case and progn, doesn't call a block that it finds at its head.
+// It evaluates the arguments and leaves the call in the tail fields for the enclosing
+// block to make once it has returned (see nu_run_tail_calls), so recursion in tail
+// position runs in constant stack.
+typedef struct {
+    __unsafe_unretained NuCell **cells;
+    NSUInteger depth;
+    NSUInteger capacity;
+    int unwinding;
+    void *returnValue;              // retained while a return is unwinding
+    NSUInteger blockMark;           // one more than the depth of the innermost block body, or 0
+    BOOL tailPosition;              // set just before evaluating a list in tail position
+    void *tailBlock;                // retained, with its arguments, until it's called
+    void *tailExpressions;          // the unevaluated arguments, for *args
+    void *tailArguments;            // the evaluated arguments
+} NuEvalStack;
+
+enum {
+    NuUnwindNone,
+    NuUnwindBreak,
+    NuUnwindContinue,
+    NuUnwindReturn
+};
+
+static __thread NuEvalStack nu_eval_stack;
+
+static pthread_key_t nu_eval_stack_key;
+static pthread_once_t nu_eval_stack_key_once = PTHREAD_ONCE_INIT;
+
+// Free a thread's evaluation stack when the thread exits.
+static void nu_eval_stack_free(void *cells)
+{
+    free(cells);
+    nu_eval_stack.cells = NULL;
+    nu_eval_stack.depth = nu_eval_stack.capacity = 0;
+}
+
+static void nu_eval_stack_make_key(void)
+{
+    pthread_key_create(&nu_eval_stack_key, nu_eval_stack_free);
+}
+
+static void nu_eval_stack_grow(void)
+{
+    NSUInteger depth = nu_eval_stack.depth;
+    nu_eval_stack.capacity = depth ? 2 * depth : 256;
+    nu_eval_stack.cells = (__unsafe_unretained NuCell **)
+    realloc(nu_eval_stack.cells, nu_eval_stack.capacity * sizeof(NuCell *));
+    pthread_once(&nu_eval_stack_key_once, nu_eval_stack_make_key);
+    pthread_setspecific(nu_eval_stack_key, nu_eval_stack.cells);
+}
+
+static inline NSUInteger nu_eval_depth(void)
+{
+    return nu_eval_stack.depth;
+}
+
+// Evaluate an expression, telling it whether its value is what the enclosing block returns.
+static inline id nu_eval_tail(id expression, NSMutableDictionary *context, BOOL tail)
+{
+    if (tail && nu_objectIsKindOfClass(expression, [NuCell class]))
+        nu_eval_stack.tailPosition = YES;
+    return [expression evalWithContext:context];
+}
+
+static BOOL nu_operator_passes_tail(id operator);
+
+static id nu_eval_unwind(id exception, NSUInteger depth);
+static NuCell *nu_eval_current_expression(void);
+static id nu_unwind_take_return_value(void);
+
+// Set while a NuProfiler is timing calls or sampling the evaluation stack.
+static BOOL nu_profile_tracing = NO;
+static volatile sig_atomic_t nu_profile_sample_due = 0;
+static void nu_profile_take_sample(void);
+static BOOL nu_profile_enter(id head, id function, NSUInteger depth);
+static void nu_profile_exit(NSUInteger depth);
+
 // This simple object wrapper allows us to store weak references
 // in NSDictionaries with no worry about retain cycles.
 @interface NuWeakReference : NSObject
@@ -105,6 +201,64 @@ static BOOL nu_valueIsTrue(id value)
     return result;
 }
 
+// Arithmetic results that are small integers are shared instead of allocated.
+#define NU_NUMBER_CACHE_MIN -128
+#define NU_NUMBER_CACHE_MAX 1024
+
+static NSNumber *nu_number_cache[NU_NUMBER_CACHE_MAX - NU_NUMBER_CACHE_MIN + 1];
+
+static void nu_init_number_cache(void)
+{
+    for (long i = NU_NUMBER_CACHE_MIN; i <= NU_NUMBER_CACHE_MAX; i++)
+        nu_number_cache[i - NU_NUMBER_CACHE_MIN] = [NSNumber numberWithDouble:(double) i];
+}
+
+// Box the result of an arithmetic operation.
+static inline id nu_number(double d)
+{
+    if ((d >= NU_NUMBER_CACHE_MIN) && (d <= NU_NUMBER_CACHE_MAX)) {
+        long i = (long) d;
+        // -0.0 prints differently, so it isn't shared with 0
+        if (((double) i == d) && !((i == 0) && signbit(d))) {
+            NSNumber *number = nu_number_cache[i - NU_NUMBER_CACHE_MIN];
+            if (number)
+                return number;
+        }
+    }
+    return [NSNumber numberWithDouble:d];
+}
+
+// Well-known symbols, looked up once when the builtins are loaded.
+static NuSymbol *nu_t_symbol, *nu_class_symbol, *nu_method_symbol;
+static NuSymbol *nu_else_symbol, *nu_break_symbol, *nu_continue_symbol;
+static NuSymbol *nu_catch_symbol, *nu_finally_symbol;
+static NuSymbol *nu_self_symbol, *nu_super_symbol, *nu_args_symbol, *nu_margs_symbol;
+static NuSymbol *nu_quote_symbol, *nu_unquote_symbol;
+static NuSymbol *nu_set_symbol, *nu_local_symbol, *nu_do_symbol, *nu_function_symbol, *nu_macro_symbol;
+
+static void nu_init_well_known_symbols(NuSymbolTable *symbolTable)
+{
+    nu_t_symbol = [symbolTable symbolWithString:@"t"];
+    nu_class_symbol = [symbolTable symbolWithString:@"_class"];
+    nu_method_symbol = [symbolTable symbolWithString:@"_method"];
+    nu_else_symbol = [symbolTable symbolWithString:@"else"];
+    nu_break_symbol = [symbolTable symbolWithString:@"break"];
+    nu_continue_symbol = [symbolTable symbolWithString:@"continue"];
+    nu_catch_symbol = [symbolTable symbolWithString:@"catch"];
+    nu_finally_symbol = [symbolTable symbolWithString:@"finally"];
+    nu_self_symbol = [symbolTable symbolWithString:@"self"];
+    nu_super_symbol = [symbolTable symbolWithString:@"super"];
+    nu_args_symbol = [symbolTable symbolWithString:@"*args"];
+    nu_margs_symbol = [symbolTable symbolWithString:@"margs"];
+    nu_quote_symbol = [symbolTable symbolWithString:@"quote"];
+    nu_unquote_symbol = [symbolTable symbolWithString:@"unquote"];
+    nu_set_symbol = [symbolTable symbolWithString:@"set"];
+    nu_local_symbol = [symbolTable symbolWithString:@"local"];
+    nu_do_symbol = [symbolTable symbolWithString:@"do"];
+    nu_function_symbol = [symbolTable symbolWithString:@"function"];
+    nu_macro_symbol = [symbolTable symbolWithString:@"macro"];
+}
+
 #pragma mark - ObjC Runtime Additions
 
 static void nu_class_addInstanceVariable_withSignature(Class thisClass, const char *variableName, const char *signature)
@@ -120,8 +274,12 @@ static void nu_class_addInstanceVariable_withSignature(Class thisClass, const ch
     //NSLog(@"adding ivar named %s to %s, result is %d", variableName, class_getName(thisClass), result);
 }
 
+// Incremented whenever Nu changes a method table. Send caches compare against it.
+static NSUInteger nu_class_epoch = 0;
+
 static IMP nu_class_replaceMethod(Class cls, SEL name, IMP imp, const char *types)
 {
+    nu_class_epoch++;
     if (class_addMethod(cls, name, imp, types)) {
         return imp;
     } else {
@@ -508,7 +666,81 @@ static void nu_markEndOfObjCTypeString(char *type, size_t len)
 }
 @end
 
-static NSMutableDictionary *nu_block_table = nil;
+// The blocks of methods defined in Nu, keyed by the IMPs of their handlers.
+// This lets us introspect methods and make nu-to-nu method calls directly.
+// Lookups don't lock or allocate. An entry is published by storing its IMP
+// last, and entries are never removed. When the table fills up it's copied
+// to a bigger one, and the old one is kept, since a lookup could still be reading it.
+typedef struct {
+    _Atomic(void *) imp;
+    void *block;                // retained by the table
+} NuBlockTableEntry;
+
+typedef struct NuBlockTable {
+    NSUInteger capacity;        // a power of two
+    NSUInteger count;
+    struct NuBlockTable *retired;
+    NuBlockTableEntry entries[];
+} NuBlockTable;
+
+#define NU_BLOCK_TABLE_INITIAL_CAPACITY 256
+
+static _Atomic(NuBlockTable *) nu_block_table = NULL;
+static pthread_mutex_t nu_block_table_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static NuBlockTableEntry *nu_block_table_find(NuBlockTable *table, void *imp)
+{
+    NSUInteger mask = table->capacity - 1;
+    // IMPs are aligned, so drop the low bits before mixing.
+    NSUInteger i = (NSUInteger) ((((uintptr_t) imp) >> 4) * 2654435761u) & mask;
+    for (; ; i = (i + 1) & mask) {
+        NuBlockTableEntry *entry = &table->entries[i];
+        void *candidate = atomic_load_explicit(&entry->imp, memory_order_acquire);
+        if (!candidate || (candidate == imp))
+            return entry;
+    }
+}
+
+// Get the block whose method handler is imp, or nil if it isn't the handler of a Nu method.
+static NuBlock *nu_block_for_imp(IMP imp)
+{
+    NuBlockTable *table = atomic_load_explicit(&nu_block_table, memory_order_acquire);
+    if (!table || !imp)
+        return nil;
+    NuBlockTableEntry *entry = nu_block_table_find(table, (void *) imp);
+    return atomic_load_explicit(&entry->imp, memory_order_acquire) ? (__bridge NuBlock *) entry->block : nil;
+}
+
+static void nu_block_table_add(IMP imp, NuBlock *block)
+{
+    pthread_mutex_lock(&nu_block_table_lock);
+    NuBlockTable *table = atomic_load_explicit(&nu_block_table, memory_order_relaxed);
+    if (!table || (2 * (table->count + 1) > table->capacity)) {
+        NSUInteger capacity = table ? 2 * table->capacity : NU_BLOCK_TABLE_INITIAL_CAPACITY;
+        NuBlockTable *bigger = (NuBlockTable *) calloc(1, sizeof(NuBlockTable) + capacity * sizeof(NuBlockTableEntry));
+        bigger->capacity = capacity;
+        bigger->retired = table;
+        for (NSUInteger i = 0; table && (i < table->capacity); i++) {
+            void *entryIMP = atomic_load_explicit(&table->entries[i].imp, memory_order_relaxed);
+            if (entryIMP) {
+                NuBlockTableEntry *copy = nu_block_table_find(bigger, entryIMP);
+                copy->block = table->entries[i].block;
+                atomic_store_explicit(&copy->imp, entryIMP, memory_order_relaxed);
+                bigger->count++;
+            }
+        }
+        atomic_store_explicit(&nu_block_table, bigger, memory_order_release);
+        table = bigger;
+    }
+    // each handler is made for a single block
+    NuBlockTableEntry *entry = nu_block_table_find(table, (void *) imp);
+    if (!atomic_load_explicit(&entry->imp, memory_order_relaxed)) {
+        entry->block = (void *) CFBridgingRetain(block);
+        atomic_store_explicit(&entry->imp, (void *) imp, memory_order_release);
+        table->count++;
+    }
+    pthread_mutex_unlock(&nu_block_table_lock);
+}
 
 @implementation NuMethod
 
@@ -578,12 +810,7 @@ static NSMutableDictionary *nu_block_table = nil;
 
 - (NuBlock *) block
 {
-    IMP imp = method_getImplementation(m);
-    NuBlock *block = nil;
-    if (nu_block_table) {
-        block = [nu_block_table objectForKey:[NSNumber numberWithUnsignedLong:(unsigned long) imp]];
-    }
-    return block;
+    return nu_block_for_imp(method_getImplementation(m));
 }
 
 - (NSComparisonResult) compare:(NuMethod *) anotherMethod
@@ -723,6 +950,16 @@ int NuMain(int argc, const char *argv[])
                         script = [parser parse:[NSString stringWithFormat:@"(load \"%s\")", argv[i]] asIfFromFilename:argv[i]];
                         result = [parser eval:script];
                     }
+                    else if (!strcmp(argv[i], "-image") && (i + 2 < argc)) {
+                        // save the parsed code of a file as an image: -image source.nu image.nuimage
+                        NSString *string = [NSString stringWithContentsOfFile:[NSString stringWithCString:argv[i+1] encoding:NSUTF8StringEncoding] encoding:NSUTF8StringEncoding error:NULL];
+                        NSData *image = string ? [parser imageWithString:string asIfFromFilename:argv[i+1]] : nil;
+                        if (!image || ![image writeToFile:[NSString stringWithCString:argv[i+2] encoding:NSUTF8StringEncoding] atomically:YES]) {
+                            NSLog(@"Error: can't make an image of file named %s", argv[i+1]);
+                        }
+                        i += 2;
+                        didSomething = YES;
+                    }
                     else if (!strcmp(argv[i], "-v")) {
                         printf("Nu %s (%s)\n", NU_VERSION, NU_RELEASE_DATE);
                         didSomething = true;
@@ -772,11 +1009,14 @@ int NuMain(int argc, const char *argv[])
         @catch (NuException* nuException)
         {
             printf("%s\n", [[nuException dump] cStringUsingEncoding:NSUTF8StringEncoding]);
+            // so that scripts run by make or nuke can fail
+            return 1;
         }
         @catch (id exception)
         {
             NSLog(@"Terminating due to uncaught exception (below):");
             NSLog(@"%@: %@", [exception name], [exception reason]);
+            return 1;
         }
         
     }
@@ -808,6 +1048,8 @@ void NuInit()
         // as a convenience, we set a file static variable to nil.
         Nu__null = [NSNull null];
         
+        nu_init_number_cache();
+        
         // add enumeration to collection classes
         [NSArray include: [NuClass classWithClass:[NuEnumerable class]]];
         [NSSet include: [NuClass classWithClass:[NuEnumerable class]]];
@@ -880,7 +1122,7 @@ id _nusymbol_with_length(const unsigned char *string, int length)
 
 id _nunumberd(double d)
 {
-    return [NSNumber numberWithDouble:d];
+    return nu_number(d);
 }
 
 id _nucell(id car, id cdr)
@@ -964,6 +1206,7 @@ id _nulist(id firstObject, ...)
             if ([bundleIdentifier isEqual:@"nu.programming.framework"]) {
                 // try to read it if it's baked in
                 
+                NSUInteger evalDepth = nu_eval_depth();
                 @try
                 {
                     id baked_function = [NuBridgedFunction functionWithName:[NSString stringWithFormat:@"baked_%@", fileName] signature:@"@"];
@@ -977,6 +1220,7 @@ id _nulist(id firstObject, ...)
                 }
                 @catch (id exception)
                 {
+                    nu_eval_unwind(exception, evalDepth);
                     success = NO;
                 }
             }
@@ -992,14 +1236,178 @@ id _nulist(id firstObject, ...)
 
 #pragma mark - NuBlock
 
+@class NuBytecode;
+
 @interface NuBlock ()
+{
+@public
+    // The compiled body, once the block has been called often enough (see nu_block_eval_body).
+    // It is retained, stored once with release ordering, and read with acquire ordering.
+    _Atomic(void *) bytecode;
+    NSUInteger callCount;
+    // The frame layout shared by every call of the block.
+    // Slot symbols are retained by frameSymbols.
+    __unsafe_unretained id *slotSymbols;
+    NSUInteger slotCount;
+    NSUInteger *parameterSlots;
+    NSUInteger parameterCount;
+    NSUInteger restParameter;
+}
 @property (nonatomic, strong) NuCell *parameters;
 @property (nonatomic, strong) NuCell *body;
 @property (nonatomic, strong) NSMutableDictionary *context;
+// Call the block without making the tail calls it leaves. If argumentValues is given,
+// it holds the arguments already evaluated and cdr is only used for *args.
+- (id) applyToArguments:(id)cdr values:(id)argumentValues context:(NSMutableDictionary *)calling_context;
+// Evaluate the block as a method with arguments that have already been evaluated.
+// Nu-to-nu method calls use this to pass their arguments without making a list of them.
+- (id) evalWithArgumentValues:(__unsafe_unretained id *)args count:(NSUInteger)argc self:(id)object;
+@property (nonatomic, strong) NSArray *frameSymbols;
+@end
+
+// Slots present in every frame, in this order.
+enum {
+    NuFrameArgsSlot,
+    NuFrameSelfSlot,
+    NuFrameSuperSlot,
+    NuFrameFixedSlotCount
+};
+
+/*!
+ @class NuFrame
+ @abstract Internal class for the evaluation context of one block call.
+ @discussion Operators see a frame as an ordinary mutable dictionary. Names
+ that the block binds are resolved to slots when the block is created, so
+ binding and finding them is a pointer scan over a small C array. Other
+ names go to an overflow dictionary that is created on first use. Lookups
+ that miss fall through to the block's own context, which a frame
+ presents as if it had been copied into it; names removed from the frame
+ are remembered so that they don't reappear from there.
+ Frames made with the NSMutableDictionary initializers have no block.
+ */
+@interface NuFrame : NSMutableDictionary
+{
+@public
+    NuBlock *block;
+    NSMutableDictionary *base;
+    __strong id *values;
+    NSUInteger slotCount;
+    __unsafe_unretained id *slotSymbols;    // retained by the block
+    NSMutableDictionary *overflow;
+    NSMutableSet *removed;                  // keys of base that have been removed
+}
+- (id) initWithBlock:(NuBlock *) b;
 @end
 
+static NSUInteger frameSlotForSymbol(NSMutableArray *symbols, id symbol)
+{
+    NSUInteger index = [symbols indexOfObjectIdenticalTo:symbol];
+    if (index == NSNotFound) {
+        index = [symbols count];
+        [symbols addObject:symbol];
+    }
+    return index;
+}
+
+// Collect the names bound by set and local in the body of a block.
+// Nested blocks and macros get frames of their own, so we don't look inside them.
+static void collectFrameLocals(id list, NSMutableArray *symbols)
+{
+    while (list && (list != Nu__null) && nu_objectIsKindOfClass(list, [NuCell class])) {
+        id item = [list car];
+        if (nu_objectIsKindOfClass(item, [NuCell class])) {
+            id head = [item car];
+            if ((head != nu_do_symbol) && (head != nu_function_symbol) && (head != nu_macro_symbol)) {
+                if ((head == nu_set_symbol) || (head == nu_local_symbol)) {
+                    id target = [[item cdr] car];
+                    if (nu_objectIsKindOfClass(target, [NuSymbol class])) {
+                        unichar c = [[target stringValue] characterAtIndex:0];
+                        if ((c != '$') && (c != '@'))
+                            frameSlotForSymbol(symbols, target);
+                    }
+                }
+                collectFrameLocals(item, symbols);
+            }
+        }
+        list = [list cdr];
+    }
+}
+
+static BOOL nu_blocks_compile = NO;
+
+// Blocks are compiled on their second call, so the ones that let makes for a single use are not.
+#define NU_BLOCK_COMPILE_THRESHOLD 2
+
+static NuBytecode *nu_compile_block(NuBlock *block);
+static id nu_bytecode_run(NuBytecode *bytecode, NuFrame *frame);
+
+// Evaluate the body of a block in a frame (implicit progn).
+static id nu_block_eval_body(NuBlock *block, NuFrame *frame)
+{
+    if (nu_blocks_compile && (block->callCount < NU_BLOCK_COMPILE_THRESHOLD)) {
+        @synchronized(block) {
+            if (++block->callCount == NU_BLOCK_COMPILE_THRESHOLD)
+                atomic_store_explicit(&block->bytecode, (void *) CFBridgingRetain(nu_compile_block(block)), memory_order_release);
+        }
+    }
+    // pairs with the store above, so a thread that sees the bytecode also sees it filled in
+    NuBytecode *bytecode = (__bridge NuBytecode *) atomic_load_explicit(&block->bytecode, memory_order_acquire);
+    if (bytecode)
+        return nu_bytecode_run(bytecode, frame);
+    id value = Nu__null;
+    id cursor = block.body;
+    while (cursor && (cursor != Nu__null)) {
+        id next = [cursor cdr];
+        value = nu_eval_tail([cursor car], frame, !IS_NOT_NULL(next));
+        // a return leaves the rest of the body
+        if (nu_eval_stack.unwinding)
+            break;
+        cursor = next;
+    }
+    return value;
+}
+
+// Make the block calls left from tail position, each after the last has returned.
+// Their values are the value of caller. A return-from aimed at caller, or at any
+// block that has been called from tail position since, can no longer be caught by
+// that block, so it is caught here.
+static id nu_run_tail_calls(NuBlock *caller, id value)
+{
+    if (!nu_eval_stack.tailBlock)
+        return value;
+    NSHashTable *returned = [NSHashTable hashTableWithOptions:NSPointerFunctionsObjectPointerPersonality];
+    [returned addObject:caller];
+    @try
+    {
+        while (nu_eval_stack.tailBlock) {
+            NuBlock *block = CFBridgingRelease(nu_eval_stack.tailBlock);
+            id expressions = CFBridgingRelease(nu_eval_stack.tailExpressions);
+            id arguments = CFBridgingRelease(nu_eval_stack.tailArguments);
+            nu_eval_stack.tailBlock = nu_eval_stack.tailExpressions = nu_eval_stack.tailArguments = NULL;
+            [returned addObject:block];
+            value = [block applyToArguments:expressions values:arguments context:nil];
+        }
+    }
+    @catch (NuReturnException *exception) {
+        if (![returned containsObject:[exception blockForReturn]])
+            @throw(exception);
+        value = [exception value];
+    }
+    return value;
+}
+
 @implementation NuBlock
 
++ (void) setCompilesToBytecode:(BOOL) flag
+{
+    nu_blocks_compile = flag;
+}
+
++ (BOOL) compilesToBytecode
+{
+    return nu_blocks_compile;
+}
+
 - (id) initWithParameters:(NuCell *)p body:(NuCell *)b context:(NSMutableDictionary *)c
 {
     if ((self = [super init])) {
@@ -1009,8 +1417,29 @@ id _nulist(id firstObject, ...)
         [self.context setPossiblyNullObject:c forKey:PARENT_KEY];
         [self.context setPossiblyNullObject:[c objectForKey:SYMBOLS_KEY] forKey:SYMBOLS_KEY];
         
-        // Check for the presence of "*args" in parameter list
+        // Lay out the frame used by calls of this block
+        NSMutableArray *symbols = [NSMutableArray arrayWithObjects:nu_args_symbol, nu_self_symbol, nu_super_symbol, nil];
+        parameterCount = [self.parameters length];
+        parameterSlots = (NSUInteger *) malloc(sizeof(NSUInteger) * (parameterCount + 1));
+        restParameter = NSNotFound;
+        NSUInteger i = 0;
         id plist = self.parameters;
+        while (plist && (plist != Nu__null)) {
+            id parameter = [plist car];
+            parameterSlots[i] = frameSlotForSymbol(symbols, parameter);
+            if ((restParameter == NSNotFound) && ([[parameter stringValue] characterAtIndex:0] == '*'))
+                restParameter = i;
+            i++;
+            plist = [plist cdr];
+        }
+        collectFrameLocals(self.body, symbols);
+        self.frameSymbols = symbols;
+        slotCount = [symbols count];
+        slotSymbols = (__unsafe_unretained id *) malloc(sizeof(id) * slotCount);
+        [symbols getObjects:slotSymbols range:NSMakeRange(0, slotCount)];
+        
+        // Check for the presence of "*args" in parameter list
+        plist = self.parameters;
         
         if (!(   ([self.parameters length] == 1)
               && ([[[self.parameters car] stringValue] isEqualToString:@"*args"])))
@@ -1032,20 +1461,33 @@ id _nulist(id firstObject, ...)
     return self;
 }
 
+- (void) dealloc
+{
+    void *compiled = atomic_load_explicit(&bytecode, memory_order_relaxed);
+    if (compiled)
+        CFRelease(compiled);
+    free(slotSymbols);
+    free(parameterSlots);
+}
+
 - (NSString *) stringValue
 {
     return [NSString stringWithFormat:@"(do %@ %@)", [self.parameters stringValue], [self.body stringValue]];
 }
 
 - (id) callWithArguments:(id)cdr context:(NSMutableDictionary *)calling_context
+{
+    return nu_run_tail_calls(self, [self applyToArguments:cdr values:nil context:calling_context]);
+}
+
+- (id) applyToArguments:(id)cdr values:(id)argumentValues context:(NSMutableDictionary *)calling_context
 {
     NSUInteger numberOfArguments = [cdr length];
-    NSUInteger numberOfParameters = [self.parameters length];
+    NSUInteger numberOfParameters = parameterCount;
     
     if (numberOfArguments != numberOfParameters) {
         // is the last parameter a variable argument? if so, it's ok, and we allow it to have zero elements.
-        id lastParameter = [self.parameters lastObject];
-        if (lastParameter && ([[lastParameter stringValue] characterAtIndex:0] == '*')) {
+        if (numberOfParameters && (restParameter == numberOfParameters - 1)) {
             if (numberOfArguments < (numberOfParameters - 1)) {
                 [NSException raise:@"NuIncorrectNumberOfArguments"
                             format:@"Incorrect number of arguments to block. Received %ld but expected %ld or more: %@",
@@ -1063,33 +1505,33 @@ id _nulist(id firstObject, ...)
         }
     }
     //NSLog(@"block eval %@", [cdr stringValue]);
-    // loop over the parameters, looking up their values in the calling_context and copying them into the evaluation_context
-    id plist = self.parameters;
-    id vlist = cdr;
-    id evaluation_context = [self.context mutableCopy];
+    // loop over the parameters, evaluating their values in the calling_context and storing them in the frame
+    id vlist = argumentValues ? argumentValues : cdr;
+    if (argumentValues)
+        calling_context = nil;
+    NuFrame *evaluation_context = [[NuFrame alloc] initWithBlock:self];
+    __strong id *values = evaluation_context->values;
     
 	// Insert the implicit variable "*args".  It contains the entire parameter list.
-	NuSymbolTable *symbolTable = [evaluation_context objectForKey:SYMBOLS_KEY];
-	[evaluation_context setPossiblyNullObject:cdr forKey:[symbolTable symbolWithString:@"*args"]];
+    values[NuFrameArgsSlot] = cdr ? cdr : Nu__null;
     
-    while (plist && (plist != Nu__null)) {
-        id parameter = [plist car];
-        if ([[parameter stringValue] characterAtIndex:0] == '*') {
+    for (NSUInteger i = 0; i < numberOfParameters; i++) {
+        if (i == restParameter) {
             id varargs = [[NuCell alloc] init];
             id cursor = varargs;
             while (vlist != Nu__null) {
-                [cursor setCdr:[[NuCell alloc] init]];
-                cursor = [cursor cdr];
                 id value = [vlist car];
                 if (calling_context && (calling_context != Nu__null))
                     value = [value evalWithContext:calling_context];
-                [cursor setCar:value];
+                NuCell *next = [[NuCell alloc] initWithCar:value cdr:Nu__null];
+                [cursor setCdr:next];
+                cursor = next;
                 vlist = [vlist cdr];
             }
-            [evaluation_context setPossiblyNullObject:[varargs cdr] forKey:parameter];
-            plist = [plist cdr];
+            id rest = [varargs cdr];
+            values[parameterSlots[i]] = rest ? rest : Nu__null;
             // this must be the last element in the parameter list
-            if (plist != Nu__null) {
+            if (i != numberOfParameters - 1) {
                 [NSException raise:@"NuBadParameterList"
                             format:@"Variable argument list must be the last parameter in the parameter list: %@",
                  [self.parameters stringValue]];
@@ -1100,30 +1542,35 @@ id _nulist(id firstObject, ...)
             if (calling_context && (calling_context != Nu__null))
                 value = [value evalWithContext:calling_context];
             //NSLog(@"setting %@ = %@", parameter, value);
-            [evaluation_context setPossiblyNullObject:value forKey:parameter];
-            plist = [plist cdr];
+            values[parameterSlots[i]] = value ? value : Nu__null;
             vlist = [vlist cdr];
         }
     }
     // evaluate the body of the block with the saved context (implicit progn)
     id value = Nu__null;
-    id cursor = self.body;
+    NSUInteger evalDepth = nu_eval_depth();
+    NSUInteger blockMark = nu_eval_stack.blockMark;
+    nu_eval_stack.blockMark = evalDepth + 1;
     @try
     {
-        while (cursor && (cursor != Nu__null)) {
-            value = [[cursor car] evalWithContext:evaluation_context];
-            cursor = [cursor cdr];
-        }
+        value = nu_block_eval_body(self, evaluation_context);
     }
     @catch (NuReturnException *exception) {
+        nu_eval_unwind(exception, evalDepth);
+        nu_eval_stack.blockMark = blockMark;
         value = [exception value];
 		if ([exception blockForReturn] && ([exception blockForReturn] != self)) {
 			@throw(exception);
 		}
     }
     @catch (id exception) {
-        @throw(exception);
+        nu_eval_stack.blockMark = blockMark;
+        @throw nu_eval_unwind(exception, evalDepth);
     }
+    nu_eval_stack.blockMark = blockMark;
+    // only a return unwinds as far as a block
+    if (nu_eval_stack.unwinding)
+        value = nu_unwind_take_return_value();
     return value;
 }
 
@@ -1143,10 +1590,10 @@ static id getObjectFromContext(id context, id symbol)
     return nil;
 }
 
-- (id) evalWithArguments:(id)cdr context:(NSMutableDictionary *)calling_context self:(id)object
+// Make the frame for a call of the block as a method of object.
+- (NuFrame *) methodFrameWithArgumentCount:(NSUInteger)numberOfArguments self:(id)object
 {
-    NSUInteger numberOfArguments = [cdr length];
-    NSUInteger numberOfParameters = [self.parameters length];
+    NSUInteger numberOfParameters = parameterCount;
     if (numberOfArguments != numberOfParameters) {
         [NSException raise:@"NuIncorrectNumberOfArguments"
                     format:@"Incorrect number of arguments to method. Received %ld but expected %ld, %@",
@@ -1154,49 +1601,230 @@ static id getObjectFromContext(id context, id symbol)
          (unsigned long) numberOfParameters,
          [self.parameters stringValue]];
     }
-    //    NSLog(@"block eval %@", [cdr stringValue]);
-    // loop over the arguments, looking up their values in the calling_context and copying them into the evaluation_context
-    id plist = self.parameters;
-    id vlist = cdr;
-    id evaluation_context = [self.context mutableCopy];
-    //    NSLog(@"after copying, evaluation context %@ retain count %d", evaluation_context, [evaluation_context retainCount]);
+    NuFrame *evaluation_context = [[NuFrame alloc] initWithBlock:self];
+    __strong id *values = evaluation_context->values;
     if (object) {
-        NuSymbolTable *symbolTable = [evaluation_context objectForKey:SYMBOLS_KEY];
         // look up one level for the _class value, but allow for it to be higher (in the perverse case of nested method declarations).
-        NuClass *c = getObjectFromContext([self.context objectForKey:PARENT_KEY], [symbolTable symbolWithString:@"_class"]);
-        [evaluation_context setPossiblyNullObject:object forKey:[symbolTable symbolWithString:@"self"]];
-        [evaluation_context setPossiblyNullObject:[NuSuper superWithObject:object ofClass:[c wrappedClass]] forKey:[symbolTable symbolWithString:@"super"]];
-    }
-    while (plist && (plist != Nu__null) && vlist && (vlist != Nu__null)) {
-        id arg = [plist car];
-        // since this message is sent by a method handler (which has already evaluated the block arguments),
-        // we don't evaluate them here; instead we just copy them
-        id value = [vlist car];
-        //        NSLog(@"setting %@ = %@", arg, value);
-        [evaluation_context setPossiblyNullObject:value forKey:arg];
-        plist = [plist cdr];
-        vlist = [vlist cdr];
+        NuClass *c = getObjectFromContext([self.context objectForKey:PARENT_KEY], nu_class_symbol);
+        values[NuFrameSelfSlot] = object;
+        values[NuFrameSuperSlot] = [NuSuper superWithObject:object ofClass:[c wrappedClass]];
+        if (!values[NuFrameSuperSlot])
+            values[NuFrameSuperSlot] = Nu__null;
     }
+    return evaluation_context;
+}
+
+// Evaluate the body of the block as a method, once its arguments are in the frame.
+- (id) evalMethodInFrame:(NuFrame *)evaluation_context
+{
     // evaluate the body of the block with the saved context (implicit progn)
     id value = Nu__null;
-    id cursor = self.body;
+    NSUInteger evalDepth = nu_eval_depth();
+    NSUInteger blockMark = nu_eval_stack.blockMark;
+    nu_eval_stack.blockMark = evalDepth + 1;
     @try
     {
-        while (cursor && (cursor != Nu__null)) {
-            value = [[cursor car] evalWithContext:evaluation_context];
-            cursor = [cursor cdr];
-        }
+        value = nu_block_eval_body(self, evaluation_context);
     }
     @catch (NuReturnException *exception) {
+        nu_eval_unwind(exception, evalDepth);
+        nu_eval_stack.blockMark = blockMark;
         value = [exception value];
 		if ([exception blockForReturn] && ([exception blockForReturn] != self)) {
 			@throw(exception);
 		}
     }
     @catch (id exception) {
-        @throw(exception);
+        nu_eval_stack.blockMark = blockMark;
+        @throw nu_eval_unwind(exception, evalDepth);
     }
-    return value;
+    nu_eval_stack.blockMark = blockMark;
+    // only a return unwinds as far as a block
+    if (nu_eval_stack.unwinding)
+        value = nu_unwind_take_return_value();
+    return nu_run_tail_calls(self, value);
+}
+
+- (id) evalWithArguments:(id)cdr context:(NSMutableDictionary *)calling_context self:(id)object
+{
+    //    NSLog(@"block eval %@", [cdr stringValue]);
+    NuFrame *evaluation_context = [self methodFrameWithArgumentCount:[cdr length] self:object];
+    __strong id *values = evaluation_context->values;
+    // loop over the arguments, storing their values in the frame
+    id vlist = cdr;
+    for (NSUInteger i = 0; (i < parameterCount) && vlist && (vlist != Nu__null); i++) {
+        // since this message is sent by a method handler (which has already evaluated the block arguments),
+        // we don't evaluate them here; instead we just copy them
+        id value = [vlist car];
+        values[parameterSlots[i]] = value ? value : Nu__null;
+        vlist = [vlist cdr];
+    }
+    return [self evalMethodInFrame:evaluation_context];
+}
+
+- (id) evalWithArgumentValues:(__unsafe_unretained id *)args count:(NSUInteger)argc self:(id)object
+{
+    NuFrame *evaluation_context = [self methodFrameWithArgumentCount:argc self:object];
+    __strong id *values = evaluation_context->values;
+    for (NSUInteger i = 0; i < argc; i++)
+        values[parameterSlots[i]] = args[i] ? args[i] : Nu__null;
+    return [self evalMethodInFrame:evaluation_context];
+}
+
+@end
+
+@implementation NuFrame
+
+- (id) initWithBlock:(NuBlock *) b
+{
+    if ((self = [super init])) {
+        block = b;
+        if (b) {
+            base = [b context];
+            slotCount = b->slotCount;
+            slotSymbols = b->slotSymbols;
+            values = (__strong id *) calloc(slotCount, sizeof(id));
+        }
+    }
+    return self;
+}
+
+- (id) init
+{
+    return [self initWithBlock:nil];
+}
+
+- (id) initWithCapacity:(NSUInteger) capacity
+{
+    return [self initWithBlock:nil];
+}
+
+- (id) initWithObjects:(const id []) objects forKeys:(const id <NSCopying> []) keys count:(NSUInteger) count
+{
+    if ((self = [self initWithBlock:nil])) {
+        for (NSUInteger i = 0; i < count; i++)
+            [self setObject:objects[i] forKey:keys[i]];
+    }
+    return self;
+}
+
+- (void) dealloc
+{
+    for (NSUInteger i = 0; i < slotCount; i++)
+        values[i] = nil;
+    free(values);
+}
+
+static inline NSUInteger frameSlotForKey(NuFrame *frame, id key)
+{
+    __unsafe_unretained id *symbols = frame->slotSymbols;
+    NSUInteger count = frame->slotCount;
+    for (NSUInteger i = 0; i < count; i++)
+        if (symbols[i] == key)
+            return i;
+    return NSNotFound;
+}
+
+// Is the key bound in the frame itself, rather than in its base?
+static inline BOOL frameBindsKey(NuFrame *frame, id key)
+{
+    NSUInteger slot = frameSlotForKey(frame, key);
+    if (slot != NSNotFound)
+        return frame->values[slot] != nil;
+    return [frame->overflow objectForKey:key] != nil;
+}
+
+- (id) objectForKey:(id) key
+{
+    NSUInteger slot = frameSlotForKey(self, key);
+    if ((slot != NSNotFound) && values[slot])
+        return values[slot];
+    id object = [overflow objectForKey:key];
+    if (object)
+        return object;
+    if (removed && [removed containsObject:key])
+        return nil;
+    return [base objectForKey:key];
+}
+
+- (void) setObject:(id) object forKey:(id) key
+{
+    if (!object)
+        [NSException raise:NSInvalidArgumentException format:@"attempt to insert nil value for key %@", key];
+    if (removed)
+        [removed removeObject:key];
+    NSUInteger slot = frameSlotForKey(self, key);
+    if (slot != NSNotFound) {
+        values[slot] = object;
+        return;
+    }
+    if (!overflow)
+        overflow = [[NSMutableDictionary alloc] init];
+    [overflow setObject:object forKey:key];
+}
+
+- (void) removeObjectForKey:(id) key
+{
+    NSUInteger slot = frameSlotForKey(self, key);
+    if (slot != NSNotFound)
+        values[slot] = nil;
+    else
+        [overflow removeObjectForKey:key];
+    // keep the base's value hidden
+    if ([base objectForKey:key]) {
+        if (!removed)
+            removed = [[NSMutableSet alloc] init];
+        [removed addObject:key];
+    }
+}
+
+// Is the key in the base, neither hidden by a binding in the frame nor removed?
+static inline BOOL frameShowsBaseKey(NuFrame *frame, id key)
+{
+    return !frameBindsKey(frame, key) && !(frame->removed && [frame->removed containsObject:key]);
+}
+
+- (NSArray *) frameKeys
+{
+    NSMutableArray *keys = [NSMutableArray array];
+    for (NSUInteger i = 0; i < slotCount; i++)
+        if (values[i])
+            [keys addObject:slotSymbols[i]];
+    for (id key in overflow)
+        [keys addObject:key];
+    for (id key in base)
+        if (frameShowsBaseKey(self, key))
+            [keys addObject:key];
+    return keys;
+}
+
+- (NSUInteger) count
+{
+    NSUInteger count = [overflow count];
+    for (NSUInteger i = 0; i < slotCount; i++)
+        if (values[i])
+            count++;
+    for (id key in base)
+        if (frameShowsBaseKey(self, key))
+            count++;
+    return count;
+}
+
+- (NSEnumerator *) keyEnumerator
+{
+    return [[self frameKeys] objectEnumerator];
+}
+
+- (id) lookupObjectForKey:(id)key
+{
+    id context = self;
+    while (IS_NOT_NULL(context)) {
+        id object = [context objectForKey:key];
+        if (object)
+            return object;
+        context = [context objectForKey:PARENT_KEY];
+    }
+    return nil;
 }
 
 @end
@@ -1884,82 +2512,233 @@ static void raise_argc_exception(SEL s, NSUInteger count, NSUInteger given)
 
 #define TYPE_BUFFER_SIZE 1024
 
-static id nu_calling_objc_method_handler(id target, Method m, NSMutableArray *args)
+// Methods with at most this many arguments, all passed in integer registers,
+// are called through their IMPs without building an NSInvocation.
+#define NU_DIRECT_MAX_ARGUMENTS 4
+// Argument frames up to this size are built on the stack.
+#define NU_STACK_FRAME_SIZE 256
+
+typedef intptr_t NuWord;
+
+// The types that fit in a NuWord. On 32-bit targets, long longs don't.
+#define NU_WORD_TYPES ((sizeof(long long) == sizeof(NuWord)) ? "@#:^*qQlLiIsScCB" : "@#:^*lLiIsScCB")
+
+// The space an argument or return value needs in an argument frame.
+// This is at least what NSInvocation will copy in or out of it.
+static size_t frame_size_of_objc_type(const char *typeString)
 {
-    // this call seems to force the class's +initialize method to be called.
-    [target class];
-    
-    //NSLog(@"calling ObjC method %s with target of class %@", sel_getName(method_getName(m)), [target class]);
-    
-    IMP imp = method_getImplementation(m);
-    
-    // if the imp has an associated block, this is a nu-to-nu call.
-    // skip going through the ObjC runtime and evaluate the block directly.
-    NuBlock *block = nil;
-    if (nu_block_table &&
-        ((block = [nu_block_table objectForKey:[NSNumber numberWithUnsignedLong:(unsigned long)imp]]))) {
-        //NSLog(@"nu calling nu method %s of class %@", sel_getName(method_getName(m)), [target class]);
-        id arguments = [[NuCell alloc] init];
-        id cursor = arguments;
-        NSUInteger argc = [args count];
-        int i;
-        for (i = 0; i < argc; i++) {
-            NuCell *nextCell = [[NuCell alloc] init];
-            [cursor setCdr:nextCell];
-            cursor = [cursor cdr];
-            [cursor setCar:[args objectAtIndex:i]];
-        }
-        id result = [block evalWithArguments:[arguments cdr] context:nil self:target];
-        // ensure that methods declared to return void always return void.
-        char return_type_buffer[TYPE_BUFFER_SIZE];
-        method_getReturnType(m, return_type_buffer, TYPE_BUFFER_SIZE);
-        return (!strcmp(return_type_buffer, "v")) ? (id)[NSNull null] : result;
+    NSUInteger size = 0;
+    NSGetSizeAndAlignment(typeString, &size, NULL);
+    size_t nu_size = size_of_objc_type(typeString);
+    return (size > nu_size) ? size : nu_size;
+}
+
+/*!
+ @class NuMethodInfo
+ @abstract Internal class that holds everything needed to call a method from Nu.
+ @discussion Decoding a method's type encoding, building its NSMethodSignature and
+ checking for a Nu implementation are done once, when the info is created.
+ The info also records whether the method can be called directly through its IMP,
+ and where each argument goes in the argument frame used when it can't.
+ Send caches keep these for the methods they have resolved.
+ */
+@interface NuMethodInfo : NSObject
+{
+@public
+    Method method;
+    SEL selector;
+    IMP imp;
+    NuBlock *block;
+    NSMethodSignature *signature;
+    int argumentCount;
+    char *returnType;
+    char **argumentTypes;
+    BOOL alreadyRetained;
+    BOOL direct;
+    size_t *argumentOffsets;
+    size_t frameSize;
+}
+- (id) initWithMethod:(Method) m;
+@end
+
+@implementation NuMethodInfo
+
+- (id) initWithMethod:(Method) m
+{
+    if ((self = [super init])) {
+        method = m;
+        selector = method_getName(m);
+        imp = method_getImplementation(m);
+        // if the imp has an associated block, calls are nu-to-nu and skip the ObjC runtime.
+        block = nu_block_for_imp(imp);
+        argumentCount = method_getNumberOfArguments(m);
+        returnType = method_copyReturnType(m);
+        argumentTypes = (char **) malloc(argumentCount * sizeof(char *));
+        for (int i = 0; i < argumentCount; i++)
+            argumentTypes[i] = method_copyArgumentType(m, i);
+        if (!block)
+            signature = [NSMethodSignature signatureWithObjCTypes:method_getTypeEncoding(m)];
+        SEL s = selector;
+        alreadyRetained =               // see Anguish/Buck/Yacktman, p. 104
+        (s == @selector(alloc)) || (s == @selector(allocWithZone:))
+        || (s == @selector(copy)) || (s == @selector(copyWithZone:))
+        || (s == @selector(mutableCopy)) || (s == @selector(mutableCopyWithZone:))
+        || (s == @selector(new));
+        
+        // lay out the argument frame: the return value, then each argument, on 16-byte boundaries.
+        argumentOffsets = (size_t *) malloc(argumentCount * sizeof(size_t));
+        frameSize = (frame_size_of_objc_type(returnType) + 15) & ~15;
+        for (int i = 0; i < argumentCount; i++) {
+            argumentOffsets[i] = frameSize;
+            frameSize += (frame_size_of_objc_type(argumentTypes[i]) + 15) & ~15;
+        }
+        
+        // check for a signature we can call directly
+        char returnTypeChar = get_typeChar_from_typeString(returnType);
+        direct = !block && (argumentCount - 2 <= NU_DIRECT_MAX_ARGUMENTS)
+        && (strchr("vdf", returnTypeChar) || strchr(NU_WORD_TYPES, returnTypeChar));
+        for (int i = 2; direct && (i < argumentCount); i++)
+            direct = (strchr(NU_WORD_TYPES, get_typeChar_from_typeString(argumentTypes[i])) != NULL);
+    }
+    return self;
+}
+
+- (void) dealloc
+{
+    free(argumentOffsets);
+    free(returnType);
+    for (int i = 0; i < argumentCount; i++)
+        free(argumentTypes[i]);
+    free(argumentTypes);
+}
+
+@end
+
+#define NU_DIRECT_CALL(RESULT, TYPE) \
+switch (argc) { \
+    case 0: RESULT ((TYPE (*)(id, SEL)) imp)(target, sel); break; \
+    case 1: RESULT ((TYPE (*)(id, SEL, NuWord)) imp)(target, sel, a[0]); break; \
+    case 2: RESULT ((TYPE (*)(id, SEL, NuWord, NuWord)) imp)(target, sel, a[0], a[1]); break; \
+    case 3: RESULT ((TYPE (*)(id, SEL, NuWord, NuWord, NuWord)) imp)(target, sel, a[0], a[1], a[2]); break; \
+    default: RESULT ((TYPE (*)(id, SEL, NuWord, NuWord, NuWord, NuWord)) imp)(target, sel, a[0], a[1], a[2], a[3]); break; \
+}
+
+// Call a method through its IMP. Every argument fits in an integer register,
+// so each one is converted into a word and the IMP is called with a cast
+// that matches its return type.
+static id nu_calling_objc_method_directly(id target, NuMethodInfo *info, __unsafe_unretained id *args, NSUInteger argc)
+{
+    IMP imp = info->imp;
+    SEL sel = info->selector;
+    NuWord a[NU_DIRECT_MAX_ARGUMENTS] = {0};
+    int argument_needs_retained[NU_DIRECT_MAX_ARGUMENTS];
+    for (NSUInteger i = 0; i < argc; i++) {
+        argument_needs_retained[i] = set_objc_value_from_nu_value(&a[i], args[i], info->argumentTypes[i+2], NO);
+    }
+    id result;
+    switch (get_typeChar_from_typeString(info->returnType)) {
+        case 'v':
+        {
+            NU_DIRECT_CALL(, void);
+            result = [NSNull null];
+            break;
+        }
+        case 'd':
+        {
+            double value;
+            NU_DIRECT_CALL(value =, double);
+            result = get_nu_value_from_objc_value(&value, info->returnType, NO);
+            break;
+        }
+        case 'f':
+        {
+            float value;
+            NU_DIRECT_CALL(value =, float);
+            result = get_nu_value_from_objc_value(&value, info->returnType, NO);
+            break;
+        }
+        case 'i': case 'I':
+        {
+            int value;
+            NU_DIRECT_CALL(value =, int);
+            result = get_nu_value_from_objc_value(&value, info->returnType, NO);
+            break;
+        }
+        case 's': case 'S':
+        {
+            short value;
+            NU_DIRECT_CALL(value =, short);
+            result = get_nu_value_from_objc_value(&value, info->returnType, NO);
+            break;
+        }
+        case 'c': case 'C': case 'B':
+        {
+            char value;
+            NU_DIRECT_CALL(value =, char);
+            result = get_nu_value_from_objc_value(&value, info->returnType, NO);
+            break;
+        }
+        default:
+        {
+            NuWord value;
+            NU_DIRECT_CALL(value =, NuWord);
+            result = get_nu_value_from_objc_value(&value, info->returnType, info->alreadyRetained);
+            break;
+        }
+    }
+    for (NSUInteger i = 0; i < argc; i++) {
+        if (argument_needs_retained[i])
+            [args[i] retainReferencedObject];
+    }
+    return result;
+}
+
+// Call a method whose info has already been resolved. The arguments have already been evaluated.
+static id nu_calling_objc_method_info(id target, NuMethodInfo *info, __unsafe_unretained id *args, NSUInteger argc)
+{
+    if (info->block) {
+        //NSLog(@"nu calling nu method %s of class %@", sel_getName(info->selector), [target class]);
+        id result = [info->block evalWithArgumentValues:args count:argc self:target];
+        // ensure that methods declared to return void always return void.
+        return (!strcmp(info->returnType, "v")) ? (id)[NSNull null] : result;
+    }
+    
+    int argument_count = info->argumentCount;
+    if (argc != argument_count-2) {
+        raise_argc_exception(info->selector, argument_count-2, argc);
+        return [NSNull null];
+    }
+    if (info->direct) {
+        return nu_calling_objc_method_directly(target, info, args, argc);
     }
     
     // if we get here, we're going through the ObjC runtime to make the call.
     @autoreleasepool {
         id result = [NSNull null];
-        SEL s = method_getName(m);
-        int argument_count = method_getNumberOfArguments(m);
-        if ([args count] != argument_count-2) {
-            raise_argc_exception(s, argument_count-2, [args count]);
-        } else {
-            char return_type_buffer[TYPE_BUFFER_SIZE], arg_type_buffer[TYPE_BUFFER_SIZE];
-            method_getReturnType(m, return_type_buffer, TYPE_BUFFER_SIZE);
-            void *result_value = value_buffer_for_objc_type(&return_type_buffer[0]);
-            void **argument_values = (void **) malloc (argument_count * sizeof(void *));
-            int *argument_needs_retained = (int *) malloc (argument_count * sizeof(int));
-            for (int i = 0; i < argument_count; i++) {
-                argument_needs_retained[i] = NO;
-            }
-            const char *encoding = method_getTypeEncoding(m);
-            NSMethodSignature *signature = [NSMethodSignature signatureWithObjCTypes:encoding];
-            NSInvocation *invocation = [NSInvocation invocationWithMethodSignature:signature];
+        SEL s = info->selector;
+        {
+            // the return value and arguments share one frame, on the stack when it's small enough.
+            char stack_frame[NU_STACK_FRAME_SIZE];
+            char *frame = (info->frameSize <= NU_STACK_FRAME_SIZE) ? stack_frame : (char *) malloc(info->frameSize);
+            memset(frame, 0, info->frameSize);
+            void *result_value = frame;
+            int argument_needs_retained[argument_count];
+            NSInvocation *invocation = [NSInvocation invocationWithMethodSignature:info->signature];
             [invocation setTarget:target];
-            [invocation setSelector:method_getName(m)];
-            for (int i = 0; i < argument_count; i++) {
-                method_getArgumentType(m, i, &arg_type_buffer[0], TYPE_BUFFER_SIZE);
-                argument_values[i] = value_buffer_for_objc_type(&arg_type_buffer[0]);
-                if (i >= 2) {
-                    argument_needs_retained[i-2] = set_objc_value_from_nu_value(argument_values[i],
-                                                                                [args objectAtIndex:(i-2)],
-                                                                                &arg_type_buffer[0],
-                                                                                NO);
-                    [invocation setArgument:(argument_values[i]) atIndex:i];
-                }
-            }
-            
-            const char *method_name = sel_getName(method_getName(m));
-            BOOL calling_initializer = !strncmp("init", method_name, 4);
-            if (calling_initializer) {
-                // in case an init method releases its target (to return something else), we preemptively retain it
-                //[target retain];
+            [invocation setSelector:s];
+            for (int i = 2; i < argument_count; i++) {
+                void *argument_value = frame + info->argumentOffsets[i];
+                argument_needs_retained[i-2] = set_objc_value_from_nu_value(argument_value,
+                                                                            args[i-2],
+                                                                            info->argumentTypes[i],
+                                                                            NO);
+                [invocation setArgument:argument_value atIndex:i];
             }
             
             // call the method handler
 #ifdef USE_PRIVATE_INVOCATION_API
             // this is the private API way to do it. It is able to send messages to super.
-            [invocation invokeUsingIMP:imp];
+            [invocation invokeUsingIMP:info->imp];
 #else
             // this is the Apple-approved way to do it. It is unable to send messages to super.
             [invocation invoke];
@@ -1969,48 +2748,71 @@ static id nu_calling_objc_method_handler(id target, Method m, NSMutableArray *ar
             // Either they are owned by an existing object or are autoreleased.
             // Exceptions to this rule are handled below.
             // Since these methods create new objects that aren't autoreleased, we autorelease them.
-            BOOL already_retained =               // see Anguish/Buck/Yacktman, p. 104
-            (s == @selector(alloc)) || (s == @selector(allocWithZone:))
-            || (s == @selector(copy)) || (s == @selector(copyWithZone:))
-            || (s == @selector(mutableCopy)) || (s == @selector(mutableCopyWithZone:))
-            || (s == @selector(new));
-            //NSLog(@"already retained? %d", already_retained);
+            //NSLog(@"already retained? %d", info->alreadyRetained);
             
             // extract the return value
-            if (return_type_buffer[0] == 'v') {
+            if (info->returnType[0] == 'v') {
                 result = [NSNull null];
             } else {
                 [invocation getReturnValue:result_value];
-                result = get_nu_value_from_objc_value(result_value, &return_type_buffer[0], already_retained);
+                result = get_nu_value_from_objc_value(result_value, info->returnType, info->alreadyRetained);
             }
             // NSLog(@"result is %@", result);
-
-            if (calling_initializer) {
-                if (result == target) {
-                    // NSLog(@"undoing preemptive retain of init target %@", [target className]);
-                    //              [target release]; // undo our preemptive retain
-                } else {
-                    // NSLog(@"keeping preemptive retain of init target %@", [target className]);
-                }
-            }
             
             for (int i = 0; i < argument_count-2; i++) {
                 if (argument_needs_retained[i])
-                    [[args objectAtIndex:i] retainReferencedObject];
+                    [args[i] retainReferencedObject];
             }
             
-            // free the value structures
-            for (int i = 0; i < argument_count; i++) {
-                free(argument_values[i]);
-            }
-            free(argument_values);
-            free(result_value);
-            free(argument_needs_retained);
+            if (frame != stack_frame)
+                free(frame);
         }
         return result;
     }
 }
 
+static pthread_mutex_t nu_method_infos_lock = PTHREAD_MUTEX_INITIALIZER;
+static NSMapTable *nu_method_infos = nil;
+static NSUInteger nu_method_infos_epoch = 0;
+
+// The NuMethodInfo for a method, made on first use and kept until nu_class_epoch changes.
+static NuMethodInfo *nu_method_info(Method m)
+{
+    pthread_mutex_lock(&nu_method_infos_lock);
+    if (!nu_method_infos)
+        nu_method_infos = [NSMapTable mapTableWithKeyOptions:(NSPointerFunctionsOpaqueMemory | NSPointerFunctionsOpaquePersonality)
+                                                valueOptions:NSPointerFunctionsStrongMemory];
+    else if (nu_method_infos_epoch != nu_class_epoch)
+        [nu_method_infos removeAllObjects];
+    nu_method_infos_epoch = nu_class_epoch;
+    NuMethodInfo *info = (__bridge NuMethodInfo *) NSMapGet(nu_method_infos, m);
+    if (!info) {
+        info = [[NuMethodInfo alloc] initWithMethod:m];
+        NSMapInsert(nu_method_infos, m, (__bridge void *) info);
+    }
+    pthread_mutex_unlock(&nu_method_infos_lock);
+    return info;
+}
+
+static id nu_calling_objc_method_handler(id target, Method m, NSMutableArray *args)
+{
+    // this call seems to force the class's +initialize method to be called.
+    [target class];
+    
+    //NSLog(@"calling ObjC method %s with target of class %@", sel_getName(method_getName(m)), [target class]);
+    
+    NuMethodInfo *info = nu_method_info(m);
+    NSUInteger argc = [args count];
+    __unsafe_unretained id *argv = (__unsafe_unretained id *) malloc((argc + 1) * sizeof(id));
+    [args getObjects:argv range:NSMakeRange(0, argc)];
+    @try {
+        return nu_calling_objc_method_info(target, info, argv, argc);
+    }
+    @finally {
+        free(argv);
+    }
+}
+
 static char **generate_userdata(SEL sel, NuBlock *block, const char *signature)
 {
     NSMethodSignature *methodSignature = [NSMethodSignature signatureWithObjCTypes:signature];
@@ -2073,9 +2875,7 @@ static id nu_add_method_to_class(Class c, NSString *methodName, NSString *signat
     
     // save the block in a hash table keyed by the imp.
     // this will let us introspect methods and optimize nu-to-nu method calls
-    if (!nu_block_table) nu_block_table = [[NSMutableDictionary alloc] init];
-    // watch for problems caused by this ugly cast of an IMP to an unsigned value
-    [nu_block_table setObject:block forKey:[NSNumber numberWithUnsignedLongLong:(unsigned long long) imp]];
+    nu_block_table_add(imp, block);
 
     // insert the method handler in the class method table
     nu_class_replaceMethod(c, selector, imp, signature_str);
@@ -2682,29 +3482,93 @@ static NSString *getTypeStringFromNode(id node)
 @property (nonatomic, strong) id cdr;
 @property (nonatomic, assign) int file;
 @property (nonatomic, assign) int line;
+- (id) initWithCar:(id)car cdr:(id)cdr;
+- (void) setCarWhileParsing:(id)car;
+- (void) setCdrWhileParsing:(id)cdr;
+@end
+
+/*!
+ @class NuCodeCell
+ @abstract Internal class for the cells of parsed code.
+ @discussion The parser builds code from these so that cells made at run time
+ stay small. A message send or macro call keeps what it caches on the cell after
+ its head: a NuSendCache for a message send, or a NuMacroExpansion for a macro
+ call. Changing any code cell increments nu_code_epoch, and caches made under an
+ older epoch are not used. The cache is an atomic property because call sites
+ may be evaluated on several threads at once.
+ */
+@interface NuCodeCell : NuCell
+@property (atomic, strong) id siteCache;
 @end
 
+// Incremented whenever a cell of parsed code is changed. Call site caches compare against it.
+static _Atomic NSUInteger nu_code_epoch = 0;
+
+static inline NSUInteger nu_code_epoch_now(void)
+{
+    return atomic_load_explicit(&nu_code_epoch, memory_order_relaxed);
+}
+
+static inline void nu_code_changed(void)
+{
+    atomic_fetch_add_explicit(&nu_code_epoch, 1, memory_order_relaxed);
+}
+
+// Cells whose changes increment nu_code_epoch: those that the parser and the image reader make.
+static inline BOOL nu_cell_is_code(id cell)
+{
+    Class c = object_getClass(cell);
+    return (c == [NuCodeCell class]) || (c == [NuCellWithComments class]);
+}
+
+// Whether every cell of a list is a code cell, and if deep is set, every cell of the lists it contains.
+static BOOL nu_list_is_code(id list, BOOL deep)
+{
+    for (id cursor = list; cursor && (cursor != Nu__null); cursor = [cursor cdr]) {
+        if (!nu_cell_is_code(cursor))
+            return NO;
+        id car = [cursor car];
+        if (deep && nu_objectIsKindOfClass(car, [NuCell class]) && !nu_list_is_code(car, YES))
+            return NO;
+    }
+    return YES;
+}
+
 @implementation NuCell
 
 + (id) cellWithCar:(id)car cdr:(id)cdr
 {
-    NuCell *cell = [[self alloc] init];
-    [cell setCar:car];
-    [cell setCdr:cdr];
-    return cell;
+    return [[self alloc] initWithCar:car cdr:cdr];
 }
 
 - (id) init
+{
+    return [self initWithCar:Nu__null cdr:Nu__null];
+}
+
+// Set both halves directly, without going through the setters.
+- (id) initWithCar:(id)car cdr:(id)cdr
 {
     if ((self = [super init])) {
-        self.car = Nu__null;
-        self.cdr = Nu__null;
-        self.file = -1;
-        self.line = -1;
+        _car = car;
+        _cdr = cdr;
+        _file = -1;
+        _line = -1;
     }
     return self;
 }
 
+// The parser links cells with these, since nothing can have cached them yet.
+- (void) setCarWhileParsing:(id)car
+{
+    _car = car;
+}
+
+- (void) setCdrWhileParsing:(id)cdr
+{
+    _cdr = cdr;
+}
+
 - (BOOL) atom {return NO;}
 
 // additional accessors, for efficiency
@@ -2874,7 +3738,7 @@ static NSString *getTypeStringFromNode(id node)
 
 - (void) addToException:(NuException*)e value:(id)value
 {
-    const char *parsedFilename = nu_parsedFilename(self.file);
+    const char *parsedFilename = nu_parsedFilename([self file]);
     
     if (parsedFilename) {
         NSString* filename = [NSString stringWithCString:parsedFilename encoding:NSUTF8StringEncoding];
@@ -2885,40 +3749,70 @@ static NSString *getTypeStringFromNode(id node)
     }
 }
 
+// Evaluate the head of a list and call it with the rest.
+static inline id nu_cell_apply(NuCell *cell, NSMutableDictionary *context, NSUInteger depth)
+{
+    if (nu_profile_sample_due)
+        nu_profile_take_sample();
+    BOOL tail = nu_eval_stack.tailPosition;
+    nu_eval_stack.tailPosition = NO;
+    id function = [cell.car evalWithContext:context];
+    // calls in tail position are left to the enclosing block, except while they are being timed
+    if (tail && !nu_profile_tracing) {
+        if (object_getClass(function) == [NuBlock class]) {
+            // the arguments are evaluated here, where a return or an exception in them
+            // is still inside the enclosing block
+            id expressions = cell.cdr ? cell.cdr : Nu__null;
+            NuCell *arguments = nil, *last = nil;
+            for (id cursor = expressions; cursor && (cursor != Nu__null); cursor = [cursor cdr]) {
+                id value = [[cursor car] evalWithContext:context];
+                NuCell *next = [[NuCell alloc] initWithCar:(value ? value : Nu__null) cdr:Nu__null];
+                if (last)
+                    [last setCdr:next];
+                else
+                    arguments = next;
+                last = next;
+            }
+            nu_eval_stack.tailBlock = (void *) CFBridgingRetain(function);
+            nu_eval_stack.tailExpressions = (void *) CFBridgingRetain(expressions);
+            nu_eval_stack.tailArguments = (void *) CFBridgingRetain(arguments ? arguments : Nu__null);
+            return Nu__null;
+        }
+        nu_eval_stack.tailPosition = nu_operator_passes_tail(function);
+    }
+    if (!nu_profile_tracing || !nu_profile_enter(cell.car, function, depth))
+        return [function evalWithArguments:cell.cdr context:context];
+    id result = [function evalWithArguments:cell.cdr context:context];
+    nu_profile_exit(depth);
+    return result;
+}
+
 - (id) evalWithContext:(NSMutableDictionary *)context
 {
-    id value = nil;
-    id result = nil;
+    // push this list on the evaluation stack
+    NSUInteger depth = nu_eval_stack.depth;
+    if (depth == nu_eval_stack.capacity)
+        nu_eval_stack_grow();
+    nu_eval_stack.cells[depth] = self;
+    nu_eval_stack.depth = depth + 1;
     
-    @try
-    {
-        value = [self.car evalWithContext:context];
-        
-        // to improve error reporting, add the currently-evaluating expression to the context
-        [context setObject:self forKey:[[NuSymbolTable sharedSymbolTable] symbolWithString:@"_expression"]];
-        
-        result = [value evalWithArguments:self.cdr context:context];
-        
-    }
-    @catch (NuException* nuException) {
-        [self addToException:nuException value:[self.car stringValue]];
-        @throw nuException;
+    id result;
+    if (depth > 0) {
+        result = nu_cell_apply(self, context, depth);
     }
-    @catch (NSException* e) {
-        if (   nu_objectIsKindOfClass(e, [NuBreakException class])
-            || nu_objectIsKindOfClass(e, [NuContinueException class])
-            || nu_objectIsKindOfClass(e, [NuReturnException class])) {
-            @throw e;
+    else {
+        // Only the outermost evaluation on a thread catches exceptions,
+        // adding the expressions they were thrown from before passing them on.
+        @try
+        {
+            result = nu_cell_apply(self, context, depth);
         }
-        else {
-            NuException* nuException = [[NuException alloc] initWithName:[e name]
-                                                                  reason:[e reason]
-                                                                userInfo:[e userInfo]];
-            [self addToException:nuException value:[self.car stringValue]];
-            @throw nuException;
+        @catch (id exception) {
+            @throw nu_eval_unwind(exception, 0);
         }
     }
     
+    nu_eval_stack.depth = depth;
     return result;
 }
 
@@ -3105,16 +3999,32 @@ static NSString *getTypeStringFromNode(id node)
 - (id) initWithCoder:(NSCoder *)coder
 {
     if ((self = [super init])) {
-        self.car = [coder decodeObject];
-        self.cdr = [coder decodeObject];
+        _car = [coder decodeObject];
+        _cdr = [coder decodeObject];
     }
     return self;
 }
 
 - (void) setFile:(int) f line:(int) l
 {
-    self.file = f;
-    self.line = l;
+    _file = f;
+    _line = l;
+}
+
+@end
+
+@implementation NuCodeCell
+
+- (void) setCar:(id)car
+{
+    [super setCar:car];
+    nu_code_changed();
+}
+
+- (void) setCdr:(id)cdr
+{
+    [super setCdr:cdr];
+    nu_code_changed();
 }
 
 @end
@@ -3123,7 +4033,59 @@ static NSString *getTypeStringFromNode(id node)
 @property (nonatomic, strong) id comments;
 @end
 
+// Add the expressions that were being evaluated when an exception was thrown
+// to the exception, then drop them from the evaluation stack. Exceptions that
+// aren't NuExceptions are wrapped in one. Exceptions used for control flow
+// are returned unchanged.
+static id nu_eval_unwind(id exception, NSUInteger depth)
+{
+    NSUInteger top = nu_eval_stack.depth;
+    nu_eval_stack.depth = depth;
+    if (   nu_objectIsKindOfClass(exception, [NuBreakException class])
+        || nu_objectIsKindOfClass(exception, [NuContinueException class])
+        || nu_objectIsKindOfClass(exception, [NuReturnException class])) {
+        return exception;
+    }
+    NuException *nuException;
+    if (nu_objectIsKindOfClass(exception, [NuException class])) {
+        nuException = exception;
+    }
+    else if (nu_objectIsKindOfClass(exception, [NSException class])) {
+        nuException = [[NuException alloc] initWithName:[exception name]
+                                                 reason:[exception reason]
+                                               userInfo:[exception userInfo]];
+    }
+    else {
+        // other thrown objects are passed through undecorated
+        return exception;
+    }
+    for (NSUInteger i = top; i > depth; i--) {
+        NuCell *cell = nu_eval_stack.cells[i-1];
+        [cell addToException:nuException value:[[cell car] stringValue]];
+    }
+    return nuException;
+}
+
+// The innermost list being evaluated on this thread.
+static NuCell *nu_eval_current_expression(void)
+{
+    return nu_eval_stack.depth ? nu_eval_stack.cells[nu_eval_stack.depth - 1] : nil;
+}
+
 @implementation NuCellWithComments
+
+- (void) setCar:(id)car
+{
+    [super setCar:car];
+    nu_code_changed();
+}
+
+- (void) setCdr:(id)cdr
+{
+    [super setCdr:cdr];
+    nu_code_changed();
+}
+
 @end
 
 
@@ -3142,15 +4104,18 @@ static NSString *getTypeStringFromNode(id node)
         NSEnumerator *enumerator = [self objectEnumerator];
         id object;
         while ((object = [enumerator nextObject])) {
+            NSUInteger evalDepth = nu_eval_depth();
             @try
             {
                 [args setCar:object];
                 [callable evalWithArguments:args context:nil];
             }
             @catch (NuBreakException *exception) {
+                nu_eval_unwind(exception, evalDepth);
                 break;
             }
             @catch (NuContinueException *exception) {
+                nu_eval_unwind(exception, evalDepth);
                 // do nothing, just continue with the next loop iteration
             }
             @catch (id exception) {
@@ -3170,6 +4135,7 @@ static NSString *getTypeStringFromNode(id node)
         id object;
         int i = 0;
         while ((object = [enumerator nextObject])) {
+            NSUInteger evalDepth = nu_eval_depth();
             @try
             {
                 [args setCar:object];
@@ -3177,9 +4143,11 @@ static NSString *getTypeStringFromNode(id node)
                 [block evalWithArguments:args context:nil];
             }
             @catch (NuBreakException *exception) {
+                nu_eval_unwind(exception, evalDepth);
                 break;
             }
             @catch (NuContinueException *exception) {
+                nu_eval_unwind(exception, evalDepth);
                 // do nothing, just continue with the next loop iteration
             }
             @catch (id exception) {
@@ -3600,13 +4568,12 @@ static BOOL NuException_verboseExceptionReporting = NO;
     NSUInteger count = [self count];
     if (count == 0)
         return nil;
-    NuCell *result = [[NuCell alloc] init];
+    NuCell *result = [[NuCell alloc] initWithCar:[self objectAtIndex:0] cdr:Nu__null];
     NuCell *cursor = result;
-    [result setCar:[self objectAtIndex:0]];
     for (int i = 1; i < count; i++) {
-        [cursor setCdr:[[NuCell alloc] init]];
-        cursor = [cursor cdr];
-        [cursor setCar:[self objectAtIndex:i]];
+        NuCell *next = [[NuCell alloc] initWithCar:[self objectAtIndex:i] cdr:Nu__null];
+        [cursor setCdr:next];
+        cursor = next;
     }
     return result;
 }
@@ -3634,15 +4601,18 @@ static BOOL NuException_verboseExceptionReporting = NO;
         NSEnumerator *enumerator = [self reverseObjectEnumerator];
         id object;
         while ((object = [enumerator nextObject])) {
+            NSUInteger evalDepth = nu_eval_depth();
             @try
             {
                 [args setCar:object];
                 [callable evalWithArguments:args context:nil];
             }
             @catch (NuBreakException *exception) {
+                nu_eval_unwind(exception, evalDepth);
                 break;
             }
             @catch (NuContinueException *exception) {
+                nu_eval_unwind(exception, evalDepth);
                 // do nothing, just continue with the next loop iteration
             }
             @catch (id exception) {
@@ -3724,14 +4694,13 @@ static NSComparisonResult sortedArrayUsingBlockHelper(id a, id b, void *context)
     if(!anObject)
         return nil;
     
-    NuCell *result = [[NuCell alloc] init];
+    NuCell *result = [[NuCell alloc] initWithCar:anObject cdr:Nu__null];
     NuCell *cursor = result;
-    [cursor setCar:anObject];
     
     while ((anObject = [setEnumerator nextObject])) {
-        [cursor setCdr:[[NuCell alloc] init]];
-        cursor = [cursor cdr];
-        [cursor setCar:anObject];
+        NuCell *next = [[NuCell alloc] initWithCar:anObject cdr:Nu__null];
+        [cursor setCdr:next];
+        cursor = next;
     }
     return result;
 }
@@ -3818,6 +4787,7 @@ static NSComparisonResult sortedArrayUsingBlockHelper(id a, id b, void *context)
     NSEnumerator *keyEnumerator = [[self allKeys] objectEnumerator];
     id key;
     while ((key = [keyEnumerator nextObject])) {
+        NSUInteger evalDepth = nu_eval_depth();
         @try
         {
             [args setCar:key];
@@ -3825,9 +4795,11 @@ static NSComparisonResult sortedArrayUsingBlockHelper(id a, id b, void *context)
             [block evalWithArguments:args context:Nu__null];
         }
         @catch (NuBreakException *exception) {
+            nu_eval_unwind(exception, evalDepth);
             break;
         }
         @catch (NuContinueException *exception) {
+            nu_eval_unwind(exception, evalDepth);
             // do nothing, just continue with the next loop iteration
         }
         @catch (id exception) {
@@ -3905,6 +4877,113 @@ static NSComparisonResult sortedArrayUsingBlockHelper(id a, id b, void *context)
 
 @end
 
+/*!
+ @class NuStringTemplate
+ @abstract Internal class for string literals that contain #{...} interpolations.
+ @discussion The reader creates these for interpolated literals. A template
+ is still a string with the literal's text, so quoting, macros and printing
+ treat it like any other string. Its embedded expressions are parsed once, when
+ the template is created, so evaluation just evaluates them and joins the
+ pieces.
+ */
+@interface NuStringTemplate : NSString
+{
+    NSString *source;
+    NSArray *literals;      // n+1 strings around the n expressions
+    NSArray *expressions;   // parsed expressions
+    NSUInteger lengthHint;
+}
++ (NSString *) stringWithLiteral:(NSString *) string;
+@end
+
+@implementation NuStringTemplate
+
+// Expressions embedded in templates are parsed with their own parser,
+// since templates are made while another parser is in the middle of its input.
+static NuParser *templateParser(void)
+{
+    static NuParser *parser = nil;
+    if (!parser)
+        parser = [[NuParser alloc] init];
+    return parser;
+}
+
++ (NSString *) stringWithLiteral:(NSString *) string
+{
+    if ([string rangeOfString:@"#{"].location == NSNotFound)
+        return string;
+    // Split the literal the same way -[NSString(Nu) evalWithContext:] does.
+    // Literals it can't split are returned unchanged and evaluated that way.
+    NSArray *components = [string componentsSeparatedByString:@"#{"];
+    NSMutableArray *literals = [NSMutableArray arrayWithObject:[components objectAtIndex:0]];
+    NSMutableArray *expressions = [NSMutableArray array];
+    @try {
+        @synchronized([NuStringTemplate class]) {
+            NuParser *parser = templateParser();
+            for (NSUInteger i = 1; i < [components count]; i++) {
+                NSArray *parts = [[components objectAtIndex:i] componentsSeparatedByString:@"}"];
+                if ([parts count] < 2)
+                    return string;
+                id expression = [parser parse:[parts objectAtIndex:0]];
+                if (!expression || [parser incomplete]) {
+                    [parser reset];
+                    return string;
+                }
+                [expressions addObject:expression];
+                [literals addObject:[[parts subarrayWithRange:NSMakeRange(1, [parts count] - 1)] componentsJoinedByString:@"}"]];
+            }
+        }
+    }
+    @catch (id exception) {
+        [templateParser() reset];
+        return string;
+    }
+    return [[self alloc] initWithSource:string literals:literals expressions:expressions];
+}
+
+- (id) initWithSource:(NSString *) s literals:(NSArray *) l expressions:(NSArray *) e
+{
+    if ((self = [super init])) {
+        source = [s copy];
+        literals = l;
+        expressions = e;
+        lengthHint = 16 * [expressions count];
+        for (NSString *literal in literals)
+            lengthHint += [literal length];
+    }
+    return self;
+}
+
+- (NSUInteger) length
+{
+    return [source length];
+}
+
+- (unichar) characterAtIndex:(NSUInteger) index
+{
+    return [source characterAtIndex:index];
+}
+
+- (void) getCharacters:(unichar *) buffer range:(NSRange) range
+{
+    [source getCharacters:buffer range:range];
+}
+
+- (id) evalWithContext:(NSMutableDictionary *) context
+{
+    NSMutableString *result = [NSMutableString stringWithCapacity:lengthHint];
+    [result appendString:[literals objectAtIndex:0]];
+    NSUInteger count = [expressions count];
+    for (NSUInteger i = 0; i < count; i++) {
+        id value = [[expressions objectAtIndex:i] evalWithContext:context];
+        [result appendString:[value stringValue]];
+        [result appendString:[literals objectAtIndex:i+1]];
+    }
+    return result;
+}
+
+@end
+
 @implementation NSString(Nu)
 - (NSString *) stringValue
 {
@@ -3953,11 +5032,13 @@ static NSComparisonResult sortedArrayUsingBlockHelper(id a, id b, void *context)
 - (id) evalWithContext:(NSMutableDictionary *) context
 {
     NSMutableString *result;
-    NSArray *components = [self componentsSeparatedByString:@"#{"];
-    if ([components count] == 1) {
+    if ([self rangeOfString:@"#{"].location == NSNotFound) {
         result = [NSMutableString stringWithString:self];
     }
     else {
+        // Literals read by the parser are compiled into NuStringTemplates.
+        // This handles strings that were built some other way.
+        NSArray *components = [self componentsSeparatedByString:@"#{"];
         NuSymbolTable *symbolTable = [context objectForKey:SYMBOLS_KEY];
         id parser = [[context lookupObjectForKey:[symbolTable symbolWithString:@"_parser"]] weakValue];
         result = [NSMutableString stringWithString:[components objectAtIndex:0]];
@@ -4077,15 +5158,18 @@ static NSComparisonResult sortedArrayUsingBlockHelper(id a, id b, void *context)
     NSEnumerator *characterEnumerator = [self objectEnumerator];
     id character;
     while ((character = [characterEnumerator nextObject])) {
+        NSUInteger evalDepth = nu_eval_depth();
         @try
         {
             [args setCar:character];
             [block evalWithArguments:args context:Nu__null];
         }
         @catch (NuBreakException *exception) {
+            nu_eval_unwind(exception, evalDepth);
             break;
         }
         @catch (NuContinueException *exception) {
+            nu_eval_unwind(exception, evalDepth);
             // do nothing, just continue with the next loop iteration
         }
         @catch (id exception) {
@@ -4182,6 +5266,7 @@ static NSComparisonResult sortedArrayUsingBlockHelper(id a, id b, void *context)
         int x = [self intValue];
         int i;
         for (i = 0; i < x; i++) {
+            NSUInteger evalDepth = nu_eval_depth();
             @try
             {
                 @autoreleasepool {
@@ -4190,9 +5275,11 @@ static NSComparisonResult sortedArrayUsingBlockHelper(id a, id b, void *context)
                 }
             }
             @catch (NuBreakException *exception) {
+                nu_eval_unwind(exception, evalDepth);
                 break;
             }
             @catch (NuContinueException *exception) {
+                nu_eval_unwind(exception, evalDepth);
                 // do nothing, just continue with the next loop iteration
             }
             @catch (id exception) {
@@ -4215,15 +5302,18 @@ static NSComparisonResult sortedArrayUsingBlockHelper(id a, id b, void *context)
         if (nu_objectIsKindOfClass(block, [NuBlock class])) {
             int i;
             for (i = startValue; i >= finalValue; i--) {
+                NSUInteger evalDepth = nu_eval_depth();
                 @try
                 {
                     [args setCar:[NSNumber numberWithInt:i]];
                     [block evalWithArguments:args context:Nu__null];
                 }
                 @catch (NuBreakException *exception) {
+                    nu_eval_unwind(exception, evalDepth);
                     break;
                 }
                 @catch (NuContinueException *exception) {
+                    nu_eval_unwind(exception, evalDepth);
                     // do nothing, just continue with the next loop iteration
                 }
                 @catch (id exception) {
@@ -4243,15 +5333,18 @@ static NSComparisonResult sortedArrayUsingBlockHelper(id a, id b, void *context)
     if (nu_objectIsKindOfClass(block, [NuBlock class])) {
         int i;
         for (i = startValue; i <= finalValue; i++) {
+            NSUInteger evalDepth = nu_eval_depth();
             @try
             {
                 [args setCar:[NSNumber numberWithInt:i]];
                 [block evalWithArguments:args context:Nu__null];
             }
             @catch (NuBreakException *exception) {
+                nu_eval_unwind(exception, evalDepth);
                 break;
             }
             @catch (NuContinueException *exception) {
+                nu_eval_unwind(exception, evalDepth);
                 // do nothing, just continue with the next loop iteration
             }
             @catch (id exception) {
@@ -4437,7 +5530,10 @@ static NSComparisonResult sortedArrayUsingBlockHelper(id a, id b, void *context)
         if (string) {
             NuSymbolTable *symbolTable = [context objectForKey:SYMBOLS_KEY];
             id parser = [[context lookupObjectForKey:[symbolTable symbolWithString:@"_parser"]] weakValue];
-            id body = [parser parse:string asIfFromFilename:[fileName cStringUsingEncoding:NSUTF8StringEncoding]];
+            // use a prebuilt image of the file if there is one
+            NSString *imageName = [self pathForResource:nuFileName ofType:@"nuimage"];
+            NSData *image = imageName ? [NSData dataWithContentsOfFile:imageName options:NSDataReadingMappedIfSafe error:NULL] : nil;
+            id body = [parser parseImage:image source:string asIfFromFilename:[fileName cStringUsingEncoding:NSUTF8StringEncoding]];
             [body evalWithContext:context];
             return [symbolTable symbolWithString:@"t"];
         }
@@ -4683,7 +5779,49 @@ MAKE_HANDLER_WITH_TYPE(NSRange)
 @end
 
 #pragma mark - NuMacro_0
+
+static BOOL nu_list_mentions_symbol(id list, id symbol1, id symbol2)
+{
+    while (nu_objectIsKindOfClass(list, [NuCell class])) {
+        id item = [list car];
+        if ((item == symbol1) || (item == symbol2))
+            return YES;
+        if (nu_objectIsKindOfClass(item, [NuCell class]) && nu_list_mentions_symbol(item, symbol1, symbol2))
+            return YES;
+        list = [list cdr];
+    }
+    return NO;
+}
+
+/*!
+ @class NuMacroExpansion
+ @abstract Internal class for the expansion of a macro at one call site.
+ @discussion When expansion caching is on, macros whose expansions depend only on
+ the code they are given keep them on the argument lists of their call sites. The
+ expansion is used again as long as the site still calls the same macro object and
+ nu_code_epoch hasn't changed, so redefining a macro or changing any parsed code
+ makes old expansions unused. Only sites and bodies made entirely of code cells
+ are cached, since changes to other cells don't change the epoch.
+ */
+@interface NuMacroExpansion : NSObject
+{
+@public
+    NuMacro_0 *macro;
+    id expansion;
+    NSUInteger codeEpoch;
+}
+@end
+
+@implementation NuMacroExpansion
+@end
+
+static BOOL nu_macros_cache_expansions = NO;
+
 @interface NuMacro_0 ()
+{
+    // 2 | (nu_code_epoch << 2) once the body has been checked under that epoch, plus 1 if it can be cached
+    _Atomic NSUInteger staticCheck;
+}
 @property (nonatomic, strong) NSString *name;
 @property (nonatomic, strong) NuCell *body;
 @property (nonatomic, strong) NSMutableSet *gensyms;
@@ -4691,6 +5829,53 @@ MAKE_HANDLER_WITH_TYPE(NSRange)
 
 @implementation NuMacro_0
 
++ (void) setCachesExpansions:(BOOL) flag
+{
+    nu_macros_cache_expansions = flag;
+}
+
++ (BOOL) cachesExpansions
+{
+    return nu_macros_cache_expansions;
+}
+
+// Macro-0 bodies are expanded by evaluating their unquotes, so only bodies without any expand the same way every time.
+- (BOOL) bodyExpandsStatically
+{
+    return !nu_list_mentions_symbol(self.body, nu_unquote_symbol, nu_unquote_symbol);
+}
+
+- (id) cachedExpansionAt:(id) cdr
+{
+    if (!nu_macros_cache_expansions || (object_getClass(cdr) != [NuCodeCell class]))
+        return nil;
+    NuMacroExpansion *cache = [((NuCodeCell *) cdr) siteCache];
+    if ((object_getClass(cache) != [NuMacroExpansion class]) || (cache->macro != self)
+        || (cache->codeEpoch != nu_code_epoch_now()))
+        return nil;
+    return cache->expansion;
+}
+
+- (void) cacheExpansion:(id) expansion at:(id) cdr
+{
+    if (!nu_macros_cache_expansions || !expansion || (object_getClass(cdr) != [NuCodeCell class]))
+        return;
+    NSUInteger epoch = nu_code_epoch_now();
+    NSUInteger check = atomic_load_explicit(&staticCheck, memory_order_relaxed);
+    if ((check >> 2) != (epoch & (NSUIntegerMax >> 2)) || !(check & 2)) {
+        BOOL cacheable = [self bodyExpandsStatically] && nu_list_is_code(self.body, YES);
+        check = (epoch << 2) | 2 | (cacheable ? 1 : 0);
+        atomic_store_explicit(&staticCheck, check, memory_order_relaxed);
+    }
+    if (!(check & 1) || !nu_list_is_code(cdr, YES))
+        return;
+    NuMacroExpansion *cache = [[NuMacroExpansion alloc] init];
+    cache->macro = self;
+    cache->expansion = expansion;
+    cache->codeEpoch = epoch;
+    [((NuCodeCell *) cdr) setSiteCache:cache];
+}
+
 + (id) macroWithName:(NSString *)n body:(NuCell *)b
 {
     return [[self alloc] initWithName:n body:b];
@@ -4785,10 +5970,9 @@ MAKE_HANDLER_WITH_TYPE(NSRange)
 
 - (id) expandUnquotes:(id) oldBody withContext:(NSMutableDictionary *) context
 {
-    NuSymbolTable *symbolTable = [context objectForKey:SYMBOLS_KEY];
     if (oldBody == [NSNull null])
         return oldBody;
-    id unquote = [symbolTable symbolWithString:@"unquote"];
+    id unquote = nu_unquote_symbol;
     id car = [oldBody car];
     id cdr = [oldBody cdr];
     if ([car atom]) {
@@ -4816,26 +6000,32 @@ MAKE_HANDLER_WITH_TYPE(NSRange)
     NuSymbolTable *symbolTable = [calling_context objectForKey:SYMBOLS_KEY];
     
     // save the current value of margs
-    id old_margs = [calling_context objectForKey:[symbolTable symbolWithString:@"margs"]];
+    id old_margs = [calling_context objectForKey:nu_margs_symbol];
     // set the arguments to the special variable "margs"
-    [calling_context setPossiblyNullObject:cdr forKey:[symbolTable symbolWithString:@"margs"]];
+    [calling_context setPossiblyNullObject:cdr forKey:nu_margs_symbol];
     // evaluate the body of the block in the calling context (implicit progn)
     
-    // if the macro contains gensyms, give them a unique prefix
-    NSUInteger gensymCount = [[self gensyms] count];
-    id gensymPrefix = nil;
-    if (gensymCount > 0) {
-        gensymPrefix = [NSString stringWithFormat:@"g%ld", [NuMath random]];
-    }
-    
-    id bodyToEvaluate = (gensymCount == 0)
-    ? (id)_body : [self body:_body withGensymPrefix:gensymPrefix symbolTable:symbolTable];
-    
-    // uncomment this to get the old (no gensym) behavior.
-    //bodyToEvaluate = body;
-    //NSLog(@"evaluating %@", [bodyToEvaluate stringValue]);
-    
-    id value = [self expandUnquotes:bodyToEvaluate withContext:calling_context];
+    // reuse this call site's last expansion if there is one
+    id value = evalFlag ? [self cachedExpansionAt:cdr] : nil;
+    if (!value) {
+        // if the macro contains gensyms, give them a unique prefix
+        NSUInteger gensymCount = [[self gensyms] count];
+        id gensymPrefix = nil;
+        if (gensymCount > 0) {
+            gensymPrefix = [NSString stringWithFormat:@"g%ld", [NuMath random]];
+        }
+        
+        id bodyToEvaluate = (gensymCount == 0)
+        ? (id)_body : [self body:_body withGensymPrefix:gensymPrefix symbolTable:symbolTable];
+        
+        // uncomment this to get the old (no gensym) behavior.
+        //bodyToEvaluate = body;
+        //NSLog(@"evaluating %@", [bodyToEvaluate stringValue]);
+        
+        value = [self expandUnquotes:bodyToEvaluate withContext:calling_context];
+        if (evalFlag)
+            [self cacheExpansion:value at:cdr];
+    }
     
 	if (evalFlag)
 	{
@@ -4849,10 +6039,10 @@ MAKE_HANDLER_WITH_TYPE(NSRange)
     
     // restore the old value of margs
     if (old_margs == nil) {
-        [calling_context removeObjectForKey:[symbolTable symbolWithString:@"margs"]];
+        [calling_context removeObjectForKey:nu_margs_symbol];
     }
     else {
-        [calling_context setPossiblyNullObject:old_margs forKey:[symbolTable symbolWithString:@"margs"]];
+        [calling_context setPossiblyNullObject:old_margs forKey:nu_margs_symbol];
     }
     
 #if 0
@@ -4920,7 +6110,7 @@ MAKE_HANDLER_WITH_TYPE(NSRange)
     if ([[atom stringValue] isEqualToString:[sequence stringValue]])
         return YES;
     
-    if ([sequence class] == [NuCell class]) {
+    if (nu_objectIsKindOfClass(sequence, [NuCell class])) {
         return (   [self findAtom:atom inSequence:[sequence car]]
                 || [self findAtom:atom inSequence:[sequence cdr]]);
     }
@@ -4953,6 +6143,56 @@ MAKE_HANDLER_WITH_TYPE(NSRange)
     return [NSString stringWithFormat:@"(macro %@ %@ %@)", self.name, [_parameters stringValue], [self.body stringValue]];
 }
 
+static void nu_collect_pattern_symbols(id pattern, NSMutableSet *symbols)
+{
+    if (nu_objectIsKindOfClass(pattern, [NuSymbol class])) {
+        [symbols addObject:pattern];
+    }
+    else if (nu_objectIsKindOfClass(pattern, [NuCell class])) {
+        nu_collect_pattern_symbols([pattern car], symbols);
+        nu_collect_pattern_symbols([pattern cdr], symbols);
+    }
+}
+
+// Check that a quasiquoted template only inserts the code bound to the macro's parameters.
+// A parameter named anywhere else would be evaluated with whatever binding
+// the expansion it was cached from saw, so it isn't static either.
+static BOOL nu_template_is_static(id template, NSSet *parameters, NuSymbolTable *symbolTable)
+{
+    if (!nu_objectIsKindOfClass(template, [NuCell class]))
+        return (template == nu_args_symbol) || ![parameters containsObject:template];
+    id head = [template car];
+    if ((head == [symbolTable symbolWithString:@"quasiquote-eval"])
+        || (head == [symbolTable symbolWithString:@"quasiquote-splice"])) {
+        return [parameters containsObject:[[template cdr] car]];
+    }
+    id cursor = template;
+    for (; nu_objectIsKindOfClass(cursor, [NuCell class]); cursor = [cursor cdr]) {
+        id item = [cursor car];
+        if ((item == nu_unquote_symbol) || (item == [symbolTable symbolWithString:@"quasiquote"]))
+            return NO;
+        if (!nu_template_is_static(item, parameters, symbolTable))
+            return NO;
+    }
+    return nu_template_is_static(cursor, parameters, symbolTable);
+}
+
+// A body that is one quasiquoted template, inserting only the code given
+// for the parameters, expands the same way every time it is given the same code.
+- (BOOL) bodyExpandsStatically
+{
+    id body = self.body;
+    if (!nu_objectIsKindOfClass(body, [NuCell class]) || ([body cdr] != Nu__null))
+        return NO;
+    NuSymbolTable *symbolTable = [NuSymbolTable sharedSymbolTable];
+    id form = [body car];
+    if (!nu_objectIsKindOfClass(form, [NuCell class]) || ([form car] != [symbolTable symbolWithString:@"quasiquote"]))
+        return NO;
+    NSMutableSet *parameters = [NSMutableSet setWithObject:nu_args_symbol];
+    nu_collect_pattern_symbols(_parameters, parameters);
+    return nu_template_is_static([[form cdr] car], parameters, symbolTable);
+}
+
 - (void) dumpContext:(NSMutableDictionary*)context
 {
 #ifdef MACRO1_DEBUG
@@ -4969,13 +6209,11 @@ MAKE_HANDLER_WITH_TYPE(NSRange)
 
 - (void) restoreArgs:(id)old_args context:(NSMutableDictionary*)calling_context
 {
-    NuSymbolTable *symbolTable = [calling_context objectForKey:SYMBOLS_KEY];
-    
     if (old_args == nil) {
-        [calling_context removeObjectForKey:[symbolTable symbolWithString:@"*args"]];
+        [calling_context removeObjectForKey:nu_args_symbol];
     }
     else {
-        [calling_context setPossiblyNullObject:old_args forKey:[symbolTable symbolWithString:@"*args"]];
+        [calling_context setPossiblyNullObject:old_args forKey:nu_args_symbol];
     }
 }
 
@@ -5088,7 +6326,7 @@ MAKE_HANDLER_WITH_TYPE(NSRange)
     //       (else ((let ((bindings1 (mdestructure (car pat) (car seq)))
     //                    (bindings2 (mdestructure (cdr pat) (cdr seq))))
     //                (append bindings1 bindings2))))))
-    else if ([pattern class] == [NuCell class]) {
+    else if (nu_objectIsKindOfClass(pattern, [NuCell class])) {
         if (   ([[pattern car] class] == [NuSymbol class])
             && ([[[pattern car] stringValue] characterAtIndex:0] == '*')) {
             
@@ -5132,6 +6370,25 @@ MAKE_HANDLER_WITH_TYPE(NSRange)
 {
     NuSymbolTable *symbolTable = [calling_context objectForKey:SYMBOLS_KEY];
     
+    // reuse this call site's last expansion if there is one
+    id expansion = evalFlag ? [self cachedExpansionAt:cdr] : nil;
+    if (expansion) {
+        // *args stays bound while the expansion is evaluated, as it does below
+        id old_args = [calling_context objectForKey:nu_args_symbol];
+        [calling_context setPossiblyNullObject:cdr forKey:nu_args_symbol];
+        id value;
+        @try
+        {
+            value = [expansion evalWithContext:calling_context];
+        }
+        @catch (id exception) {
+            [self restoreArgs:old_args context:calling_context];
+            @throw;
+        }
+        [self restoreArgs:old_args context:calling_context];
+        return value;
+    }
+    
     NSMutableDictionary* maskedVariables = [[NSMutableDictionary alloc] init];
     
     id plist;
@@ -5141,7 +6398,7 @@ MAKE_HANDLER_WITH_TYPE(NSRange)
 #ifdef MACRO1_DEBUG
     [self dumpContext:calling_context];
 #endif
-    NuSymbol *starArgs = [symbolTable symbolWithString:@"*args"];
+    NuSymbol *starArgs = nu_args_symbol;
     id old_args = [calling_context objectForKey:starArgs];
     [calling_context setPossiblyNullObject:cdr forKey:starArgs];
     
@@ -5222,6 +6479,7 @@ MAKE_HANDLER_WITH_TYPE(NSRange)
         // Macro evaluation
         // If we're just macro-expanding, don't do this step...
         if (evalFlag) {
+            [self cacheExpansion:value at:cdr];
             Macro1Debug(@"About to execute: %@", [value stringValue]);
             value = [value evalWithContext:calling_context];
             Macro1Debug(@"macro eval value: %@", [value stringValue]);
@@ -5368,6 +6626,130 @@ MAKE_HANDLER_WITH_TYPE(NSRange)
 
 @end
 
+#define NU_SEND_CACHE_SIZE 4
+#define NU_SEND_STACK_ARGUMENTS 8
+
+/*!
+ @class NuSendCache
+ @abstract Internal class for the inline cache of one message send.
+ @discussion Each message list made of code cells keeps one of these. It holds
+ the selector and argument expressions taken from the list, plus the methods
+ resolved for the last few receiver classes. The entries are not used after
+ nu_class_epoch changes, and the cache is not used after nu_code_epoch changes.
+ A cache isn't changed once it is on its list: a send that resolves a new method
+ puts a copy with the new entry in its place, so sends on other threads only
+ ever see whole caches.
+ */
+@interface NuSendCache : NSObject
+{
+@public
+    SEL selector;
+    NSUInteger argumentCount;
+    NSArray *argumentList;
+    __unsafe_unretained id *arguments;      // retained by argumentList
+    NSUInteger epoch;
+    NSUInteger codeEpoch;
+    NSUInteger entryCount;
+    NSUInteger nextEntry;
+    __unsafe_unretained Class classes[NU_SEND_CACHE_SIZE];
+    BOOL wrapped[NU_SEND_CACHE_SIZE];       // receiver is a NuClass wrapping classes[i]
+    BOOL toWrappedClass[NU_SEND_CACHE_SIZE];// message goes to the wrapped class
+    NuMethodInfo *entries[NU_SEND_CACHE_SIZE];
+}
+- (id) initWithMessage:(id) cdr;
+@end
+
+@implementation NuSendCache
+
+- (id) initWithMessage:(id) cdr
+{
+    if ((self = [super init])) {
+        codeEpoch = nu_code_epoch_now();
+        // Collect the method selector and arguments.
+        // Methods with variadic arguments (NSArray arrayWithObjects:...) are not supported.
+        NSMutableArray *args = [[NSMutableArray alloc] init];
+        id cursor = cdr;
+        id nextSymbol = [cursor car];
+        if (nu_objectIsKindOfClass(nextSymbol, [NuSymbol class])) {
+            NuSelectorCache *selectorCache = [[NuSelectorCache sharedSelectorCache] lookupSymbol:nextSymbol];
+            cursor = [cursor cdr];
+            while (cursor && (cursor != Nu__null)) {
+                [args addObject:[cursor car]];
+                cursor = [cursor cdr];
+                if (cursor && (cursor != Nu__null)) {
+                    id nextSymbol = [cursor car];
+                    if (nu_objectIsKindOfClass(nextSymbol, [NuSymbol class]) && [nextSymbol isLabel]) {
+                        selectorCache = [selectorCache lookupSymbol:nextSymbol];
+                    }
+                    cursor = [cursor cdr];
+                }
+            }
+            selector = [selectorCache selector];
+        }
+        argumentList = args;
+        argumentCount = [args count];
+        arguments = (__unsafe_unretained id *) malloc((argumentCount + 1) * sizeof(id));
+        [args getObjects:arguments range:NSMakeRange(0, argumentCount)];
+        epoch = nu_class_epoch;
+    }
+    return self;
+}
+
+- (void) dealloc
+{
+    free(arguments);
+}
+
+- (BOOL) isCurrent
+{
+    return codeEpoch == nu_code_epoch_now();
+}
+
+- (NuMethodInfo *) infoForClass:(Class) c wrapped:(BOOL) w toWrappedClass:(BOOL *) toWrapped
+{
+    if (epoch != nu_class_epoch)
+        return nil;
+    for (NSUInteger i = 0; i < entryCount; i++) {
+        if ((classes[i] == c) && (wrapped[i] == w)) {
+            *toWrapped = toWrappedClass[i];
+            return entries[i];
+        }
+    }
+    return nil;
+}
+
+// A copy of this cache with an entry added. Its entries are kept only if they are still current.
+- (NuSendCache *) cacheWithInfo:(NuMethodInfo *) info forClass:(Class) c wrapped:(BOOL) w toWrappedClass:(BOOL) toWrapped
+{
+    NuSendCache *copy = [[NuSendCache alloc] init];
+    copy->selector = selector;
+    copy->argumentList = argumentList;
+    copy->argumentCount = argumentCount;
+    copy->arguments = (__unsafe_unretained id *) malloc((argumentCount + 1) * sizeof(id));
+    [argumentList getObjects:copy->arguments range:NSMakeRange(0, argumentCount)];
+    copy->codeEpoch = codeEpoch;
+    copy->epoch = nu_class_epoch;
+    if (epoch == nu_class_epoch) {
+        copy->entryCount = entryCount;
+        copy->nextEntry = nextEntry;
+        for (NSUInteger i = 0; i < entryCount; i++) {
+            copy->classes[i] = classes[i];
+            copy->wrapped[i] = wrapped[i];
+            copy->toWrappedClass[i] = toWrappedClass[i];
+            copy->entries[i] = entries[i];
+        }
+    }
+    // when the cache is full, replace entries in turn
+    NSUInteger i = (copy->entryCount < NU_SEND_CACHE_SIZE) ? copy->entryCount++ : (copy->nextEntry++ % NU_SEND_CACHE_SIZE);
+    copy->classes[i] = c;
+    copy->wrapped[i] = w;
+    copy->toWrappedClass[i] = toWrapped;
+    copy->entries[i] = info;
+    return copy;
+}
+
+@end
+
 @implementation NSObject(Nu)
 - (BOOL) atom
 {
@@ -5410,70 +6792,83 @@ MAKE_HANDLER_WITH_TYPE(NSRange)
     // But when they're at the head of a list, that list is converted into a message that is sent to the object.
     @autoreleasepool {
         
-        // Collect the method selector and arguments.
-        // This seems like a bottleneck, and it also lacks flexibility.
-        // Replacing explicit string building with the selector cache reduced runtimes by around 20%.
-        // Methods with variadic arguments (NSArray arrayWithObjects:...) are not supported.
-        NSMutableArray *args = [[NSMutableArray alloc] init];
-        id cursor = cdr;
-        SEL sel = 0;
-        id nextSymbol = [cursor car];
-        if (nu_objectIsKindOfClass(nextSymbol, [NuSymbol class])) {
-            // The commented out code below was the original approach.
-            // methods were identified by concatenating symbols and looking up the resulting method -- on every method call
-            // that was slow but simple
-            // NSMutableString *selectorString = [NSMutableString stringWithString:[nextSymbol stringValue]];
-            NuSelectorCache *selectorCache = [[NuSelectorCache sharedSelectorCache] lookupSymbol:nextSymbol];
-            cursor = [cursor cdr];
-            while (cursor && (cursor != Nu__null)) {
-                [args addObject:[cursor car]];
-                cursor = [cursor cdr];
-                if (cursor && (cursor != Nu__null)) {
-                    id nextSymbol = [cursor car];
-                    if (nu_objectIsKindOfClass(nextSymbol, [NuSymbol class]) && [nextSymbol isLabel]) {
-                        // [selectorString appendString:[nextSymbol stringValue]];
-                        selectorCache = [selectorCache lookupSymbol:nextSymbol];
-                    }
-                    cursor = [cursor cdr];
-                }
-            }
-            // sel = sel_getUid([selectorString cStringUsingEncoding:NSUTF8StringEncoding]);
-            sel = [selectorCache selector];
-        }
+        // The selector and argument expressions are collected once per message list
+        // of parsed code and kept with the methods resolved for recent receivers.
+        BOOL cacheable = (object_getClass(cdr) == [NuCodeCell class]);
+        NuSendCache *cache = cacheable ? [((NuCodeCell *) cdr) siteCache] : nil;
+        if ((object_getClass(cache) != [NuSendCache class]) || ![cache isCurrent]) {
+            cache = [[NuSendCache alloc] initWithMessage:cdr];
+            // messages with cells made at run time can change without notice
+            cacheable = cacheable && nu_list_is_code(cdr, NO);
+            if (cacheable)
+                [((NuCodeCell *) cdr) setSiteCache:cache];
+        }
+        SEL sel = cache->selector;
         
         id target = self;
         
         // Look up the appropriate method to call for the specified selector.
-        Method m;
         // instead of isMemberOfClass:, which may be blocked by an NSProtocolChecker
         BOOL isAClass = (object_getClass(self) == [NuClass class]);
-        if (isAClass) {
-            // Class wrappers (objects of type NuClass) get special treatment. Instance methods are sent directly to the class wrapper object.
-            // But when a class method is sent to a class wrapper, the method is instead sent as a class method to the wrapped class.
-            // This makes it possible to call class methods from Nu, but there is no way to directly call class methods of NuClass from Nu.
-            id wrappedClass = [((NuClass *) self) wrappedClass];
-            m = class_getClassMethod(wrappedClass, sel);
-            if (m)
-                target = wrappedClass;
-            else
-                m = class_getInstanceMethod(object_getClass(self), sel);
-        }
-        else {
-            m = class_getInstanceMethod(object_getClass(self), sel);
-            if (!m) m = class_getClassMethod(object_getClass(self), sel);
+        Class receiverClass = isAClass ? [((NuClass *) self) wrappedClass] : object_getClass(self);
+        BOOL toWrappedClass = NO;
+        NuMethodInfo *info = [cache infoForClass:receiverClass wrapped:isAClass toWrappedClass:&toWrappedClass];
+        if (!info) {
+            Method m;
+            if (isAClass) {
+                // Class wrappers (objects of type NuClass) get special treatment. Instance methods are sent directly to the class wrapper object.
+                // But when a class method is sent to a class wrapper, the method is instead sent as a class method to the wrapped class.
+                // This makes it possible to call class methods from Nu, but there is no way to directly call class methods of NuClass from Nu.
+                m = class_getClassMethod(receiverClass, sel);
+                if (m)
+                    toWrappedClass = YES;
+                else
+                    m = class_getInstanceMethod(object_getClass(self), sel);
+            }
+            else {
+                m = class_getInstanceMethod(receiverClass, sel);
+                if (!m) m = class_getClassMethod(receiverClass, sel);
+            }
+            if (m) {
+                // this call seems to force the class's +initialize method to be called.
+                [(toWrappedClass ? (id) receiverClass : self) class];
+                info = [[NuMethodInfo alloc] initWithMethod:m];
+                if (cacheable) {
+                    cache = [cache cacheWithInfo:info forClass:receiverClass wrapped:isAClass toWrappedClass:toWrappedClass];
+                    [((NuCodeCell *) cdr) setSiteCache:cache];
+                }
+            }
         }
+        if (toWrappedClass)
+            target = receiverClass;
         id result = Nu__null;
-        if (m) {
+        if (info) {
             // We have a method that matches the selector.
             // First, evaluate the arguments.
-            NSMutableArray *argValues = [[NSMutableArray alloc] init];
-            NSUInteger i;
-            NSUInteger imax = [args count];
-            for (i = 0; i < imax; i++) {
-                [argValues addObject:[[args objectAtIndex:i] evalWithContext:context]];
+            NSUInteger imax = cache->argumentCount;
+            __strong id stackValues[NU_SEND_STACK_ARGUMENTS];
+            NSMutableArray *heapValues = nil;
+            __unsafe_unretained id *argValues;
+            if (imax <= NU_SEND_STACK_ARGUMENTS) {
+                for (NSUInteger i = 0; i < imax; i++)
+                    stackValues[i] = [cache->arguments[i] evalWithContext:context];
+                argValues = (__unsafe_unretained id *) (void *) stackValues;
+            }
+            else {
+                heapValues = [[NSMutableArray alloc] initWithCapacity:imax];
+                for (NSUInteger i = 0; i < imax; i++)
+                    [heapValues addObject:[cache->arguments[i] evalWithContext:context]];
+                argValues = (__unsafe_unretained id *) malloc(imax * sizeof(id));
+                [heapValues getObjects:argValues range:NSMakeRange(0, imax)];
             }
             // Then call the method.
-            result = nu_calling_objc_method_handler(target, m, argValues);
+            @try {
+                result = nu_calling_objc_method_info(target, info, argValues, imax);
+            }
+            @finally {
+                if (heapValues)
+                    free(argValues);
+            }
         }
         else {
             // If the head of the list is a label, we treat the list as a property list.
@@ -5604,6 +6999,7 @@ MAKE_HANDLER_WITH_TYPE(NSRange)
     else if (message_length == 2) {
         // try to automatically set an ivar
         if ([[[[message car] stringValue] substringWithRange:NSMakeRange(0,3)] isEqualToString:@"set"]) {
+            NSUInteger evalDepth = nu_eval_depth();
             @try
             {
                 id firstArgument = [[message car] stringValue];
@@ -5614,6 +7010,7 @@ MAKE_HANDLER_WITH_TYPE(NSRange)
                 return Nu__null;
             }
             @catch (id error) {
+                nu_eval_unwind(error, evalDepth);
                 // NSLog(@"skipping this error: %@", [error description]);
                 // no ivar, keep going
             }
@@ -5850,6 +7247,7 @@ MAKE_HANDLER_WITH_TYPE(NSRange)
     // If both are found, swizzle them
     if ((method1 != NULL) && (method2 != NULL)) {
         method_exchangeImplementations(method1, method2);
+        nu_class_epoch++;
         return YES;
     }
     else {
@@ -5873,6 +7271,7 @@ MAKE_HANDLER_WITH_TYPE(NSRange)
     // If both are found, swizzle them
     if ((method1 != NULL) && (method2 != NULL)) {
         method_exchangeImplementations(method1, method2);
+        nu_class_epoch++;
         return true;
     }
     else {
@@ -6032,9 +7431,8 @@ MAKE_HANDLER_WITH_TYPE(NSRange)
 {
     id cadr = [cdr car];
     id value = [cadr evalWithContext:context];
-    NuSymbolTable *symbolTable = [context objectForKey:SYMBOLS_KEY];
     if ([value atom])
-        return [symbolTable symbolWithString:@"t"];
+        return nu_t_symbol;
     else
         return Nu__null;
 }
@@ -6050,11 +7448,13 @@ MAKE_HANDLER_WITH_TYPE(NSRange)
 {
     BOOL is_defined = YES;
     id cadr = [cdr car];
+    NSUInteger evalDepth = nu_eval_depth();
     @try
     {
         [cadr evalWithContext:context];
     }
     @catch (id exception) {
+        exception = nu_eval_unwind(exception, evalDepth);
         // is this an undefined symbol exception? if not, throw it
         if ([[exception name] isEqualToString:@"NuUndefinedSymbol"]) {
             is_defined = NO;
@@ -6063,9 +7463,8 @@ MAKE_HANDLER_WITH_TYPE(NSRange)
             @throw(exception);
         }
     }
-    NuSymbolTable *symbolTable = [context objectForKey:SYMBOLS_KEY];
     if (is_defined)
-        return [symbolTable symbolWithString:@"t"];
+        return nu_t_symbol;
     else
         return Nu__null;
 }
@@ -6078,7 +7477,6 @@ MAKE_HANDLER_WITH_TYPE(NSRange)
 @implementation Nu_eq_operator
 - (id) callWithArguments:(id)cdr context:(NSMutableDictionary *)context
 {
-    NuSymbolTable *symbolTable = [context objectForKey:SYMBOLS_KEY];
     id cursor = cdr;
     id current = [[cursor car] evalWithContext:context];
     cursor = [cursor cdr];
@@ -6089,7 +7487,7 @@ MAKE_HANDLER_WITH_TYPE(NSRange)
         current = next;
         cursor = [cursor cdr];
     }
-    return [symbolTable symbolWithString:@"t"];
+    return nu_t_symbol;
 }
 
 @end
@@ -6104,7 +7502,6 @@ MAKE_HANDLER_WITH_TYPE(NSRange)
     id caddr = [[cdr cdr] car];
     id value1 = [cadr evalWithContext:context];
     id value2 = [caddr evalWithContext:context];
-    NuSymbolTable *symbolTable = [context objectForKey:SYMBOLS_KEY];
     if ((value1 == nil) && (value2 == nil)) {
         return Nu__null;
     }
@@ -6112,7 +7509,7 @@ MAKE_HANDLER_WITH_TYPE(NSRange)
         return Nu__null;
     }
     else {
-        return [symbolTable symbolWithString:@"t"];
+        return nu_t_symbol;
     }
 }
 
@@ -6148,16 +7545,14 @@ MAKE_HANDLER_WITH_TYPE(NSRange)
     while (list_to_append && (list_to_append != Nu__null)) {
         id item_to_append = [[list_to_append car] evalWithContext:context];
         while (item_to_append && (item_to_append != Nu__null)) {
+            NuCell *next = [[NuCell alloc] initWithCar:[item_to_append car] cdr:Nu__null];
             if (newList == Nu__null) {
-                newList = [[NuCell alloc] init];
-                cursor = newList;
+                newList = next;
             }
             else {
-                [cursor setCdr: [[NuCell alloc] init]];
-                cursor = [cursor cdr];
+                [cursor setCdr:next];
             }
-            id item = [item_to_append car];
-            [cursor setCar: item];
+            cursor = next;
             item_to_append = [item_to_append cdr];
         }
         list_to_append = [list_to_append cdr];
@@ -6183,8 +7578,7 @@ MAKE_HANDLER_WITH_TYPE(NSRange)
 
 - (id) callWithArguments:(id)cdr context:(NSMutableDictionary *)context
 {
-    NuSymbolTable *symbolTable = [context objectForKey:SYMBOLS_KEY];
-    id quoteSymbol = [symbolTable symbolWithString:@"quote"];
+    id quoteSymbol = nu_quote_symbol;
     
     id fn = [cdr car];
     
@@ -6246,17 +7640,24 @@ MAKE_HANDLER_WITH_TYPE(NSRange)
 @implementation Nu_cond_operator
 - (id) callWithArguments:(id)cdr context:(NSMutableDictionary *)context
 {
+    BOOL tail = nu_eval_stack.tailPosition;
+    nu_eval_stack.tailPosition = NO;
     id pairs = cdr;
     id value = Nu__null;
     while (pairs != Nu__null) {
         id condition = [[pairs car] car];
         id test = [condition evalWithContext:context];
+        if (nu_eval_stack.unwinding)
+            return Nu__null;
         if (nu_valueIsTrue(test)) {
             value = test;
             id cursor = [[pairs car] cdr];
             while (cursor && (cursor != Nu__null)) {
-                value = [[cursor car] evalWithContext:context];
-                cursor = [cursor cdr];
+                id next = [cursor cdr];
+                value = nu_eval_tail([cursor car], context, tail && !IS_NOT_NULL(next));
+                if (nu_eval_stack.unwinding)
+                    return value;
+                cursor = next;
             }
             return value;
         }
@@ -6273,17 +7674,26 @@ MAKE_HANDLER_WITH_TYPE(NSRange)
 @implementation Nu_case_operator
 - (id) callWithArguments:(id)cdr context:(NSMutableDictionary *)context
 {
+    BOOL tail = nu_eval_stack.tailPosition;
+    nu_eval_stack.tailPosition = NO;
     id target = [[cdr car] evalWithContext:context];
+    if (nu_eval_stack.unwinding)
+        return Nu__null;
     id cases = [cdr cdr];
     while ([cases cdr] != Nu__null) {
         id condition = [[cases car] car];
         id result = [condition evalWithContext:context];
+        if (nu_eval_stack.unwinding)
+            return Nu__null;
         if ([result isEqual:target]) {
             id value = Nu__null;
             id cursor = [[cases car] cdr];
             while (cursor && (cursor != Nu__null)) {
-                value = [[cursor car] evalWithContext:context];
-                cursor = [cursor cdr];
+                id next = [cursor cdr];
+                value = nu_eval_tail([cursor car], context, tail && !IS_NOT_NULL(next));
+                if (nu_eval_stack.unwinding)
+                    return value;
+                cursor = next;
             }
             return value;
         }
@@ -6293,8 +7703,11 @@ MAKE_HANDLER_WITH_TYPE(NSRange)
     id value = Nu__null;
     id cursor = [[cases car] cdr];
     while (cursor && (cursor != Nu__null)) {
-        value = [[cursor car] evalWithContext:context];
-        cursor = [cursor cdr];
+        id next = [cursor cdr];
+        value = nu_eval_tail([cursor car], context, tail && !IS_NOT_NULL(next));
+        if (nu_eval_stack.unwinding)
+            return value;
+        cursor = next;
     }
     return value;
 }
@@ -6305,6 +7718,28 @@ MAKE_HANDLER_WITH_TYPE(NSRange)
 - (id) callWithArguments:(id)cdr context:(NSMutableDictionary *)context flipped:(BOOL)flip;
 @end
 
+// Whether an if evaluates any of the expressions that follow one it has just evaluated,
+// which tells whether that one was in tail position.
+static BOOL nu_if_evaluates_any(id expressions, BOOL testIsTrue, BOOL noneIsTrue)
+{
+    while (expressions && (expressions != Nu__null)) {
+        id expression = [expressions car];
+        if (expression == nu_else_symbol) {
+            testIsTrue = noneIsTrue;
+            noneIsTrue = NO;
+        }
+        else if (nu_objectIsKindOfClass(expression, [NuCell class]) && ([expression car] == nu_else_symbol)) {
+            if (noneIsTrue)
+                return YES;
+        }
+        else if (testIsTrue) {
+            return YES;
+        }
+        expressions = [expressions cdr];
+    }
+    return NO;
+}
+
 @implementation Nu_if_operator
 - (id) callWithArguments:(id)cdr context:(NSMutableDictionary *)context
 {
@@ -6313,13 +7748,14 @@ MAKE_HANDLER_WITH_TYPE(NSRange)
 
 - (id) callWithArguments:(id)cdr context:(NSMutableDictionary *)context flipped:(BOOL)flip
 {
-    NuSymbolTable *symbolTable = [context objectForKey:SYMBOLS_KEY];
-    //id thenSymbol = [symbolTable symbolWithString:@"then"];
-    id elseSymbol = [symbolTable symbolWithString:@"else"];
-    //id elseifSymbol = [symbolTable symbolWithString:@"elseif"];
+    BOOL tail = nu_eval_stack.tailPosition;
+    nu_eval_stack.tailPosition = NO;
+    id elseSymbol = nu_else_symbol;
     
     id result = Nu__null;
     id test = [[cdr car] evalWithContext:context];
+    if (nu_eval_stack.unwinding)
+        return result;
     
     BOOL testIsTrue = flip ^ nu_valueIsTrue(test);
     BOOL noneIsTrue = !testIsTrue;
@@ -6339,11 +7775,13 @@ MAKE_HANDLER_WITH_TYPE(NSRange)
              else */
             if ([nextExpression car] == elseSymbol) {
                 if (noneIsTrue)
-                    result = [nextExpression evalWithContext:context];
+                    result = nu_eval_tail(nextExpression, context,
+                                          tail && !nu_if_evaluates_any([expressions cdr], testIsTrue, noneIsTrue));
             }
             else {
                 if (testIsTrue)
-                    result = [nextExpression evalWithContext:context];
+                    result = nu_eval_tail(nextExpression, context,
+                                          tail && !nu_if_evaluates_any([expressions cdr], testIsTrue, noneIsTrue));
             }
         }
         else {
@@ -6363,6 +7801,8 @@ MAKE_HANDLER_WITH_TYPE(NSRange)
                     result = [nextExpression evalWithContext:context];
             }
         }
+        if (nu_eval_stack.unwinding)
+            return result;
         expressions = [expressions cdr];
     }
     return result;
@@ -6381,6 +7821,25 @@ MAKE_HANDLER_WITH_TYPE(NSRange)
 
 @end
 
+// Evaluate the body of a loop once, keeping the value of its last expression.
+// Returns NO if the loop should stop, because of a break or a return that is unwinding through it.
+static BOOL nu_loop_eval_body(id expressions, NSMutableDictionary *context, __strong id *result)
+{
+    while (expressions && (expressions != Nu__null)) {
+        id value = [[expressions car] evalWithContext:context];
+        int unwinding = nu_eval_stack.unwinding;
+        if (unwinding) {
+            if (unwinding == NuUnwindReturn)
+                return NO;
+            nu_eval_stack.unwinding = NuUnwindNone;
+            return (unwinding == NuUnwindContinue);
+        }
+        *result = value;
+        expressions = [expressions cdr];
+    }
+    return YES;
+}
+
 @interface Nu_while_operator : NuOperator {}
 @end
 
@@ -6390,18 +7849,18 @@ MAKE_HANDLER_WITH_TYPE(NSRange)
     id result = Nu__null;
     id test = [[cdr car] evalWithContext:context];
     while (nu_valueIsTrue(test)) {
+        NSUInteger evalDepth = nu_eval_depth();
         @try
         {
-            id expressions = [cdr cdr];
-            while (expressions && (expressions != Nu__null)) {
-                result = [[expressions car] evalWithContext:context];
-                expressions = [expressions cdr];
-            }
+            if (!nu_loop_eval_body([cdr cdr], context, &result))
+                break;
         }
         @catch (NuBreakException *exception) {
+            nu_eval_unwind(exception, evalDepth);
             break;
         }
         @catch (NuContinueException *exception) {
+            nu_eval_unwind(exception, evalDepth);
             // do nothing, just continue with the next loop iteration
         }
         @catch (id exception) {
@@ -6422,19 +7881,19 @@ MAKE_HANDLER_WITH_TYPE(NSRange)
 {
     id result = Nu__null;
     id test = [[cdr car] evalWithContext:context];
-    while (!nu_valueIsTrue(test)) {
+    while (!nu_valueIsTrue(test) && !nu_eval_stack.unwinding) {
+        NSUInteger evalDepth = nu_eval_depth();
         @try
         {
-            id expressions = [cdr cdr];
-            while (expressions && (expressions != Nu__null)) {
-                result = [[expressions car] evalWithContext:context];
-                expressions = [expressions cdr];
-            }
+            if (!nu_loop_eval_body([cdr cdr], context, &result))
+                break;
         }
         @catch (NuBreakException *exception) {
+            nu_eval_unwind(exception, evalDepth);
             break;
         }
         @catch (NuContinueException *exception) {
+            nu_eval_unwind(exception, evalDepth);
             // do nothing, just continue with the next loop iteration
         }
         @catch (id exception) {
@@ -6460,21 +7919,23 @@ MAKE_HANDLER_WITH_TYPE(NSRange)
     id loopincr = [[[controls cdr] cdr] car];
     // initialize the loop
     [loopinit evalWithContext:context];
+    if (nu_eval_stack.unwinding)
+        return result;
     // evaluate the loop condition
     id test = [looptest evalWithContext:context];
     while (nu_valueIsTrue(test)) {
+        NSUInteger evalDepth = nu_eval_depth();
         @try
         {
-            id expressions = [cdr cdr];
-            while (expressions && (expressions != Nu__null)) {
-                result = [[expressions car] evalWithContext:context];
-                expressions = [expressions cdr];
-            }
+            if (!nu_loop_eval_body([cdr cdr], context, &result))
+                break;
         }
         @catch (NuBreakException *exception) {
+            nu_eval_unwind(exception, evalDepth);
             break;
         }
         @catch (NuContinueException *exception) {
+            nu_eval_unwind(exception, evalDepth);
             // do nothing, just continue with the next loop iteration
         }
         @catch (id exception) {
@@ -6482,6 +7943,8 @@ MAKE_HANDLER_WITH_TYPE(NSRange)
         }
         // perform the end of loop increment step
         [loopincr evalWithContext:context];
+        if (nu_eval_stack.unwinding)
+            break;
         // evaluate the loop condition
         test = [looptest evalWithContext:context];
     }
@@ -6496,11 +7959,11 @@ MAKE_HANDLER_WITH_TYPE(NSRange)
 @implementation Nu_try_operator
 - (id) callWithArguments:(id)cdr context:(NSMutableDictionary *)context
 {
-    NuSymbolTable *symbolTable = [context objectForKey:SYMBOLS_KEY];
-    id catchSymbol = [symbolTable symbolWithString:@"catch"];
-    id finallySymbol = [symbolTable symbolWithString:@"finally"];
+    id catchSymbol = nu_catch_symbol;
+    id finallySymbol = nu_finally_symbol;
     id result = Nu__null;
     
+    NSUInteger evalDepth = nu_eval_depth();
     @try
     {
         // evaluate all the expressions that are outside catch and finally blocks
@@ -6519,6 +7982,7 @@ MAKE_HANDLER_WITH_TYPE(NSRange)
         }
     }
     @catch (id thrownObject) {
+        thrownObject = nu_eval_unwind(thrownObject, evalDepth);
         // evaluate all the expressions that are in catch blocks
         id expressions = cdr;
         while (expressions && (expressions != Nu__null)) {
@@ -6663,6 +8127,13 @@ MAKE_HANDLER_WITH_TYPE(NSRange)
 @interface Nu_quasiquote_operator : NuOperator {}
 @end
 
+// The value of the symbol at the head of a list, which is what quasiquote checks for its markers.
+static id nu_quasiquote_head_value(id list)
+{
+    id head = [list car];
+    return nu_objectIsKindOfClass(head, [NuSymbol class]) ? [head value] : nil;
+}
+
 @implementation Nu_quasiquote_operator
 
 - (id) evalQuasiquote:(id)cdr context:(NSMutableDictionary *)context
@@ -6691,12 +8162,12 @@ MAKE_HANDLER_WITH_TYPE(NSRange)
             QuasiLog(@"  quasiquote: null-list");
             value = Nu__null;
         }
-        else if ([[symbolTable lookup:[[[cursor car] car] stringValue]] value] == quasiquote_eval) {
+        else if (nu_quasiquote_head_value([cursor car]) == quasiquote_eval) {
             QuasiLog(@"quasiquote-eval: Evaling: [[cursor car] cdr]: %@", [[[cursor car] cdr] stringValue]);
             value = [[[cursor car] cdr] evalWithContext:context];
             QuasiLog(@"  quasiquote-eval: Value: %@", [value stringValue]);
         }
-        else if ([[symbolTable lookup:[[[cursor car] car] stringValue]] value] == quasiquote_splice) {
+        else if (nu_quasiquote_head_value([cursor car]) == quasiquote_splice) {
             QuasiLog(@"quasiquote-splice: Evaling: [[cursor car] cdr]: %@",
                      [[[cursor car] cdr] stringValue]);
             value = [[[cursor car] cdr] evalWithContext:context];
@@ -6710,18 +8181,15 @@ MAKE_HANDLER_WITH_TYPE(NSRange)
             id value_cursor = value;
             
             while (value_cursor && (value_cursor != Nu__null)) {
-                id value_item = [value_cursor car];
+                NuCell *next = [[NuCell alloc] initWithCar:[value_cursor car] cdr:Nu__null];
                 
                 if (result_cursor == Nu__null) {
-                    result_cursor = [[NuCell alloc] init];
-                    result = result_cursor;
+                    result = next;
                 }
                 else {
-                    [result_cursor setCdr: [[NuCell alloc] init]];
-                    result_cursor = [result_cursor cdr];
+                    [result_cursor setCdr:next];
                 }
-                
-                [result_cursor setCar: value_item];
+                result_cursor = next;
                 value_cursor = [value_cursor cdr];
             }
             
@@ -6739,16 +8207,14 @@ MAKE_HANDLER_WITH_TYPE(NSRange)
             QuasiLog(@"quasiquote: leaving recursive call with value: %@", [value stringValue]);
         }
         
+        NuCell *next = [[NuCell alloc] initWithCar:value cdr:Nu__null];
         if (result == Nu__null) {
-            result = [[NuCell alloc] init];
-            result_cursor = result;
+            result = next;
         }
         else {
-            [result_cursor setCdr:[[NuCell alloc] init]];
-            result_cursor = [result_cursor cdr];
+            [result_cursor setCdr:next];
         }
-        
-        [result_cursor setCar:value];
+        result_cursor = next;
         
         QuasiLog(@"quasiquote: result_cursor: %@", [result_cursor stringValue]);
         QuasiLog(@"quasiquote: result:        %@", [result stringValue]);
@@ -6810,26 +8276,20 @@ MAKE_HANDLER_WITH_TYPE(NSRange)
 @interface Nu_set_operator : NuOperator {}
 @end
 
-@implementation Nu_set_operator
-- (id) callWithArguments:(id)cdr context:(NSMutableDictionary *)context
+// Assign a value to a symbol the way the set operator does.
+static id nu_set_symbol_value(NuSymbol *symbol, id result, NSMutableDictionary *context)
 {
-    NuSymbol *symbol = [cdr car];
-    id value = [[cdr cdr] car];
-    id result = [value evalWithContext:context];
-    
     char c = (char) [[symbol stringValue] characterAtIndex:0];
     if (c == '$') {
         [symbol setValue:result];
     }
     else if (c == '@') {
-        NuSymbolTable *symbolTable = [context objectForKey:SYMBOLS_KEY];
-        id object = [context lookupObjectForKey:[symbolTable symbolWithString:@"self"]];
+        id object = [context lookupObjectForKey:nu_self_symbol];
         id ivar = [[symbol stringValue] substringFromIndex:1];
         [object setValue:result forIvar:ivar];
     }
     else {
-        NuSymbolTable *symbolTable = [context objectForKey:SYMBOLS_KEY];
-        id classSymbol = [symbolTable symbolWithString:@"_class"];
+        id classSymbol = nu_class_symbol;
         id searchContext = context;
         while (searchContext) {
             if ([searchContext objectForKey:symbol]) {
@@ -6846,6 +8306,15 @@ MAKE_HANDLER_WITH_TYPE(NSRange)
     return result;
 }
 
+@implementation Nu_set_operator
+- (id) callWithArguments:(id)cdr context:(NSMutableDictionary *)context
+{
+    NuSymbol *symbol = [cdr car];
+    id value = [[cdr cdr] car];
+    id result = [value evalWithContext:context];
+    return nu_set_symbol_value(symbol, result, context);
+}
+
 @end
 
 @interface Nu_local_operator : NuOperator {}
@@ -6993,16 +8462,15 @@ MAKE_HANDLER_WITH_TYPE(NSRange)
     id cursor = cdr;
     id result_cursor = Nu__null;
     while (cursor && (cursor != Nu__null)) {
+        id value = [[cursor car] evalWithContext:context];
+        NuCell *next = [[NuCell alloc] initWithCar:value cdr:Nu__null];
         if (result == Nu__null) {
-            result = [[NuCell alloc] init];
-            result_cursor = result;
+            result = next;
         }
         else {
-            [result_cursor setCdr:[[NuCell alloc] init]];
-            result_cursor = [result_cursor cdr];
+            [result_cursor setCdr:next];
         }
-        id value = [[cursor car] evalWithContext:context];
-        [result_cursor setCar:value];
+        result_cursor = next;
         cursor = [cursor cdr];
     }
     return result;
@@ -7016,11 +8484,10 @@ MAKE_HANDLER_WITH_TYPE(NSRange)
 @implementation Nu_add_operator
 - (id) callWithArguments:(id)cdr context:(NSMutableDictionary *)context
 {
-    NuSymbolTable *symbolTable = [context objectForKey:SYMBOLS_KEY];
-    if ([context objectForKey:[symbolTable symbolWithString:@"_class"]] && ![context objectForKey:[symbolTable symbolWithString:@"_method"]]) {
+    if ([context objectForKey:nu_class_symbol] && ![context objectForKey:nu_method_symbol]) {
         // we are inside a class declaration and outside a method declaration.
         // treat this as a "cmethod" call
-        NuClass *classWrapper = [context objectForKey:[symbolTable symbolWithString:@"_class"]];
+        NuClass *classWrapper = [context objectForKey:nu_class_symbol];
         [classWrapper registerClass];
         Class classToExtend = [classWrapper wrappedClass];
         return help_add_method_to_class(classToExtend, cdr, context, YES);
@@ -7034,7 +8501,7 @@ MAKE_HANDLER_WITH_TYPE(NSRange)
             sum += [[[cursor car] evalWithContext:context] doubleValue];
             cursor = [cursor cdr];
         }
-        return [NSNumber numberWithDouble:sum];
+        return nu_number(sum);
     }
     else {
         NSMutableString *result = [NSMutableString stringWithString:[firstArgument stringValue]];
@@ -7064,7 +8531,7 @@ MAKE_HANDLER_WITH_TYPE(NSRange)
         product *= [[[cursor car] evalWithContext:context] doubleValue];
         cursor = [cursor cdr];
     }
-    return [NSNumber numberWithDouble:product];
+    return nu_number(product);
 }
 
 @end
@@ -7075,11 +8542,10 @@ MAKE_HANDLER_WITH_TYPE(NSRange)
 @implementation Nu_subtract_operator
 - (id) callWithArguments:(id)cdr context:(NSMutableDictionary *)context
 {
-    NuSymbolTable *symbolTable = [context objectForKey:SYMBOLS_KEY];
-    if ([context objectForKey:[symbolTable symbolWithString:@"_class"]] && ![context objectForKey:[symbolTable symbolWithString:@"_method"]]) {
+    if ([context objectForKey:nu_class_symbol] && ![context objectForKey:nu_method_symbol]) {
         // we are inside a class declaration and outside a method declaration.
         // treat this as an "imethod" call
-        NuClass *classWrapper = [context objectForKey:[symbolTable symbolWithString:@"_class"]];
+        NuClass *classWrapper = [context objectForKey:nu_class_symbol];
         [classWrapper registerClass];
         Class classToExtend = [classWrapper wrappedClass];
         return help_add_method_to_class(classToExtend, cdr, context, NO);
@@ -7099,7 +8565,7 @@ MAKE_HANDLER_WITH_TYPE(NSRange)
             cursor = [cursor cdr];
         }
     }
-    return [NSNumber numberWithDouble:sum];
+    return nu_number(sum);
 }
 
 @end
@@ -7135,7 +8601,7 @@ MAKE_HANDLER_WITH_TYPE(NSRange)
         product /= [[[cursor car] evalWithContext:context] doubleValue];
         cursor = [cursor cdr];
     }
-    return [NSNumber numberWithDouble:product];
+    return nu_number(product);
 }
 
 @end
@@ -7200,7 +8666,6 @@ MAKE_HANDLER_WITH_TYPE(NSRange)
 @implementation Nu_greaterthan_operator
 - (id) callWithArguments:(id)cdr context:(NSMutableDictionary *)context
 {
-    NuSymbolTable *symbolTable = [context objectForKey:SYMBOLS_KEY];
     id cursor = cdr;
     id current = [[cursor car] evalWithContext:context];
     cursor = [cursor cdr];
@@ -7212,7 +8677,7 @@ MAKE_HANDLER_WITH_TYPE(NSRange)
         current = next;
         cursor = [cursor cdr];
     }
-    return [symbolTable symbolWithString:@"t"];
+    return nu_t_symbol;
 }
 
 @end
@@ -7223,7 +8688,6 @@ MAKE_HANDLER_WITH_TYPE(NSRange)
 @implementation Nu_lessthan_operator
 - (id) callWithArguments:(id)cdr context:(NSMutableDictionary *)context
 {
-    NuSymbolTable *symbolTable = [context objectForKey:SYMBOLS_KEY];
     id cursor = cdr;
     id current = [[cursor car] evalWithContext:context];
     cursor = [cursor cdr];
@@ -7235,7 +8699,7 @@ MAKE_HANDLER_WITH_TYPE(NSRange)
         current = next;
         cursor = [cursor cdr];
     }
-    return [symbolTable symbolWithString:@"t"];
+    return nu_t_symbol;
 }
 
 @end
@@ -7246,7 +8710,6 @@ MAKE_HANDLER_WITH_TYPE(NSRange)
 @implementation Nu_gte_operator
 - (id) callWithArguments:(id)cdr context:(NSMutableDictionary *)context
 {
-    NuSymbolTable *symbolTable = [context objectForKey:SYMBOLS_KEY];
     id cursor = cdr;
     id current = [[cursor car] evalWithContext:context];
     cursor = [cursor cdr];
@@ -7258,7 +8721,7 @@ MAKE_HANDLER_WITH_TYPE(NSRange)
         current = next;
         cursor = [cursor cdr];
     }
-    return [symbolTable symbolWithString:@"t"];
+    return nu_t_symbol;
 }
 
 @end
@@ -7269,7 +8732,6 @@ MAKE_HANDLER_WITH_TYPE(NSRange)
 @implementation Nu_lte_operator
 - (id) callWithArguments:(id)cdr context:(NSMutableDictionary *)context
 {
-    NuSymbolTable *symbolTable = [context objectForKey:SYMBOLS_KEY];
     id cursor = cdr;
     id current = [[cursor car] evalWithContext:context];
     cursor = [cursor cdr];
@@ -7281,7 +8743,7 @@ MAKE_HANDLER_WITH_TYPE(NSRange)
         current = next;
         cursor = [cursor cdr];
     }
-    return [symbolTable symbolWithString:@"t"];
+    return nu_t_symbol;
 }
 
 @end
@@ -7355,11 +8817,10 @@ MAKE_HANDLER_WITH_TYPE(NSRange)
 @implementation Nu_not_operator
 - (id) callWithArguments:(id)cdr context:(NSMutableDictionary *)context
 {
-    NuSymbolTable *symbolTable = [context objectForKey:SYMBOLS_KEY];
     id cursor = cdr;
     if (cursor && (cursor != Nu__null)) {
         id value = [[cursor car] evalWithContext:context];
-        return nu_valueIsTrue(value) ? Nu__null : [symbolTable symbolWithString:@"t"];
+        return nu_valueIsTrue(value) ? Nu__null : nu_t_symbol;
     }
     return Nu__null;
 }
@@ -7488,11 +8949,16 @@ MAKE_HANDLER_WITH_TYPE(NSRange)
 @implementation Nu_progn_operator
 - (id) callWithArguments:(id)cdr context:(NSMutableDictionary *)context
 {
+    BOOL tail = nu_eval_stack.tailPosition;
+    nu_eval_stack.tailPosition = NO;
     id value = Nu__null;
     id cursor = cdr;
     while (cursor && (cursor != Nu__null)) {
-        value = [[cursor car] evalWithContext:context];
-        cursor = [cursor cdr];
+        id next = [cursor cdr];
+        value = nu_eval_tail([cursor car], context, tail && !IS_NOT_NULL(next));
+        if (nu_eval_stack.unwinding)
+            break;
+        cursor = next;
     }
     return value;
 }
@@ -7862,6 +9328,96 @@ MAKE_HANDLER_WITH_TYPE(NSRange)
 
 @end
 
+#pragma mark - Unwinding
+
+enum {
+    NuUnwindOpaque,                 // anything else, which break, continue and return must throw through
+    NuUnwindPasses,                 // a control operator that checks for unwinding after each expression
+    NuUnwindLoop
+};
+
+// How an operator treats unwinding.
+static int nu_operator_role(id operator)
+{
+    Class operatorClass = object_getClass(operator);
+    if (   (operatorClass == [Nu_while_operator class])
+        || (operatorClass == [Nu_until_operator class])
+        || (operatorClass == [Nu_for_operator class]))
+        return NuUnwindLoop;
+    if (   (operatorClass == [Nu_if_operator class])
+        || (operatorClass == [Nu_unless_operator class])
+        || (operatorClass == [Nu_cond_operator class])
+        || (operatorClass == [Nu_case_operator class])
+        || (operatorClass == [Nu_progn_operator class]))
+        return NuUnwindPasses;
+    return NuUnwindOpaque;
+}
+
+// How an expression on the evaluation stack treats unwinding.
+static int nu_unwind_role(NuCell *cell)
+{
+    id head = [cell car];
+    if (!nu_objectIsKindOfClass(head, [NuSymbol class]))
+        return NuUnwindOpaque;
+    return nu_operator_role([head value]);
+}
+
+// The operators that pass unwinding on also pass tail position on to their last expressions.
+static BOOL nu_operator_passes_tail(id operator)
+{
+    return nu_operator_role(operator) == NuUnwindPasses;
+}
+
+static BOOL nu_list_contains_object(id list, id object)
+{
+    for (id cursor = list; cursor && (cursor != Nu__null); cursor = [cursor cdr]) {
+        if ([cursor car] == object)
+            return YES;
+    }
+    return NO;
+}
+
+// Try to signal a break, continue or return from the expression being evaluated
+// by setting the evaluation stack's unwinding field. This works when the expressions
+// between it and its target are all control operators that will pass it on.
+// A break or continue is for the innermost loop that it is in the body of,
+// and a return is for the innermost block. Returns NO if the caller must throw instead.
+static BOOL nu_unwind_signal(int unwinding, id value)
+{
+    NSUInteger depth = nu_eval_stack.depth;
+    if (depth == 0)
+        return NO;
+    NSUInteger blockDepth = nu_eval_stack.blockMark ? nu_eval_stack.blockMark - 1 : 0;
+    // the signalling expression itself is at depth - 1
+    for (NSUInteger i = depth - 1; i > blockDepth; i--) {
+        NuCell *cell = nu_eval_stack.cells[i-1];
+        int role = nu_unwind_role(cell);
+        if (role == NuUnwindOpaque)
+            return NO;
+        if ((role == NuUnwindLoop) && (unwinding != NuUnwindReturn)) {
+            // a break in a loop's test or step is for an outer loop, which the exception finds
+            if (!nu_list_contains_object([[cell cdr] cdr], nu_eval_stack.cells[i]))
+                return NO;
+            nu_eval_stack.unwinding = unwinding;
+            return YES;
+        }
+    }
+    if ((unwinding != NuUnwindReturn) || !nu_eval_stack.blockMark)
+        return NO;
+    nu_eval_stack.returnValue = value ? (void *) CFBridgingRetain(value) : NULL;
+    nu_eval_stack.unwinding = unwinding;
+    return YES;
+}
+
+// Called by a block when a return has unwound to it.
+static id nu_unwind_take_return_value(void)
+{
+    void *value = nu_eval_stack.returnValue;
+    nu_eval_stack.returnValue = NULL;
+    nu_eval_stack.unwinding = NuUnwindNone;
+    return value ? CFBridgingRelease(value) : nil;
+}
+
 @interface Nu_break_operator : NuOperator {}
 @end
 
@@ -7869,6 +9425,8 @@ MAKE_HANDLER_WITH_TYPE(NSRange)
 
 - (id) callWithArguments:(id)cdr context:(NSMutableDictionary *)context
 {
+    if (nu_unwind_signal(NuUnwindBreak, nil))
+        return Nu__null;
     @throw [[NuBreakException alloc] init];
     return nil;                                   // unreached
 }
@@ -7882,6 +9440,8 @@ MAKE_HANDLER_WITH_TYPE(NSRange)
 
 - (id) callWithArguments:(id)cdr context:(NSMutableDictionary *)context
 {
+    if (nu_unwind_signal(NuUnwindContinue, nil))
+        return Nu__null;
     @throw [[NuContinueException alloc] init];
     return nil;                                   // unreached
 }
@@ -7899,6 +9459,8 @@ MAKE_HANDLER_WITH_TYPE(NSRange)
     if (cdr && cdr != Nu__null) {
         value = [[cdr car] evalWithContext:context];
     }
+    if (nu_unwind_signal(NuUnwindReturn, value))
+        return Nu__null;
     @throw [[NuReturnException alloc] initWithValue:value];
     return nil;                                   // unreached
 }
@@ -8060,11 +9622,743 @@ static id evaluatedArguments(id cdr, NSMutableDictionary *context)
 
 #define install(name, class) [(NuSymbol *) [symbolTable symbolWithString:name] setValue:[[class alloc] init]]
 
-void load_builtins(NuSymbolTable *symbolTable);
+#pragma mark - Bytecode
+
+// Instructions of the bytecode that block bodies can be compiled to.
+// Operands follow their opcodes in the code array. k is an index into the constants.
+enum {
+    NU_OP_CONST,                    // k: push constant k
+    NU_OP_EVAL,                     // k: push the result of evaluating constant k
+    NU_OP_LOAD_SLOT,                // slot k: push the frame slot, or the value of symbol k if it's unset
+    NU_OP_SET,                      // k: set symbol k to the top value
+    NU_OP_SET_SLOT,                 // slot k: the same, storing directly in the frame slot if it's set
+    NU_OP_LOCAL,                    // k: bind symbol k to the top value in the frame
+    NU_OP_LOCAL_SLOT,               // slot: bind the frame slot to the top value
+    NU_OP_POP,
+    NU_OP_SET_STACK,                // n: pop the top value into stack position n
+    NU_OP_LOOP,                     // break continue start end: enter a loop whose body runs from start to end
+    NU_OP_END_LOOP,                 // leave the innermost loop
+    NU_OP_JUMP,                     // target
+    NU_OP_JUMP_IF_FALSE,            // target: pop, and jump if the value was false
+    NU_OP_JUMP_IF_TRUE,             // target: pop, and jump if the value was true
+    NU_OP_JUMP_IF_TRUE_KEEP,        // target: jump if the top value is true, otherwise pop it
+    NU_OP_JUMP_UNLESS_KEEP_NULL,    // target: if the top value is false, replace it with null and jump
+    NU_OP_JUMP_UNLESS_POP,          // target: if the top value is false, pop it and jump
+    NU_OP_GUARD,                    // k v target: jump unless the global value of symbol k is still constant v
+    NU_OP_NOT,
+    NU_OP_ADD,
+    NU_OP_SUBTRACT,
+    NU_OP_MULTIPLY,
+    NU_OP_DIVIDE,
+    NU_OP_GREATERTHAN,
+    NU_OP_LESSTHAN,
+    NU_OP_GTE,
+    NU_OP_LTE,
+    NU_OP_EQ,
+    NU_OP_NEQ,
+    NU_OP_RETURN
+};
 
-void load_builtins(NuSymbolTable *symbolTable)
+#define NU_BYTECODE_STACK_SIZE 32
+// Loops nested more deeply than this are left to the interpreter.
+#define NU_BYTECODE_LOOP_DEPTH 8
+
+/*!
+ @class NuBytecode
+ @abstract Internal class for the compiled body of a block.
+ @discussion Blocks whose bodies are made from core operators can be compiled
+ to a compact stack bytecode. The operators are progn, if, unless, cond, while,
+ for, and, or, not, set and local, plus two-operand arithmetic and
+ comparisons. Names bound in the block's frame are read and written through its slots.
+ Any other expression, including macros and message sends, is kept as
+ an instruction that evaluates it, so it runs the same as it would when interpreted.
+ 
+ Operators are recognized by the global values of their names when the block is compiled.
+ Arithmetic and comparisons also check that value each time they run.
+ Loops whose bodies mention break or continue are left to the interpreter.
+ A compiled loop still catches the break and continue exceptions thrown by
+ functions called from its body, as the interpreter's loops do: while a loop
+ is running, its targets are kept in a small table that nu_bytecode_run
+ searches when it catches one.
+ */
+@interface NuBytecode : NSObject
 {
-    [(NuSymbol *) [symbolTable symbolWithString:@"t"] setValue:[symbolTable symbolWithString:@"t"]];
+@public
+    int *code;
+    NSUInteger count;
+    NSUInteger capacity;
+    NSMutableArray *constantList;
+    __unsafe_unretained id *constants;
+    int depth;
+    int maxDepth;
+    int loopDepth;
+    int maxLoopDepth;
+    __unsafe_unretained NuBlock *block;
+}
+@end
+
+@implementation NuBytecode
+
+- (id) initWithBlock:(NuBlock *) b
+{
+    if ((self = [super init])) {
+        block = b;
+        capacity = 64;
+        code = (int *) malloc(capacity * sizeof(int));
+        constantList = [[NSMutableArray alloc] init];
+    }
+    return self;
+}
+
+- (void) dealloc
+{
+    free(code);
+    free(constants);
+}
+
+- (void) emit:(int) word
+{
+    if (count == capacity) {
+        capacity *= 2;
+        code = (int *) realloc(code, capacity * sizeof(int));
+    }
+    code[count++] = word;
+}
+
+- (int) constant:(id) object
+{
+    if (!object)
+        object = Nu__null;
+    NSUInteger index = [constantList indexOfObjectIdenticalTo:object];
+    if (index == NSNotFound) {
+        index = [constantList count];
+        [constantList addObject:object];
+    }
+    return (int) index;
+}
+
+- (void) push:(int) n
+{
+    depth += n;
+    if (depth > maxDepth)
+        maxDepth = depth;
+}
+
+// Emit a jump and return the position of its target, to be patched later.
+- (NSUInteger) jump:(int) opcode
+{
+    [self emit:opcode];
+    [self emit:-1];
+    return count - 1;
+}
+
+- (void) patch:(NSUInteger) position
+{
+    code[position] = (int) count;
+}
+
+- (NSUInteger) slotForSymbol:(id) symbol
+{
+    for (NSUInteger i = 0; i < block->slotCount; i++)
+        if (block->slotSymbols[i] == symbol)
+            return i;
+    return NSNotFound;
+}
+
+// The builtin operator a list head names, if it isn't bound in the block's frame.
+- (id) operatorForHead:(id) head
+{
+    if (!nu_objectIsKindOfClass(head, [NuSymbol class]) || ([self slotForSymbol:head] != NSNotFound))
+        return nil;
+    id value = [head value];
+    return nu_objectIsKindOfClass(value, [NuOperator class]) ? value : nil;
+}
+
+- (void) compileEval:(id) expression
+{
+    [self emit:NU_OP_EVAL];
+    [self emit:[self constant:expression]];
+    [self push:1];
+}
+
+// Compile a sequence of expressions, leaving the value of the last one (or null).
+- (void) compileSequence:(id) list
+{
+    if (!nu_objectIsKindOfClass(list, [NuCell class])) {
+        [self emit:NU_OP_CONST];
+        [self emit:[self constant:Nu__null]];
+        [self push:1];
+        return;
+    }
+    BOOL first = YES;
+    while (nu_objectIsKindOfClass(list, [NuCell class])) {
+        if (!first) {
+            [self emit:NU_OP_POP];
+            [self push:-1];
+        }
+        [self compileExpression:[list car]];
+        first = NO;
+        list = [list cdr];
+    }
+}
+
+- (void) compileExpression:(id) expression
+{
+    if (nu_objectIsKindOfClass(expression, [NuSymbol class])) {
+        NSUInteger slot = [self slotForSymbol:expression];
+        if (slot != NSNotFound) {
+            [self emit:NU_OP_LOAD_SLOT];
+            [self emit:(int) slot];
+            [self emit:[self constant:expression]];
+            [self push:1];
+        }
+        else {
+            [self compileEval:expression];
+        }
+        return;
+    }
+    if (!nu_objectIsKindOfClass(expression, [NuCell class])) {
+        if (nu_objectIsKindOfClass(expression, [NSNumber class]) || !expression || (expression == Nu__null)) {
+            [self emit:NU_OP_CONST];
+            [self emit:[self constant:expression]];
+            [self push:1];
+        }
+        else {
+            [self compileEval:expression];
+        }
+        return;
+    }
+    
+    id head = [expression car];
+    id args = [expression cdr];
+    NSUInteger argc = [args length];
+    id operator = [self operatorForHead:head];
+    Class operatorClass = operator ? object_getClass(operator) : Nil;
+    if (!operatorClass) {
+        [self compileEval:expression];
+    }
+    else if (operatorClass == [Nu_progn_operator class]) {
+        [self compileSequence:args];
+    }
+    else if ((operatorClass == [Nu_if_operator class]) || (operatorClass == [Nu_unless_operator class])) {
+        [self compileIf:expression flipped:(operatorClass == [Nu_unless_operator class])];
+    }
+    else if (operatorClass == [Nu_cond_operator class]) {
+        [self compileCond:expression];
+    }
+    else if ((operatorClass == [Nu_while_operator class]) && (argc >= 1)
+             && (loopDepth < NU_BYTECODE_LOOP_DEPTH)
+             && !nu_list_mentions_symbol(args, nu_break_symbol, nu_continue_symbol)) {
+        NSUInteger loop = [self beginLoop];
+        NSUInteger top = count;
+        [self compileExpression:[args car]];
+        NSUInteger exit = [self jump:NU_OP_JUMP_IF_FALSE];
+        [self push:-1];
+        NSUInteger start = count;
+        [self compileLoopBody:[args cdr]];
+        NSUInteger end = count;
+        [self emit:NU_OP_JUMP];
+        [self emit:(int) top];
+        [self patch:exit];
+        [self endLoop:loop continueAt:top start:start end:end];
+    }
+    else if ((operatorClass == [Nu_for_operator class]) && (argc >= 1)
+             && (loopDepth < NU_BYTECODE_LOOP_DEPTH)
+             && nu_objectIsKindOfClass([args car], [NuCell class]) && ([[args car] length] == 3)
+             && !nu_list_mentions_symbol(args, nu_break_symbol, nu_continue_symbol)) {
+        id controls = [args car];
+        [self compileExpression:[controls car]];
+        [self emit:NU_OP_POP];
+        [self push:-1];
+        NSUInteger loop = [self beginLoop];
+        NSUInteger top = count;
+        [self compileExpression:[[controls cdr] car]];
+        NSUInteger exit = [self jump:NU_OP_JUMP_IF_FALSE];
+        [self push:-1];
+        NSUInteger start = count;
+        [self compileLoopBody:[args cdr]];
+        NSUInteger step = count;
+        [self compileExpression:[[[controls cdr] cdr] car]];
+        [self emit:NU_OP_POP];
+        [self push:-1];
+        [self emit:NU_OP_JUMP];
+        [self emit:(int) top];
+        [self patch:exit];
+        [self endLoop:loop continueAt:step start:start end:step];
+    }
+    else if (operatorClass == [Nu_and_operator class]) {
+        [self emit:NU_OP_CONST];
+        [self emit:[self constant:Nu__null]];
+        [self push:1];
+        NSMutableArray *exits = [NSMutableArray array];
+        for (id cursor = args; nu_objectIsKindOfClass(cursor, [NuCell class]); cursor = [cursor cdr]) {
+            [self emit:NU_OP_POP];
+            [self push:-1];
+            [self compileExpression:[cursor car]];
+            [exits addObject:@([self jump:NU_OP_JUMP_UNLESS_KEEP_NULL])];
+        }
+        for (NSNumber *exit in exits)
+            [self patch:[exit unsignedIntegerValue]];
+    }
+    else if (operatorClass == [Nu_or_operator class]) {
+        NSMutableArray *exits = [NSMutableArray array];
+        for (id cursor = args; nu_objectIsKindOfClass(cursor, [NuCell class]); cursor = [cursor cdr]) {
+            [self compileExpression:[cursor car]];
+            [exits addObject:@([self jump:NU_OP_JUMP_IF_TRUE_KEEP])];
+            [self push:-1];
+        }
+        [self emit:NU_OP_CONST];
+        [self emit:[self constant:Nu__null]];
+        [self push:1];
+        for (NSNumber *exit in exits)
+            [self patch:[exit unsignedIntegerValue]];
+    }
+    else if ((operatorClass == [Nu_not_operator class]) && (argc >= 1)) {
+        [self compileExpression:[args car]];
+        [self emit:NU_OP_NOT];
+    }
+    else if (((operatorClass == [Nu_set_operator class]) || (operatorClass == [Nu_local_operator class]))
+             && (argc >= 1) && nu_objectIsKindOfClass([args car], [NuSymbol class])) {
+        id symbol = [args car];
+        BOOL isSet = (operatorClass == [Nu_set_operator class]);
+        NSUInteger slot = [self slotForSymbol:symbol];
+        [self compileExpression:[[args cdr] car]];
+        if (slot != NSNotFound) {
+            [self emit:(isSet ? NU_OP_SET_SLOT : NU_OP_LOCAL_SLOT)];
+            [self emit:(int) slot];
+            if (isSet)
+                [self emit:[self constant:symbol]];
+        }
+        else {
+            [self emit:(isSet ? NU_OP_SET : NU_OP_LOCAL)];
+            [self emit:[self constant:symbol]];
+        }
+    }
+    else if (argc == 2) {
+        int opcode = -1;
+        if (operatorClass == [Nu_add_operator class]) opcode = NU_OP_ADD;
+        else if (operatorClass == [Nu_subtract_operator class]) opcode = NU_OP_SUBTRACT;
+        else if (operatorClass == [Nu_multiply_operator class]) opcode = NU_OP_MULTIPLY;
+        else if (operatorClass == [Nu_divide_operator class]) opcode = NU_OP_DIVIDE;
+        else if (operatorClass == [Nu_greaterthan_operator class]) opcode = NU_OP_GREATERTHAN;
+        else if (operatorClass == [Nu_lessthan_operator class]) opcode = NU_OP_LESSTHAN;
+        else if (operatorClass == [Nu_gte_operator class]) opcode = NU_OP_GTE;
+        else if (operatorClass == [Nu_lte_operator class]) opcode = NU_OP_LTE;
+        else if (operatorClass == [Nu_eq_operator class]) opcode = NU_OP_EQ;
+        else if (operatorClass == [Nu_neq_operator class]) opcode = NU_OP_NEQ;
+        // in a class body, + and - declare methods
+        if ((opcode == NU_OP_ADD) || (opcode == NU_OP_SUBTRACT)) {
+            NSMutableDictionary *context = [block context];
+            if ([context objectForKey:nu_class_symbol] && ![context objectForKey:nu_method_symbol])
+                opcode = -1;
+        }
+        if (opcode < 0) {
+            [self compileEval:expression];
+            return;
+        }
+        // if the operator has been redefined, evaluate the expression instead
+        [self emit:NU_OP_GUARD];
+        [self emit:[self constant:head]];
+        [self emit:[self constant:operator]];
+        NSUInteger generic = count;
+        [self emit:-1];
+        [self compileExpression:[args car]];
+        [self compileExpression:[[args cdr] car]];
+        [self emit:opcode];
+        [self push:-1];
+        NSUInteger done = [self jump:NU_OP_JUMP];
+        [self patch:generic];
+        [self push:-1];
+        [self compileEval:expression];
+        [self patch:done];
+    }
+    else {
+        [self compileEval:expression];
+    }
+}
+
+// Start a loop, pushing the null it returns if its body never runs.
+// Returns the position of the NU_OP_LOOP operands, to be filled in by -endLoop:...
+- (NSUInteger) beginLoop
+{
+    [self emit:NU_OP_CONST];
+    [self emit:[self constant:Nu__null]];
+    [self push:1];
+    [self emit:NU_OP_LOOP];
+    NSUInteger operands = count;
+    for (int i = 0; i < 4; i++)
+        [self emit:-1];
+    if (++loopDepth > maxLoopDepth)
+        maxLoopDepth = loopDepth;
+    return operands;
+}
+
+// Compile a loop body so that the value of each expression replaces the loop's value
+// as soon as it is known. A break leaves the loop with the last one, as it does when interpreted.
+- (void) compileLoopBody:(id) list
+{
+    int result = depth - 1;
+    for (; nu_objectIsKindOfClass(list, [NuCell class]); list = [list cdr]) {
+        [self compileExpression:[list car]];
+        [self emit:NU_OP_SET_STACK];
+        [self emit:result];
+        [self push:-1];
+    }
+}
+
+// End a loop at the current position, which a break jumps to.
+- (void) endLoop:(NSUInteger) operands continueAt:(NSUInteger) next start:(NSUInteger) start end:(NSUInteger) end
+{
+    code[operands] = (int) count;
+    code[operands + 1] = (int) next;
+    code[operands + 2] = (int) start;
+    code[operands + 3] = (int) end;
+    [self emit:NU_OP_END_LOOP];
+    loopDepth--;
+}
+
+- (void) compileIf:(id) expression flipped:(BOOL) flipped
+{
+    id clauses = [[expression cdr] cdr];
+    // a bare else switches branches part way through the list; leave that to the interpreter
+    for (id cursor = clauses; nu_objectIsKindOfClass(cursor, [NuCell class]); cursor = [cursor cdr]) {
+        if ([cursor car] == nu_else_symbol) {
+            [self compileEval:expression];
+            return;
+        }
+    }
+    [self compileExpression:[[expression cdr] car]];
+    NSUInteger otherwise = [self jump:(flipped ? NU_OP_JUMP_IF_TRUE : NU_OP_JUMP_IF_FALSE)];
+    [self push:-1];
+    for (int branch = 0; branch < 2; branch++) {
+        [self emit:NU_OP_CONST];
+        [self emit:[self constant:Nu__null]];
+        [self push:1];
+        for (id cursor = clauses; nu_objectIsKindOfClass(cursor, [NuCell class]); cursor = [cursor cdr]) {
+            id clause = [cursor car];
+            BOOL isElse = nu_objectIsKindOfClass(clause, [NuCell class]) && ([clause car] == nu_else_symbol);
+            if (isElse == (branch == 1)) {
+                [self emit:NU_OP_POP];
+                [self push:-1];
+                [self compileExpression:clause];
+            }
+        }
+        if (branch == 0) {
+            NSUInteger done = [self jump:NU_OP_JUMP];
+            [self patch:otherwise];
+            [self push:-1];
+            otherwise = done;
+        }
+    }
+    [self patch:otherwise];
+}
+
+- (void) compileCond:(id) expression
+{
+    for (id pairs = [expression cdr]; nu_objectIsKindOfClass(pairs, [NuCell class]); pairs = [pairs cdr]) {
+        if (!nu_objectIsKindOfClass([pairs car], [NuCell class])) {
+            [self compileEval:expression];
+            return;
+        }
+    }
+    NSMutableArray *exits = [NSMutableArray array];
+    for (id pairs = [expression cdr]; nu_objectIsKindOfClass(pairs, [NuCell class]); pairs = [pairs cdr]) {
+        id pair = [pairs car];
+        [self compileExpression:[pair car]];
+        NSUInteger next = [self jump:NU_OP_JUMP_UNLESS_POP];
+        for (id cursor = [pair cdr]; nu_objectIsKindOfClass(cursor, [NuCell class]); cursor = [cursor cdr]) {
+            [self emit:NU_OP_POP];
+            [self push:-1];
+            [self compileExpression:[cursor car]];
+        }
+        [exits addObject:@([self jump:NU_OP_JUMP])];
+        [self patch:next];
+        [self push:-1];
+    }
+    [self emit:NU_OP_CONST];
+    [self emit:[self constant:Nu__null]];
+    [self push:1];
+    for (NSNumber *exit in exits)
+        [self patch:[exit unsignedIntegerValue]];
+}
+
+@end
+
+static NuBytecode *nu_compile_block(NuBlock *block)
+{
+    NuBytecode *bytecode = [[NuBytecode alloc] initWithBlock:block];
+    [bytecode compileSequence:[block body]];
+    [bytecode emit:NU_OP_RETURN];
+    if (bytecode->maxDepth > NU_BYTECODE_STACK_SIZE)
+        return nil;
+    NSUInteger n = [bytecode->constantList count];
+    bytecode->constants = (__unsafe_unretained id *) malloc((n + 1) * sizeof(id));
+    [bytecode->constantList getObjects:bytecode->constants range:NSMakeRange(0, n)];
+    return bytecode;
+}
+
+// A compiled loop that is running.
+typedef struct {
+    int breakTarget;
+    int continueTarget;
+    int start, end;                 // the body
+    int sp;                         // the stack depth with the loop's value on top
+} NuBytecodeLoop;
+
+// Where a run of compiled code is, so that it can be resumed after a break or continue.
+typedef struct {
+    int pc;                         // the next instruction, or while evaluating, the NU_OP_EVAL
+    int sp;
+    int loopCount;
+    NuBytecodeLoop *loops;
+} NuBytecodeState;
+
+// Whether the instruction at pc returns, directly or after jumps, as at the end of an if or cond branch.
+static inline BOOL nu_bytecode_returns_at(const int *code, int pc)
+{
+    while (code[pc] == NU_OP_JUMP)
+        pc = code[pc+1];
+    return code[pc] == NU_OP_RETURN;
+}
+
+static id nu_bytecode_execute(NuBytecode *bytecode, NuFrame *frame, __strong id *stack, NuBytecodeState *state)
+{
+    int sp = state->sp;
+    const int *code = bytecode->code;
+    __unsafe_unretained id *constants = bytecode->constants;
+    __strong id *values = frame->values;
+    int pc = state->pc;
+    while (1) {
+        switch (code[pc++]) {
+            case NU_OP_CONST:
+                stack[sp++] = constants[code[pc++]];
+                break;
+            case NU_OP_EVAL:
+            {
+                state->pc = pc - 1;
+                id expression = constants[code[pc++]];
+                // an expression followed by a return is in tail position
+                stack[sp++] = nu_eval_tail(expression, frame, nu_bytecode_returns_at(code, pc));
+                // a return unwinding from the expression leaves the rest of the body
+                if (nu_eval_stack.unwinding)
+                    return Nu__null;
+                break;
+            }
+            case NU_OP_LOAD_SLOT:
+            {
+                id value = values[code[pc]];
+                stack[sp++] = value ? value : [constants[code[pc+1]] evalWithContext:frame];
+                pc += 2;
+                break;
+            }
+            case NU_OP_SET:
+                nu_set_symbol_value(constants[code[pc++]], stack[sp-1], frame);
+                break;
+            case NU_OP_SET_SLOT:
+            {
+                int slot = code[pc];
+                if (values[slot])
+                    values[slot] = stack[sp-1] ? stack[sp-1] : Nu__null;
+                else
+                    nu_set_symbol_value(constants[code[pc+1]], stack[sp-1], frame);
+                pc += 2;
+                break;
+            }
+            case NU_OP_LOCAL:
+                [frame setPossiblyNullObject:stack[sp-1] forKey:constants[code[pc++]]];
+                break;
+            case NU_OP_LOCAL_SLOT:
+                values[code[pc++]] = stack[sp-1] ? stack[sp-1] : Nu__null;
+                break;
+            case NU_OP_POP:
+                stack[--sp] = nil;
+                break;
+            case NU_OP_SET_STACK:
+                stack[code[pc++]] = stack[--sp];
+                stack[sp] = nil;
+                break;
+            case NU_OP_LOOP:
+            {
+                NuBytecodeLoop *loop = &state->loops[state->loopCount++];
+                loop->breakTarget = code[pc];
+                loop->continueTarget = code[pc+1];
+                loop->start = code[pc+2];
+                loop->end = code[pc+3];
+                loop->sp = sp;
+                pc += 4;
+                break;
+            }
+            case NU_OP_END_LOOP:
+                state->loopCount--;
+                break;
+            case NU_OP_JUMP:
+                pc = code[pc];
+                break;
+            case NU_OP_JUMP_IF_FALSE:
+            case NU_OP_JUMP_IF_TRUE:
+            {
+                BOOL jumpIfTrue = (code[pc-1] == NU_OP_JUMP_IF_TRUE);
+                BOOL isTrue = nu_valueIsTrue(stack[--sp]);
+                stack[sp] = nil;
+                pc = (isTrue == jumpIfTrue) ? code[pc] : pc + 1;
+                break;
+            }
+            case NU_OP_JUMP_IF_TRUE_KEEP:
+                if (nu_valueIsTrue(stack[sp-1])) {
+                    pc = code[pc];
+                }
+                else {
+                    stack[--sp] = nil;
+                    pc++;
+                }
+                break;
+            case NU_OP_JUMP_UNLESS_KEEP_NULL:
+                if (!nu_valueIsTrue(stack[sp-1])) {
+                    stack[sp-1] = Nu__null;
+                    pc = code[pc];
+                }
+                else {
+                    pc++;
+                }
+                break;
+            case NU_OP_JUMP_UNLESS_POP:
+                if (!nu_valueIsTrue(stack[sp-1])) {
+                    stack[--sp] = nil;
+                    pc = code[pc];
+                }
+                else {
+                    pc++;
+                }
+                break;
+            case NU_OP_GUARD:
+                pc = ([constants[code[pc]] value] == constants[code[pc+1]]) ? pc + 3 : code[pc+2];
+                break;
+            case NU_OP_NOT:
+                stack[sp-1] = nu_valueIsTrue(stack[sp-1]) ? Nu__null : nu_t_symbol;
+                break;
+            case NU_OP_ADD:
+            {
+                id b = stack[--sp];
+                stack[sp] = nil;
+                id a = stack[sp-1];
+                if (nu_objectIsKindOfClass(a, [NSValue class])) {
+                    stack[sp-1] = nu_number([a doubleValue] + [b doubleValue]);
+                }
+                else {
+                    NSMutableString *result = [NSMutableString stringWithString:[a stringValue]];
+                    if (b && (b != Nu__null))
+                        [result appendString:[b stringValue]];
+                    stack[sp-1] = result;
+                }
+                break;
+            }
+            case NU_OP_SUBTRACT:
+            case NU_OP_MULTIPLY:
+            case NU_OP_DIVIDE:
+            {
+                int opcode = code[pc-1];
+                double b = [stack[--sp] doubleValue];
+                stack[sp] = nil;
+                double a = [stack[sp-1] doubleValue];
+                stack[sp-1] = nu_number((opcode == NU_OP_SUBTRACT) ? a - b : (opcode == NU_OP_MULTIPLY) ? a * b : a / b);
+                break;
+            }
+            case NU_OP_GREATERTHAN:
+            case NU_OP_LESSTHAN:
+            case NU_OP_GTE:
+            case NU_OP_LTE:
+            {
+                int opcode = code[pc-1];
+                id b = stack[--sp];
+                stack[sp] = nil;
+                NSComparisonResult result = [stack[sp-1] compare:b];
+                BOOL isTrue = ((opcode == NU_OP_GREATERTHAN) ? (result == NSOrderedDescending) :
+                               (opcode == NU_OP_LESSTHAN) ? (result == NSOrderedAscending) :
+                               (opcode == NU_OP_GTE) ? (result != NSOrderedAscending) :
+                               (result != NSOrderedDescending));
+                stack[sp-1] = isTrue ? nu_t_symbol : Nu__null;
+                break;
+            }
+            case NU_OP_EQ:
+            {
+                id b = stack[--sp];
+                stack[sp] = nil;
+                stack[sp-1] = [stack[sp-1] isEqual:b] ? nu_t_symbol : Nu__null;
+                break;
+            }
+            case NU_OP_NEQ:
+            {
+                id b = stack[--sp];
+                stack[sp] = nil;
+                id a = stack[sp-1];
+                stack[sp-1] = (((a == nil) && (b == nil)) || [a isEqual:b]) ? Nu__null : nu_t_symbol;
+                break;
+            }
+            case NU_OP_RETURN:
+                return stack[sp-1];
+        }
+    }
+}
+
+// Find the loop that a break or continue thrown from the instruction at pc is for:
+// the innermost one running with pc in its body. The loops inside it are left.
+static NuBytecodeLoop *nu_bytecode_catching_loop(NuBytecodeState *state, int pc)
+{
+    while (state->loopCount) {
+        NuBytecodeLoop *loop = &state->loops[state->loopCount - 1];
+        if ((pc >= loop->start) && (pc < loop->end))
+            return loop;
+        state->loopCount--;
+    }
+    return NULL;
+}
+
+static id nu_bytecode_run(NuBytecode *bytecode, NuFrame *frame)
+{
+    __strong id stack[NU_BYTECODE_STACK_SIZE];
+    NuBytecodeState state = {0, 0, 0, NULL};
+    if (!bytecode->maxLoopDepth)
+        return nu_bytecode_execute(bytecode, frame, stack, &state);
+    
+    // Code with loops runs in a handler for the break and continue exceptions
+    // that functions called from their bodies can throw.
+    NuBytecodeLoop loops[NU_BYTECODE_LOOP_DEPTH];
+    state.loops = loops;
+    NSUInteger evalDepth = nu_eval_depth();
+    while (1) {
+        BOOL isBreak = NO;
+        @try
+        {
+            return nu_bytecode_execute(bytecode, frame, stack, &state);
+        }
+        @catch (NuBreakException *exception) {
+            if (!nu_bytecode_catching_loop(&state, state.pc))
+                @throw(exception);
+            nu_eval_unwind(exception, evalDepth);
+            isBreak = YES;
+        }
+        @catch (NuContinueException *exception) {
+            if (!nu_bytecode_catching_loop(&state, state.pc))
+                @throw(exception);
+            nu_eval_unwind(exception, evalDepth);
+            isBreak = NO;
+        }
+        // resume with the loop's value on top of the stack
+        NuBytecodeLoop *loop = &loops[state.loopCount - 1];
+        for (int i = loop->sp; i < NU_BYTECODE_STACK_SIZE; i++)
+            stack[i] = nil;
+        state.sp = loop->sp;
+        state.pc = isBreak ? loop->breakTarget : loop->continueTarget;
+    }
+}
+
+void load_builtins(NuSymbolTable *symbolTable);
+
+void load_builtins(NuSymbolTable *symbolTable)
+{
+    nu_init_well_known_symbols(symbolTable);
+    
+    [(NuSymbol *) [symbolTable symbolWithString:@"t"] setValue:[symbolTable symbolWithString:@"t"]];
     [(NuSymbol *) [symbolTable symbolWithString:@"nil"] setValue:Nu__null];
     [(NuSymbol *) [symbolTable symbolWithString:@"YES"] setValue:[NSNumber numberWithBool:YES]];
     [(NuSymbol *) [symbolTable symbolWithString:@"NO"] setValue:[NSNumber numberWithBool:NO]];
@@ -8289,6 +10583,347 @@ static id regexWithString(NSString *string)
     }
 }
 
+#pragma mark - Code Images
+
+// Parsed code can be saved as a binary image and read back without parsing.
+// An image starts with a header and a table of symbol names, followed by the
+// code itself. Lists are written cell by cell with their cdrs inline, so
+// reading and writing long lists doesn't recurse.
+//
+//   header          "NUIM", version, checksum of the source, symbol count
+//   symbol table    for each symbol: length, UTF-8 name
+//   code            tagged values, all in native byte order
+
+#define NU_IMAGE_MAGIC      "NUIM"
+#define NU_IMAGE_VERSION    1
+
+enum {
+    NU_IMAGE_NIL,
+    NU_IMAGE_NULL,
+    NU_IMAGE_CELL,              // flags, line, car; then the cdr follows
+    NU_IMAGE_SYMBOL,            // index into the symbol table
+    NU_IMAGE_INTEGER,           // objCType, 64-bit value
+    NU_IMAGE_DOUBLE,            // value
+    NU_IMAGE_STRING,            // length, UTF-8 bytes
+    NU_IMAGE_REGEX,             // options, pattern string
+};
+
+// Cell flags
+enum {
+    NU_IMAGE_CELL_HAS_FILE = 1,         // the cell came from the file the image was made from
+    NU_IMAGE_CELL_HAS_COMMENTS = 2,     // the cell is followed by its comments string
+};
+
+typedef struct {
+    uint8_t magic[4];
+    uint32_t version;
+    uint32_t checksum;
+    uint32_t symbolCount;
+} NuImageHeader;
+
+// FNV-1a, used to check that an image was made from the source it is loaded with.
+static uint32_t nu_image_checksum(NSString *string)
+{
+    uint32_t hash = 2166136261u;
+    const unsigned char *bytes = (const unsigned char *) [string UTF8String];
+    while (bytes && *bytes) {
+        hash ^= *bytes++;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+typedef struct {
+    NSMutableData *data;
+    NSMapTable *symbolIndexes;
+    NSMutableArray *symbols;
+    BOOL failed;
+} NuImageWriter;
+
+static void nu_image_write(NuImageWriter *writer, const void *bytes, size_t length)
+{
+    [writer->data appendBytes:bytes length:length];
+}
+
+static void nu_image_write_byte(NuImageWriter *writer, uint8_t byte)
+{
+    nu_image_write(writer, &byte, 1);
+}
+
+static void nu_image_write_uint32(NuImageWriter *writer, uint32_t value)
+{
+    nu_image_write(writer, &value, sizeof(value));
+}
+
+static void nu_image_write_string(NuImageWriter *writer, NSString *string)
+{
+    NSData *utf8 = [string dataUsingEncoding:NSUTF8StringEncoding];
+    nu_image_write_uint32(writer, (uint32_t) [utf8 length]);
+    nu_image_write(writer, [utf8 bytes], [utf8 length]);
+}
+
+static void nu_image_write_value(NuImageWriter *writer, id value, int filenum)
+{
+    while (!writer->failed) {
+        if (value == nil) {
+            nu_image_write_byte(writer, NU_IMAGE_NIL);
+        }
+        else if (value == Nu__null) {
+            nu_image_write_byte(writer, NU_IMAGE_NULL);
+        }
+        else if (nu_objectIsKindOfClass(value, [NuCell class])) {
+            NuCell *cell = value;
+            id comments = [cell comments];
+            uint8_t flags = 0;
+            if ((filenum >= 0) && ([cell file] == filenum))
+                flags |= NU_IMAGE_CELL_HAS_FILE;
+            if (comments)
+                flags |= NU_IMAGE_CELL_HAS_COMMENTS;
+            nu_image_write_byte(writer, NU_IMAGE_CELL);
+            nu_image_write_byte(writer, flags);
+            nu_image_write_uint32(writer, (uint32_t) [cell line]);
+            if (comments)
+                nu_image_write_string(writer, [comments stringValue]);
+            nu_image_write_value(writer, [cell car], filenum);
+            value = [cell cdr];
+            continue;
+        }
+        else if (nu_objectIsKindOfClass(value, [NuSymbol class])) {
+            NSNumber *index = [writer->symbolIndexes objectForKey:value];
+            if (!index) {
+                index = [NSNumber numberWithUnsignedInteger:[writer->symbols count]];
+                [writer->symbols addObject:value];
+                [writer->symbolIndexes setObject:index forKey:value];
+            }
+            nu_image_write_byte(writer, NU_IMAGE_SYMBOL);
+            nu_image_write_uint32(writer, (uint32_t) [index unsignedIntegerValue]);
+        }
+        else if (nu_objectIsKindOfClass(value, [NSNumber class])) {
+            char type = *[value objCType];
+            if ((type == 'd') || (type == 'f')) {
+                double d = [value doubleValue];
+                nu_image_write_byte(writer, NU_IMAGE_DOUBLE);
+                nu_image_write(writer, &d, sizeof(d));
+            }
+            else {
+                int64_t i = [value longLongValue];
+                nu_image_write_byte(writer, NU_IMAGE_INTEGER);
+                nu_image_write_byte(writer, (uint8_t) type);
+                nu_image_write(writer, &i, sizeof(i));
+            }
+        }
+        else if (nu_objectIsKindOfClass(value, [NSString class])) {
+            nu_image_write_byte(writer, NU_IMAGE_STRING);
+            nu_image_write_string(writer, [NSString stringWithString:value]);
+        }
+        else if (nu_objectIsKindOfClass(value, [NSRegularExpression class])) {
+            nu_image_write_byte(writer, NU_IMAGE_REGEX);
+            nu_image_write_uint32(writer, (uint32_t) [value options]);
+            nu_image_write_string(writer, [value pattern]);
+        }
+        else {
+            // parsers don't make anything else, so don't guess at how to save it
+            writer->failed = YES;
+        }
+        return;
+    }
+}
+
+static NSData *nu_image_with_code(id code, NSString *source, int filenum)
+{
+    NuImageWriter writer;
+    writer.data = [NSMutableData data];
+    writer.symbolIndexes = [NSMapTable mapTableWithKeyOptions:(NSPointerFunctionsStrongMemory | NSPointerFunctionsObjectPointerPersonality)
+                                                 valueOptions:NSPointerFunctionsStrongMemory];
+    writer.symbols = [NSMutableArray array];
+    writer.failed = NO;
+    nu_image_write_value(&writer, code, filenum);
+    if (writer.failed)
+        return nil;
+    
+    NSMutableData *image = [NSMutableData data];
+    NuImageHeader header;
+    memcpy(header.magic, NU_IMAGE_MAGIC, 4);
+    header.version = NU_IMAGE_VERSION;
+    header.checksum = nu_image_checksum(source);
+    header.symbolCount = (uint32_t) [writer.symbols count];
+    [image appendBytes:&header length:sizeof(header)];
+    NuImageWriter symbolWriter = {image, nil, nil, NO};
+    for (NuSymbol *symbol in writer.symbols)
+        nu_image_write_string(&symbolWriter, [symbol stringValue]);
+    [image appendData:writer.data];
+    return image;
+}
+
+typedef struct {
+    const uint8_t *bytes;
+    const uint8_t *end;
+    __unsafe_unretained id *symbols;
+    uint32_t symbolCount;
+    int filenum;
+    BOOL failed;
+} NuImageReader;
+
+static BOOL nu_image_read(NuImageReader *reader, void *buffer, size_t length)
+{
+    if (reader->failed || ((size_t) (reader->end - reader->bytes) < length)) {
+        reader->failed = YES;
+        return NO;
+    }
+    memcpy(buffer, reader->bytes, length);
+    reader->bytes += length;
+    return YES;
+}
+
+static uint8_t nu_image_read_byte(NuImageReader *reader)
+{
+    uint8_t byte = 0;
+    nu_image_read(reader, &byte, 1);
+    return byte;
+}
+
+static uint32_t nu_image_read_uint32(NuImageReader *reader)
+{
+    uint32_t value = 0;
+    nu_image_read(reader, &value, sizeof(value));
+    return value;
+}
+
+static NSString *nu_image_read_string(NuImageReader *reader)
+{
+    uint32_t length = nu_image_read_uint32(reader);
+    if (reader->failed || ((size_t) (reader->end - reader->bytes) < length)) {
+        reader->failed = YES;
+        return nil;
+    }
+    NSString *string = [[NSString alloc] initWithBytes:reader->bytes length:length encoding:NSUTF8StringEncoding];
+    reader->bytes += length;
+    if (!string)
+        reader->failed = YES;
+    return string;
+}
+
+static id nu_image_read_value(NuImageReader *reader)
+{
+    id first = nil;
+    NuCell *last = nil;
+    while (!reader->failed) {
+        uint8_t tag = nu_image_read_byte(reader);
+        id value = nil;
+        if (tag == NU_IMAGE_CELL) {
+            uint8_t flags = nu_image_read_byte(reader);
+            int line = (int) nu_image_read_uint32(reader);
+            NuCell *cell;
+            if (flags & NU_IMAGE_CELL_HAS_COMMENTS) {
+                NuCellWithComments *cellWithComments = [[NuCellWithComments alloc] init];
+                [cellWithComments setComments:nu_image_read_string(reader)];
+                cell = cellWithComments;
+            }
+            else {
+                cell = [[NuCodeCell alloc] init];
+            }
+            [cell setFile:((flags & NU_IMAGE_CELL_HAS_FILE) ? reader->filenum : -1) line:line];
+            [cell setCarWhileParsing:nu_image_read_value(reader)];
+            if (last)
+                [last setCdrWhileParsing:cell];
+            else
+                first = cell;
+            last = cell;
+            continue;
+        }
+        switch (tag) {
+            case NU_IMAGE_NIL:
+                break;
+            case NU_IMAGE_NULL:
+                value = Nu__null;
+                break;
+            case NU_IMAGE_SYMBOL:
+            {
+                uint32_t index = nu_image_read_uint32(reader);
+                if (index < reader->symbolCount)
+                    value = reader->symbols[index];
+                else
+                    reader->failed = YES;
+                break;
+            }
+            case NU_IMAGE_INTEGER:
+            {
+                char type = (char) nu_image_read_byte(reader);
+                int64_t i = 0;
+                nu_image_read(reader, &i, sizeof(i));
+                value = (type == 'i') ? [NSNumber numberWithInt:(int) i] : [NSNumber numberWithLong:(long) i];
+                break;
+            }
+            case NU_IMAGE_DOUBLE:
+            {
+                double d = 0;
+                nu_image_read(reader, &d, sizeof(d));
+                value = [NSNumber numberWithDouble:d];
+                break;
+            }
+            case NU_IMAGE_STRING:
+            {
+                NSString *string = nu_image_read_string(reader);
+                value = string ? [NuStringTemplate stringWithLiteral:string] : nil;
+                break;
+            }
+            case NU_IMAGE_REGEX:
+            {
+                NSRegularExpressionOptions options = nu_image_read_uint32(reader);
+                NSString *pattern = nu_image_read_string(reader);
+                value = pattern ? [NSRegularExpression regularExpressionWithPattern:pattern options:options error:NULL] : nil;
+                break;
+            }
+            default:
+                reader->failed = YES;
+                break;
+        }
+        if (!last)
+            return value;
+        [last setCdr:value];
+        return first;
+    }
+    return nil;
+}
+
+// Read the code in an image, or return nil if the image is damaged or wasn't made from the source.
+static id nu_code_with_image(NSData *image, NSString *source, NuSymbolTable *symbolTable, int filenum)
+{
+    NuImageHeader header;
+    if (!image || ([image length] < sizeof(header)))
+        return nil;
+    memcpy(&header, [image bytes], sizeof(header));
+    if (memcmp(header.magic, NU_IMAGE_MAGIC, 4) || (header.version != NU_IMAGE_VERSION))
+        return nil;
+    if (source && (header.checksum != nu_image_checksum(source)))
+        return nil;
+    
+    NuImageReader reader;
+    reader.bytes = (const uint8_t *) [image bytes] + sizeof(header);
+    reader.end = (const uint8_t *) [image bytes] + [image length];
+    reader.filenum = filenum;
+    reader.failed = NO;
+    // intern all of the image's symbols before reading the code that uses them
+    NSMutableArray *symbols = [NSMutableArray arrayWithCapacity:header.symbolCount];
+    for (uint32_t i = 0; (i < header.symbolCount) && !reader.failed; i++) {
+        uint32_t length = nu_image_read_uint32(&reader);
+        if (reader.failed || ((size_t) (reader.end - reader.bytes) < length)) {
+            reader.failed = YES;
+            break;
+        }
+        [symbols addObject:[symbolTable symbolWithUTF8String:(const char *) reader.bytes length:length]];
+        reader.bytes += length;
+    }
+    if (reader.failed)
+        return nil;
+    reader.symbolCount = header.symbolCount;
+    reader.symbols = (__unsafe_unretained id *) malloc(sizeof(id) * (header.symbolCount + 1));
+    [symbols getObjects:reader.symbols range:NSMakeRange(0, header.symbolCount)];
+    id code = nu_image_read_value(&reader);
+    free(reader.symbols);
+    return (reader.failed || (reader.bytes != reader.end)) ? nil : code;
+}
+
 #define NU_MAX_PARSER_MACRO_DEPTH 1000
 
 @interface NuParser ()
@@ -8402,9 +11037,9 @@ static id regexWithString(NSString *string)
         _readerMacroDepth[i] = 0;
     }
     
-    _root = _current = [[NuCell alloc] init];
+    _root = _current = [[NuCodeCell alloc] init];
     [_root setFile:_filenum line:_linenum];
-    [_root setCar:[_symbolTable symbolWithString:@"progn"]];
+    [_root setCarWhileParsing:[_symbolTable symbolWithString:@"progn"]];
     _addToCar = NO;
     _stack = [[NuStack alloc] init];
 }
@@ -8454,18 +11089,18 @@ static id regexWithString(NSString *string)
         _comments = nil;
     }
     else {
-        newCell = [[NuCell alloc] init];
+        newCell = [[NuCodeCell alloc] init];
         [newCell setFile:_filenum line:_linenum];
     }
     if (_addToCar) {
-        [_current setCar:newCell];
+        [_current setCarWhileParsing:newCell];
         [_stack push:_current];
     }
     else {
-        [_current setCdr:newCell];
+        [_current setCdrWhileParsing:newCell];
     }
     _current = newCell;
-    [_current setCar:atom];
+    [_current setCarWhileParsing:atom];
     _addToCar = NO;
 }
 
@@ -8474,14 +11109,14 @@ static id regexWithString(NSString *string)
     ParserDebug(@"openListCell: depth = %d", _depth);
     
     _depth++;
-    NuCell *newCell = [[NuCell alloc] init];
+    NuCell *newCell = [[NuCodeCell alloc] init];
     [newCell setFile:_filenum line:_linenum];
     if (_addToCar) {
-        [_current setCar:newCell];
+        [_current setCarWhileParsing:newCell];
         [_stack push:_current];
     }
     else {
-        [_current setCdr:newCell];
+        [_current setCdrWhileParsing:newCell];
     }
     _current = newCell;
     
@@ -8539,10 +11174,10 @@ static id regexWithString(NSString *string)
     --_depth;
     
     if (_addToCar) {
-        [_current setCar:[NSNull null]];
+        [_current setCarWhileParsing:[NSNull null]];
     }
     else {
-        [_current setCdr:[NSNull null]];
+        [_current setCdrWhileParsing:[NSNull null]];
         _current = [_stack pop];
     }
     _addToCar = NO;
@@ -8910,7 +11545,7 @@ static NSUInteger nu_parse_escape_sequences(NSString *string, NSUInteger i, NSUI
                     if (_hereString == nil)
                         _hereString = [NSMutableString string];
                     //NSLog(@"got herestring **%@**", hereString);
-                    [self addAtom:_hereString];
+                    [self addAtom:[NuStringTemplate stringWithLiteral:_hereString]];
                     // to continue, set i to point to the next character after the tag
                     i = i + [_pattern length] - 1;
                     //NSLog(@"continuing parsing with:%s", &str[i+1]);
@@ -8933,7 +11568,7 @@ static NSUInteger nu_parse_escape_sequences(NSString *string, NSUInteger i, NSUI
                     case '"':
                     {
                         _state = PARSE_NORMAL;
-                        NSString *string = [NSString stringWithString:_partial];
+                        NSString *string = [NuStringTemplate stringWithLiteral:[NSString stringWithString:_partial]];
                         //NSLog(@"parsed string:%@:", string);
                         [self addAtom:string];
                         [_partial setString:@""];
@@ -9076,6 +11711,29 @@ static NSUInteger nu_parse_escape_sequences(NSString *string, NSUInteger i, NSUI
     return result;
 }
 
+- (NSData *) imageWithString:(NSString *)string asIfFromFilename:(const char *) filename
+{
+    [self setFilename:filename];
+    int filenum = _filenum;
+    id code = [self parse:string];
+    [self setFilename:NULL];
+    if ([self incomplete]) {
+        [self reset];
+        return nil;
+    }
+    return nu_image_with_code(code, string, filenum);
+}
+
+- (id) parseImage:(NSData *)image source:(NSString *)string asIfFromFilename:(const char *) filename
+{
+    [self setFilename:filename];
+    id code = nu_code_with_image(image, string, _symbolTable, _filenum);
+    [self setFilename:NULL];
+    if (!code && string)
+        code = [self parse:string asIfFromFilename:filename];
+    return code;
+}
+
 - (void) newline
 {
     _linenum++;
@@ -9298,16 +11956,17 @@ static NSUInteger nu_parse_escape_sequences(NSString *string, NSUInteger i, NSUI
 
 #pragma mark - NuProfiler.h
 
-@interface NuProfileStackElement : NSObject
+// Nanoseconds since some fixed time.
+static uint64_t nu_profile_now(void)
 {
-@public
-    NSString *name;
-    uint64_t start;
-    NuProfileStackElement *parent;
+    static mach_timebase_info_data_t timebase;
+    static dispatch_once_t once;
+    dispatch_once(&once, ^{
+        mach_timebase_info(&timebase);
+    });
+    return mach_absolute_time() * timebase.numer / timebase.denom;
 }
 
-@end
-
 @interface NuProfileTimeSlice : NSObject
 {
 @public
@@ -9317,35 +11976,102 @@ static NSUInteger nu_parse_escape_sequences(NSString *string, NSUInteger i, NSUI
 
 @end
 
-@implementation NuProfileStackElement
+@implementation NuProfileTimeSlice
 
-- (NSString *) name {return name;}
-- (uint64_t) start {return start;}
-- (NuProfileStackElement *) parent {return parent;}
+- (float) time {return time;}
+- (int) count {return count;}
 
 - (NSString *) description
 {
-    return [NSString stringWithFormat:@"name:%@ start:%llx", name, start];
+    return [NSString stringWithFormat:@"time:%f count:%d", time, count];
 }
 
 @end
 
-@implementation NuProfileTimeSlice
+/*!
+ @class NuProfileRecord
+ @abstract Internal class for the time spent in one block or operator.
+ @discussion Inclusive time counts the outermost call of a recursive function once.
+ */
+@interface NuProfileRecord : NSObject
+{
+@public
+    NSString *name;
+    NSUInteger calls;
+    uint64_t inclusive;
+    uint64_t exclusive;
+    NSUInteger active;
+}
+@end
 
-- (float) time {return time;}
-- (int) count {return count;}
+@implementation NuProfileRecord
+@end
 
-- (NSString *) description
+/*!
+ @class NuProfileNode
+ @abstract Internal class for one path through the call tree, used for flame graphs.
+ */
+@interface NuProfileNode : NSObject
 {
-    return [NSString stringWithFormat:@"time:%f count:%d", time, count];
+@public
+    __unsafe_unretained NuProfileRecord *record;
+    NSMapTable *children;
+    uint64_t exclusive;
+}
+@end
+
+@implementation NuProfileNode
+
+- (NuProfileNode *) childForRecord:(NuProfileRecord *) r
+{
+    if (!children)
+        children = [NSMapTable mapTableWithKeyOptions:(NSPointerFunctionsStrongMemory | NSPointerFunctionsObjectPointerPersonality)
+                                         valueOptions:NSPointerFunctionsStrongMemory];
+    NuProfileNode *child = [children objectForKey:r];
+    if (!child) {
+        child = [[NuProfileNode alloc] init];
+        child->record = r;
+        [children setObject:child forKey:r];
+    }
+    return child;
+}
+
+- (void) appendStacksWithPrefix:(NSString *) prefix toString:(NSMutableString *) result
+{
+    NSString *path = record ? (prefix ? [NSString stringWithFormat:@"%@;%@", prefix, record->name] : record->name) : nil;
+    if (path && (exclusive >= 1000))
+        [result appendFormat:@"%@ %llu\n", path, (unsigned long long) (exclusive / 1000)];
+    for (NuProfileNode *child in [children objectEnumerator])
+        [child appendStacksWithPrefix:path toString:result];
 }
 
 @end
 
+// A call being timed. Frames are matched to evaluation stack depths, so frames
+// left behind by exceptions can be found and dropped.
+typedef struct {
+    __unsafe_unretained NuProfileNode *node;
+    uint64_t start;
+    uint64_t childTime;
+    NSUInteger depth;
+} NuProfileFrame;
+
 @interface NuProfiler ()
 {
     NSMutableDictionary *sections;
-    NuProfileStackElement *stack;
+    NSMutableArray *sectionNames;
+    uint64_t *sectionStarts;
+    NSUInteger sectionCapacity;
+    
+    pthread_t thread;
+    NSMapTable *records;
+    NuProfileNode *root;
+    NuProfileFrame *frames;
+    NSUInteger frameCount;
+    NSUInteger frameCapacity;
+    
+    dispatch_source_t sampleTimer;
+    NSMutableDictionary *samples;
 }
 @end
 
@@ -9353,6 +12079,9 @@ static NSUInteger nu_parse_escape_sequences(NSString *string, NSUInteger i, NSUI
 
 static NuProfiler *defaultProfiler = nil;
 
+// The profiler that is timing calls or sampling, if any.
+static NuProfiler *activeProfiler = nil;
+
 + (NuProfiler *) defaultProfiler
 {
     if (!defaultProfiler)
@@ -9364,40 +12093,49 @@ static NuProfiler *defaultProfiler = nil;
 {
     self = [super init];
     sections = [[NSMutableDictionary alloc] init];
-    stack = nil;
+    sectionNames = [[NSMutableArray alloc] init];
+    records = [NSMapTable mapTableWithKeyOptions:(NSPointerFunctionsStrongMemory | NSPointerFunctionsObjectPointerPersonality)
+                                    valueOptions:NSPointerFunctionsStrongMemory];
+    root = [[NuProfileNode alloc] init];
+    samples = [[NSMutableDictionary alloc] init];
     return self;
 }
 
+- (void) dealloc
+{
+    free(sectionStarts);
+    free(frames);
+}
+
 - (void) start:(NSString *) name
 {
-    NuProfileStackElement *stackElement = [[NuProfileStackElement alloc] init];
-    stackElement->name = name;
-    stackElement->start = mach_absolute_time();
-    stackElement->parent = stack;
-    stack = stackElement;
+    NSUInteger depth = [sectionNames count];
+    if (depth == sectionCapacity) {
+        sectionCapacity = depth ? 2 * depth : 16;
+        sectionStarts = (uint64_t *) realloc(sectionStarts, sectionCapacity * sizeof(uint64_t));
+    }
+    [sectionNames addObject:name];
+    sectionStarts[depth] = nu_profile_now();
 }
 
 - (void) stop
 {
-    if (stack) {
-        uint64_t current_time = mach_absolute_time();
-        uint64_t time_delta = current_time - stack->start;
-        struct mach_timebase_info info;
-        mach_timebase_info(&info);
-        float timeDelta = 1e-9 * time_delta * (double) info.numer / info.denom;
-        //NSNumber *delta = [NSNumber numberWithFloat:timeDelta];
-        NuProfileTimeSlice *entry = [sections objectForKey:stack->name];
+    NSUInteger depth = [sectionNames count];
+    if (depth) {
+        float timeDelta = 1e-9 * (nu_profile_now() - sectionStarts[depth - 1]);
+        NSString *name = [sectionNames lastObject];
+        NuProfileTimeSlice *entry = [sections objectForKey:name];
         if (!entry) {
             entry = [[NuProfileTimeSlice alloc] init];
             entry->count = 1;
             entry->time = timeDelta;
-            [sections setObject:entry forKey:stack->name];
+            [sections setObject:entry forKey:name];
         }
         else {
             entry->count++;
             entry->time += timeDelta;
         }
-        stack = stack->parent;
+        [sectionNames removeLastObject];
     }
 }
 
@@ -9409,9 +12147,200 @@ static NuProfiler *defaultProfiler = nil;
 - (void) reset
 {
     [sections removeAllObjects];
-    while (stack) {
-        stack = stack->parent;
+    [sectionNames removeAllObjects];
+    [records removeAllObjects];
+    root = [[NuProfileNode alloc] init];
+    frameCount = 0;
+    [samples removeAllObjects];
+}
+
+#pragma mark Call timing
+
+- (void) startTracing
+{
+    activeProfiler = self;
+    thread = pthread_self();
+    frameCount = 0;
+    nu_profile_tracing = YES;
+}
+
+- (void) stopTracing
+{
+    nu_profile_tracing = NO;
+    frameCount = 0;
+}
+
+static NSString *nu_profile_name(id head, id function)
+{
+    if (nu_objectIsKindOfClass(head, [NuSymbol class]))
+        return [head stringValue];
+    if (nu_objectIsKindOfClass(function, [NuBlock class])) {
+        id body = [function body];
+        const char *file = nu_objectIsKindOfClass(body, [NuCell class]) ? nu_parsedFilename([body file]) : NULL;
+        if (file)
+            return [NSString stringWithFormat:@"(do) %s:%d", file, [body line]];
+    }
+    return [NSString stringWithFormat:@"(%@)", NSStringFromClass([function class])];
+}
+
+- (void) dropFramesFromDepth:(NSUInteger) depth
+{
+    while (frameCount && (frames[frameCount - 1].depth >= depth)) {
+        frameCount--;
+        frames[frameCount].node->record->active--;
+    }
+}
+
+- (BOOL) enter:(id) head function:(id) function depth:(NSUInteger) depth
+{
+    if (!pthread_equal(thread, pthread_self()))
+        return NO;
+    if (!(nu_objectIsKindOfClass(function, [NuBlock class])
+          || nu_objectIsKindOfClass(function, [NuOperator class])
+          || nu_objectIsKindOfClass(function, [NuMacro_0 class])))
+        return NO;
+    // frames at this depth or deeper were left by calls that threw exceptions
+    [self dropFramesFromDepth:depth];
+    NuProfileRecord *record = [records objectForKey:function];
+    if (!record) {
+        record = [[NuProfileRecord alloc] init];
+        record->name = nu_profile_name(head, function);
+        [records setObject:record forKey:function];
+    }
+    record->calls++;
+    record->active++;
+    NuProfileNode *parent = frameCount ? frames[frameCount - 1].node : root;
+    if (frameCount == frameCapacity) {
+        frameCapacity = frameCapacity ? 2 * frameCapacity : 64;
+        frames = (NuProfileFrame *) realloc(frames, frameCapacity * sizeof(NuProfileFrame));
+    }
+    NuProfileFrame *frame = &frames[frameCount++];
+    frame->node = [parent childForRecord:record];
+    frame->childTime = 0;
+    frame->depth = depth;
+    frame->start = nu_profile_now();
+    return YES;
+}
+
+- (void) exitAtDepth:(NSUInteger) depth
+{
+    uint64_t now = nu_profile_now();
+    [self dropFramesFromDepth:depth + 1];
+    if (!frameCount || (frames[frameCount - 1].depth != depth))
+        return;
+    NuProfileFrame *frame = &frames[--frameCount];
+    NuProfileRecord *record = frame->node->record;
+    uint64_t elapsed = now - frame->start;
+    uint64_t exclusive = (elapsed > frame->childTime) ? elapsed - frame->childTime : 0;
+    record->exclusive += exclusive;
+    frame->node->exclusive += exclusive;
+    if (--record->active == 0)
+        record->inclusive += elapsed;
+    if (frameCount)
+        frames[frameCount - 1].childTime += elapsed;
+}
+
+static BOOL nu_profile_enter(id head, id function, NSUInteger depth)
+{
+    return [activeProfiler enter:head function:function depth:depth];
+}
+
+static void nu_profile_exit(NSUInteger depth)
+{
+    [activeProfiler exitAtDepth:depth];
+}
+
+#pragma mark Sampling
+
+- (void) startSamplingWithInterval:(double) seconds
+{
+    [self stopSampling];
+    activeProfiler = self;
+    thread = pthread_self();
+    uint64_t interval = (uint64_t) (seconds * NSEC_PER_SEC);
+    sampleTimer = dispatch_source_create(DISPATCH_SOURCE_TYPE_TIMER, 0, 0, dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_HIGH, 0));
+    dispatch_source_set_timer(sampleTimer, dispatch_time(DISPATCH_TIME_NOW, interval), interval, interval / 10);
+    // the interpreter takes the sample at its next evaluation, on its own thread
+    dispatch_source_set_event_handler(sampleTimer, ^{
+        nu_profile_sample_due = 1;
+    });
+    dispatch_resume(sampleTimer);
+}
+
+- (void) stopSampling
+{
+    if (sampleTimer) {
+        dispatch_source_cancel(sampleTimer);
+        sampleTimer = nil;
+    }
+    nu_profile_sample_due = 0;
+}
+
+- (void) takeSample
+{
+    if (!pthread_equal(thread, pthread_self()))
+        return;
+    nu_profile_sample_due = 0;
+    // the evaluation stack holds only the lists being evaluated now,
+    // since exceptions that leave a block are unwound there
+    NSMutableString *path = [NSMutableString string];
+    for (NSUInteger i = 0; i < nu_eval_stack.depth; i++) {
+        id head = [nu_eval_stack.cells[i] car];
+        if (nu_objectIsKindOfClass(head, [NuSymbol class])) {
+            if ([path length])
+                [path appendString:@";"];
+            [path appendString:[head stringValue]];
+        }
+    }
+    if (![path length])
+        return;
+    NSNumber *count = [samples objectForKey:path];
+    [samples setObject:[NSNumber numberWithUnsignedInteger:[count unsignedIntegerValue] + 1] forKey:path];
+}
+
+static void nu_profile_take_sample(void)
+{
+    [activeProfiler takeSample];
+}
+
+#pragma mark Reports
+
+- (NSString *) collapsedStacks
+{
+    NSMutableString *result = [NSMutableString string];
+    [root appendStacksWithPrefix:nil toString:result];
+    return result;
+}
+
+- (NSString *) sampledStacks
+{
+    NSMutableString *result = [NSMutableString string];
+    for (NSString *path in [[samples allKeys] sortedArrayUsingSelector:@selector(compare:)])
+        [result appendFormat:@"%@ %@\n", path, [samples objectForKey:path]];
+    return result;
+}
+
+- (NSString *) JSONSummary
+{
+    NSMutableArray *functions = [NSMutableArray array];
+    for (NuProfileRecord *record in [records objectEnumerator]) {
+        [functions addObject:@{@"name": record->name,
+                               @"calls": @(record->calls),
+                               @"inclusive_ms": @(1e-6 * record->inclusive),
+                               @"exclusive_ms": @(1e-6 * record->exclusive)}];
+    }
+    [functions sortUsingDescriptors:@[[NSSortDescriptor sortDescriptorWithKey:@"exclusive_ms" ascending:NO]]];
+    NSMutableDictionary *sectionSummary = [NSMutableDictionary dictionary];
+    for (NSString *name in sections) {
+        NuProfileTimeSlice *slice = [sections objectForKey:name];
+        [sectionSummary setObject:@{@"calls": @(slice->count), @"seconds": @(slice->time)} forKey:[name description]];
     }
+    NSUInteger sampleCount = 0;
+    for (NSNumber *count in [samples objectEnumerator])
+        sampleCount += [count unsignedIntegerValue];
+    NSDictionary *summary = @{@"functions": functions, @"sections": sectionSummary, @"samples": @(sampleCount)};
+    NSData *data = [NSJSONSerialization dataWithJSONObject:summary options:NSJSONWritingPrettyPrinted error:NULL];
+    return [[NSString alloc] initWithData:data encoding:NSUTF8StringEncoding];
 }
 
 @end
@@ -9883,69 +12812,226 @@ static void nu_swizzleContainerClasses()
 @property (nonatomic, strong) NSString *stringValue;
 @end
 
+// Entries of the symbol table. An entry is published by storing its symbol
+// last, so a reader that finds a symbol also sees its hash and name.
+// Entries never change once published, except that removing a symbol
+// replaces it with NU_SYMBOL_REMOVED.
+typedef struct {
+    _Atomic(void *) symbol;
+    uint32_t hash;
+    uint32_t length;
+    const char *name;           // UTF-8, owned by the table
+} NuSymbolEntry;
+
+#define NU_SYMBOL_REMOVED ((void *) 1)
+
+typedef struct NuSymbolSlots {
+    NSUInteger capacity;        // a power of two
+    struct NuSymbolSlots *retired;
+    NuSymbolEntry entries[];
+} NuSymbolSlots;
+
+#define NU_SYMBOL_TABLE_INITIAL_CAPACITY 2048
+
 @interface NuSymbolTable ()
-@property (nonatomic, strong) NSMutableDictionary *symbol_table;
+{
+    // Lookups read the current slots without locking. Symbols are added and removed
+    // while synchronized on the table, and when the slots fill up they are copied to
+    // bigger ones. Old slots are kept until the table is deleted, since a lookup
+    // could still be reading them.
+    _Atomic(NuSymbolSlots *) slots;
+    NSUInteger used;            // live and removed entries in the current slots
+    NSMutableArray *symbols;    // every symbol made by the table, including removed ones
+}
 @end
 
 void load_builtins(NuSymbolTable *);
 
 static NuSymbolTable *sharedSymbolTable = 0;
 
+// FNV-1a
+static uint32_t nu_symbol_hash(const char *name, NSUInteger length)
+{
+    uint32_t hash = 2166136261u;
+    for (NSUInteger i = 0; i < length; i++) {
+        hash ^= (unsigned char) name[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+static NuSymbolSlots *nu_symbol_slots_create(NSUInteger capacity)
+{
+    NuSymbolSlots *slots = (NuSymbolSlots *) calloc(1, sizeof(NuSymbolSlots) + capacity * sizeof(NuSymbolEntry));
+    slots->capacity = capacity;
+    return slots;
+}
+
+// Find the entry for a name, or the empty entry where it would go.
+static NuSymbolEntry *nu_symbol_slots_find(NuSymbolSlots *slots, const char *name, NSUInteger length, uint32_t hash, void **symbol)
+{
+    NSUInteger mask = slots->capacity - 1;
+    for (NSUInteger i = hash & mask; ; i = (i + 1) & mask) {
+        NuSymbolEntry *entry = &slots->entries[i];
+        void *candidate = atomic_load_explicit(&entry->symbol, memory_order_acquire);
+        if (!candidate) {
+            *symbol = NULL;
+            return entry;
+        }
+        if ((candidate != NU_SYMBOL_REMOVED) && (entry->hash == hash) && (entry->length == length)
+            && !memcmp(entry->name, name, length)) {
+            *symbol = candidate;
+            return entry;
+        }
+    }
+}
+
 @implementation NuSymbolTable
 
 + (NuSymbolTable *) sharedSymbolTable
 {
     if (!sharedSymbolTable) {
         sharedSymbolTable = [[self alloc] init];
-        sharedSymbolTable.symbol_table = [[NSMutableDictionary alloc] init];
         load_builtins(sharedSymbolTable);
     }
     return sharedSymbolTable;
 }
 
+- (id) init
+{
+    if ((self = [super init])) {
+        atomic_init(&slots, nu_symbol_slots_create(NU_SYMBOL_TABLE_INITIAL_CAPACITY));
+        symbols = [[NSMutableArray alloc] init];
+    }
+    return self;
+}
+
 - (void) dealloc
 {
-    NSLog(@"WARNING: deleting a symbol table. Leaking stored symbols.");
+    NSLog(@"WARNING: deleting a symbol table.");
+    NuSymbolSlots *current = atomic_load(&slots);
+    for (NSUInteger i = 0; i < current->capacity; i++)
+        free((void *) current->entries[i].name);
+    while (current) {
+        NuSymbolSlots *retired = current->retired;
+        free(current);
+        current = retired;
+    }
 }
 
-- (NuSymbol *) symbolWithString:(NSString *)string
+// Copy the live entries to new slots, dropping removed ones and growing if the table is more than half full.
+- (void) rehash
+{
+    NuSymbolSlots *current = atomic_load_explicit(&slots, memory_order_relaxed);
+    NSUInteger live = [symbols count];
+    NSUInteger capacity = current->capacity;
+    while (live * 2 > capacity)
+        capacity *= 2;
+    NuSymbolSlots *bigger = nu_symbol_slots_create(capacity);
+    used = 0;
+    for (NSUInteger i = 0; i < current->capacity; i++) {
+        NuSymbolEntry *entry = &current->entries[i];
+        void *symbol = atomic_load_explicit(&entry->symbol, memory_order_relaxed);
+        if (symbol && (symbol != NU_SYMBOL_REMOVED)) {
+            void *unused;
+            NuSymbolEntry *copy = nu_symbol_slots_find(bigger, entry->name, entry->length, entry->hash, &unused);
+            copy->hash = entry->hash;
+            copy->length = entry->length;
+            copy->name = entry->name;
+            atomic_store_explicit(&copy->symbol, symbol, memory_order_relaxed);
+            used++;
+        }
+    }
+    bigger->retired = current;
+    atomic_store_explicit(&slots, bigger, memory_order_release);
+}
+
+- (NuSymbol *) symbolWithUTF8String:(const char *)name length:(NSUInteger)length string:(NSString *)string
 {
-    assert(self.symbol_table);
+    uint32_t hash = nu_symbol_hash(name, length);
     
     // If the symbol is already in the table, return it.
-    NuSymbol *symbol;
-    symbol = [self.symbol_table objectForKey:string];
-    if (symbol) {
+    void *found;
+    nu_symbol_slots_find(atomic_load_explicit(&slots, memory_order_acquire), name, length, hash, &found);
+    if (found)
+        return (__bridge NuSymbol *) found;
+    
+    @synchronized(self) {
+        // Check again, since another thread may have added it.
+        NuSymbolSlots *current = atomic_load_explicit(&slots, memory_order_relaxed);
+        NuSymbolEntry *entry = nu_symbol_slots_find(current, name, length, hash, &found);
+        if (found)
+            return (__bridge NuSymbol *) found;
+        
+        // If not, create it.
+        NuSymbol *symbol = [[NuSymbol alloc] init];             // keep construction private
+        symbol.stringValue = string ? [string copy] : [[NSString alloc] initWithBytes:name length:length encoding:NSUTF8StringEncoding];
+        symbol.isLabel = (length > 0) && (name[length - 1] == ':');
+        symbol.isGensym = (length > 2) && (name[0] == '_') && (name[1] == '_');
+        [symbols addObject:symbol];
+        
+        // Put the new symbol in the symbol table and return it.
+        if ((used + 1) * 4 > current->capacity * 3) {
+            [self rehash];
+            current = atomic_load_explicit(&slots, memory_order_relaxed);
+            entry = nu_symbol_slots_find(current, name, length, hash, &found);
+        }
+        char *copy = (char *) malloc(length + 1);
+        memcpy(copy, name, length);
+        copy[length] = 0;
+        entry->hash = hash;
+        entry->length = (uint32_t) length;
+        entry->name = copy;
+        atomic_store_explicit(&entry->symbol, (__bridge void *) symbol, memory_order_release);
+        used++;
         return symbol;
     }
-    
-    // If not, create it.
-    symbol = [[NuSymbol alloc] init];             // keep construction private
-    symbol.stringValue = [string copy];
-    
-    const char *cstring = [string cStringUsingEncoding:NSUTF8StringEncoding];
-    NSUInteger len = strlen(cstring);
-    symbol.isLabel = (cstring[len - 1] == ':');
-    symbol.isGensym = (len > 2) && (cstring[0] == '_') && (cstring[1] == '_');
-    
-    // Put the new symbol in the symbol table and return it.
-    [self.symbol_table setObject:symbol forKey:symbol.stringValue];
-    return symbol;
+}
+
+- (NuSymbol *) symbolWithUTF8String:(const char *)name length:(NSUInteger)length
+{
+    return [self symbolWithUTF8String:name length:length string:nil];
+}
+
+- (NuSymbol *) symbolWithString:(NSString *)string
+{
+    const char *name = [string UTF8String];
+    return [self symbolWithUTF8String:name length:strlen(name) string:string];
 }
 
 - (NuSymbol *) lookup:(NSString *) string
 {
-    return [self.symbol_table objectForKey:string];
+    const char *name = [string UTF8String];
+    NSUInteger length = strlen(name);
+    void *found;
+    nu_symbol_slots_find(atomic_load_explicit(&slots, memory_order_acquire), name, length, nu_symbol_hash(name, length), &found);
+    return (__bridge NuSymbol *) found;
 }
 
 - (NSArray *) all
 {
-    return [self.symbol_table allValues];
+    NSMutableArray *all = [NSMutableArray array];
+    NuSymbolSlots *current = atomic_load_explicit(&slots, memory_order_acquire);
+    for (NSUInteger i = 0; i < current->capacity; i++) {
+        void *symbol = atomic_load_explicit(&current->entries[i].symbol, memory_order_acquire);
+        if (symbol && (symbol != NU_SYMBOL_REMOVED))
+            [all addObject:(__bridge NuSymbol *) symbol];
+    }
+    return all;
 }
 
 - (void) removeSymbol:(NuSymbol *) symbol
 {
-    [self.symbol_table removeObjectForKey:[symbol stringValue]];
+    // The symbol itself stays alive, since a lookup may have just found it.
+    const char *name = [[symbol stringValue] UTF8String];
+    NSUInteger length = strlen(name);
+    @synchronized(self) {
+        void *found;
+        NuSymbolEntry *entry = nu_symbol_slots_find(atomic_load_explicit(&slots, memory_order_relaxed),
+                                                    name, length, nu_symbol_hash(name, length), &found);
+        if (found == (__bridge void *) symbol)
+            atomic_store_explicit(&entry->symbol, NU_SYMBOL_REMOVED, memory_order_release);
+    }
 }
 
 @end
@@ -9990,8 +13076,7 @@ static NuSymbolTable *sharedSymbolTable = 0;
     
     // If the symbol is a class instance variable, find "self" and ask it for the ivar value.
     if (firstCharacter == '@') {
-        NuSymbolTable *symbolTable = [context objectForKey:SYMBOLS_KEY];
-        id object = [context lookupObjectForKey:[symbolTable symbolWithString:@"self"]];
+        id object = [context lookupObjectForKey:nu_self_symbol];
         if (!object) return [NSNull null];
         id ivarName = [[self stringValue] substringFromIndex:1];
         id result = [object valueForIvar:ivarName];
@@ -10055,7 +13140,7 @@ static NuSymbolTable *sharedSymbolTable = 0;
     
     // Still-undefined symbols throw an exception.
     NSMutableString *errorDescription = [NSMutableString stringWithFormat:@"undefined symbol %@", [self stringValue]];
-    id expression = [context lookupObjectForKey:[symbolTable symbolWithString:@"_expression"]];
+    NuCell *expression = nu_eval_current_expression();
     if (expression) {
         [errorDescription appendFormat:@" while evaluating expression %@", [expression stringValue]];
         const char *filename = nu_parsedFilename([expression file]);
@@ -142,6 +142,9 @@
 
 - (void) prepareAttributeDictionaries
 {
+    // renderings made with the previous dictionaries can no longer be hit
+    markdown_cache_clear();
+    
     // default markdown attributes
     [self.attributeDictionaries setObject:[self attributesWithAlignment:NSTextAlignmentLeft
                                                               textScale:1.0
@@ -250,7 +253,7 @@
     if (!attributes) {
         attributes = [self.attributeDictionaries objectForKey:@"default"];
     }
-    NSAttributedString *result = markdown_to_attr_string(markdown, 0, attributes);
+    NSAttributedString *result = markdown_to_cached_attr_string(markdown, 0, attributes);
     return result;
 }
 
@@ -74,13 +74,10 @@ done:
   return c;
 }
 
-static char *makeCharClass(unsigned char *cclass)
+static void charClassBits(unsigned char *cclass, unsigned char bits[32])
 {
-  unsigned char  bits[32];
   setter         set;
   int            c, prev= -1;
-  static char    string[256];
-  char          *ptr;
 
   if ('^' == *cclass)
     {
@@ -106,6 +103,16 @@ static char *makeCharClass(unsigned char *cclass)
     set(bits, prev= c);
   }
     }
+}
+
+static char *makeCharClass(unsigned char *cclass)
+{
+  unsigned char  bits[32];
+  int            c;
+  static char    string[256];
+  char          *ptr;
+
+  charClassBits(cclass, bits);
 
   ptr= string;
   for (c= 0;  c < 32;  ++c)
@@ -114,6 +121,112 @@ static char *makeCharClass(unsigned char *cclass)
   return string;
 }
 
+/* The argument to yymatchClassRun is the 32-byte bitmap followed by two
+   16-byte tables indexed by the low nibble of a byte: entry l of the first
+   has bit h set when byte h*16+l is in the class, for h in 0..7, and the
+   second does the same for h in 8..15.  The vector scanners in the
+   preamble test sixteen bytes at once by shuffling through these. */
+
+static char *makeClassRun(unsigned char bits[32])
+{
+  unsigned char  tables[32];
+  int            c;
+  static char    string[512];
+  char          *ptr;
+
+  memset(tables, 0, sizeof(tables));
+  for (c= 0;  c < 256;  ++c)
+    if (bits[c >> 3] & (1 << (c & 7)))
+      tables[((c >> 7) << 4) | (c & 15)] |= 1 << ((c >> 4) & 7);
+
+  ptr= string;
+  for (c= 0;  c < 32;  ++c)
+    ptr += sprintf(ptr, "\\%03o", bits[c]);
+  for (c= 0;  c < 32;  ++c)
+    ptr += sprintf(ptr, "\\%03o", tables[c]);
+
+  return string;
+}
+
+/* charSet - answer 1 and leave the accepted bytes in 'bits' if 'node'
+   succeeds exactly when the next input byte is in a fixed set, has no
+   actions, predicates or variables, and (when 'exact') consumes only that
+   one byte.  Without 'exact' the node may consume more after the first
+   byte provided nothing that follows can fail, which is all '!' needs. */
+
+static int charSet(Node *node, unsigned char bits[32], int exact)
+{
+  static int     depth= 0;
+  unsigned char  sub[32];
+  int            i, ok;
+
+  switch (node->type)
+    {
+    case Dot:
+      memset(bits, 255, 32);
+      return 1;
+
+    case Name:
+      {
+        Node *rule= node->name.rule;
+        if (node->name.variable || ((struct Any*) node)->errblock || !rule->rule.expression || rule->rule.variables
+            || (RuleMemo & rule->rule.flags) || depth > 32)
+          return 0;
+        ++depth;
+        ok= charSet(rule->rule.expression, bits, exact);
+        --depth;
+        return ok;
+      }
+
+    case Character:
+    case String:
+      {
+        unsigned char *cp= (unsigned char *)node->string.value;
+        int c;
+        if (!*cp) return 0;
+        c= readChar(&cp);
+        if (*cp) return 0;
+        memset(bits, 0, 32);
+        charClassSet(bits, c);
+        return 1;
+      }
+
+    case Class:
+      charClassBits(node->cclass.value, bits);
+      return 1;
+
+    case Alternate:
+      memset(bits, 0, 32);
+      for (node= node->alternate.first;  node;  node= node->alternate.next)
+        {
+          if (!charSet(node, sub, exact)) return 0;
+          for (i= 0;  i < 32;  ++i) bits[i] |= sub[i];
+        }
+      return 1;
+
+    case Sequence:
+      {
+        unsigned char  mask[32];
+        memset(mask, 255, 32);
+        for (node= node->sequence.first;  node && (PeekNot == node->type || PeekFor == node->type);  node= node->sequence.next)
+          {
+            if (!charSet(node->peekFor.element, sub, 0)) return 0;
+            for (i= 0;  i < 32;  ++i)
+              mask[i] &= (PeekNot == node->type) ? ~sub[i] : sub[i];
+          }
+        if (!node || !charSet(node, bits, exact)) return 0;
+        for (i= 0;  i < 32;  ++i) bits[i] &= mask[i];
+        for (node= node->sequence.next;  node;  node= node->sequence.next)
+          if (exact || (Query != node->type && Star != node->type))
+            return 0;
+        return 1;
+      }
+
+    default:
+      return 0;
+    }
+}
+
 static void begin(void)         { fprintf(output, "\n  {"); }
 static void end(void)           { fprintf(output, "\n  }"); }
 static void label(int n)        { fprintf(output, "\n  l%d:;\t", n); }
@@ -121,6 +234,9 @@ static void jump(int n)         { fprintf(output, "  goto l%d;", n); }
 static void save(int n)         { fprintf(output, "  int yypos%d= G->pos, yythunkpos%d= G->thunkpos;", n, n); }
 static void restore(int n)      { fprintf(output,     "  G->pos= yypos%d; G->thunkpos= yythunkpos%d;", n, n); }
 
+static void memoFetch(int id)  { fprintf(output, "\n#ifdef YY_MEMO\n  int yymemopos= G->pos, yymemothunkpos= G->thunkpos;\n  switch (yyMemoFetch(G, %d)) { case 0: return 0; case 1: return 1; }\n#endif\n", id); }
+static void memoStore(int id, int ok) { fprintf(output, "\n#ifdef YY_MEMO\n  yyMemoStore(G, %d, yymemopos, yymemothunkpos, %d);\n#endif", id, ok); }
+
 static void callErrBlock(Node * node) {
     fprintf(output, " { YY_XTYPE YY_XVAR = (YY_XTYPE) G->data; int yyindex = G->offset + G->pos; %s; }", ((struct Any*) node)->errblock);
 }
@@ -240,7 +356,14 @@ static void Node_compile_c_ko(Node *node, int ko)
 
     case Star:
       {
-        int again= yyl(), out= yyl();
+        int again, out;
+        unsigned char bits[32];
+        if (charSet(node->star.element, bits, 1))
+          {
+            fprintf(output, "  yymatchClassRun(G, (unsigned char *)\"%s\");", makeClassRun(bits));
+            break;
+          }
+        again= yyl();  out= yyl();
         label(again);
         begin();
         save(out);
@@ -254,7 +377,14 @@ static void Node_compile_c_ko(Node *node, int ko)
 
     case Plus:
       {
-        int again= yyl(), out= yyl();
+        int again, out;
+        unsigned char bits[32];
+        if (charSet(node->plus.element, bits, 1))
+          {
+            fprintf(output, "  if (!yymatchClassRun(G, (unsigned char *)\"%s\")) goto l%d;", makeClassRun(bits), ko);
+            break;
+          }
+        again= yyl();  out= yyl();
         Node_compile_c_ko(node->plus.element, ko);
         label(again);
         begin();
@@ -315,7 +445,7 @@ static void Rule_compile_c2(Node *node)
     fprintf(stderr, "rule '%s' used but not defined\n", node->rule.name);
   else
     {
-      int ko= yyl(), safe;
+      int ko= yyl(), safe, memo= (RuleMemo & node->rule.flags);
 
       if ((!(RuleUsed & node->rule.flags)) && (node != start))
         fprintf(stderr, "rule '%s' defined but not used\n", node->rule.name);
@@ -323,6 +453,7 @@ static void Rule_compile_c2(Node *node)
       safe= ((Query == node->rule.expression->type) || (Star == node->rule.expression->type));
 
       fprintf(output, "\nYY_RULE(int) yy_%s(GREG *G)\n{", node->rule.name);
+      if (memo) memoFetch(node->rule.id);
       if (!safe) save(0);
       if (node->rule.variables)
         fprintf(output, "  yyDo(G, yyPush, %d, 0);", countVariables(node->rule.variables));
@@ -331,12 +462,14 @@ static void Rule_compile_c2(Node *node)
       fprintf(output, "\n  yyprintf((stderr, \"  ok   %%s @ %%s\\n\", \"%s\", G->buf+G->pos));", node->rule.name);
       if (node->rule.variables)
         fprintf(output, "  yyDo(G, yyPop, %d, 0);", countVariables(node->rule.variables));
+      if (memo) memoStore(node->rule.id, 1);
       fprintf(output, "\n  return 1;");
       if (!safe)
         {
           label(ko);
           restore(0);
           fprintf(output, "\n  yyprintf((stderr, \"  fail %%s @ %%s\\n\", \"%s\", G->buf+G->pos));", node->rule.name);
+          if (memo) memoStore(node->rule.id, 0);
           fprintf(output, "\n  return 0;");
         }
       fprintf(output, "\n}");
@@ -350,6 +483,11 @@ static char *header= "\
 #include <stdio.h>\n\
 #include <stdlib.h>\n\
 #include <string.h>\n\
+#if defined(__SSSE3__)\n\
+#include <tmmintrin.h>\n\
+#elif defined(__ARM_NEON) && defined(__aarch64__)\n\
+#include <arm_neon.h>\n\
+#endif\n\
 struct _GREG;\n\
 ";
 
@@ -418,6 +556,10 @@ static char *preamble= "\
 #define YY_BUFFER_START_SIZE 1024\n\
 #endif\n\
 \n\
+#ifndef YY_MEMO_START_SIZE\n\
+#define YY_MEMO_START_SIZE 1024\n\
+#endif\n\
+\n\
 #ifndef YY_PART\n\
 #define yydata G->data\n\
 #define yy G->ss\n\
@@ -426,6 +568,11 @@ struct _yythunk; // forward declaration\n\
 typedef void (*yyaction)(struct _GREG *G, char *yytext, int yyleng, struct _yythunk *thunkpos, YY_XTYPE YY_XVAR);\n\
 typedef struct _yythunk { int begin, end;  yyaction  action;  struct _yythunk *next; } yythunk;\n\
 \n\
+#ifdef YY_MEMO\n\
+/* result of a memoized rule at a position: where it ended, and the thunks it left */\n\
+typedef struct _yymemo { int rule, pos, ok, end, begin, textend, thunks, thunkcount; } yymemo;\n\
+#endif\n\
+\n\
 typedef struct _GREG {\n\
   char *buf;\n\
   int buflen;\n\
@@ -444,6 +591,14 @@ typedef struct _GREG {\n\
   YYSTYPE *vals;\n\
   int valslen;\n\
   YY_XTYPE data;\n\
+#ifdef YY_MEMO\n\
+  yymemo *memos;\n\
+  int memoslen;\n\
+  int memocount;\n\
+  yythunk *memothunks;\n\
+  int memothunkslen;\n\
+  int memothunkpos;\n\
+#endif\n\
 } GREG;\n\
 \n\
 YY_LOCAL(int) yyrefill(GREG *G)\n\
@@ -512,6 +667,57 @@ YY_LOCAL(int) yymatchClass(GREG *G, unsigned char *bits)\n\
   return 0;\n\
 }\n\
 \n\
+YY_LOCAL(int) yyscanClass(const unsigned char *bits, const unsigned char *p, int n)\n\
+{\n\
+  int i= 0;\n\
+#if defined(__SSSE3__)\n\
+  const __m128i lo=   _mm_loadu_si128((const __m128i *)(bits + 32));\n\
+  const __m128i hi=   _mm_loadu_si128((const __m128i *)(bits + 48));\n\
+  const __m128i rows= _mm_setr_epi8(1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8, 16, 32, 64, -128);\n\
+  const __m128i nib=  _mm_set1_epi8(15);\n\
+  const __m128i seven= _mm_set1_epi8(7);\n\
+  for (;  i + 16 <= n;  i += 16)\n\
+    {\n\
+      __m128i c=    _mm_loadu_si128((const __m128i *)(p + i));\n\
+      __m128i l=    _mm_and_si128(c, nib);\n\
+      __m128i h=    _mm_and_si128(_mm_srli_epi16(c, 4), nib);\n\
+      __m128i high= _mm_cmpgt_epi8(h, seven);\n\
+      __m128i t=    _mm_or_si128(_mm_andnot_si128(high, _mm_shuffle_epi8(lo, l)), _mm_and_si128(high, _mm_shuffle_epi8(hi, l)));\n\
+      __m128i hit=  _mm_and_si128(t, _mm_shuffle_epi8(rows, h));\n\
+      if (_mm_movemask_epi8(_mm_cmpeq_epi8(hit, _mm_setzero_si128()))) break;\n\
+    }\n\
+#elif defined(__ARM_NEON) && defined(__aarch64__)\n\
+  static const unsigned char yyrows[16]= { 1, 2, 4, 8, 16, 32, 64, 128, 1, 2, 4, 8, 16, 32, 64, 128 };\n\
+  const uint8x16_t lo=   vld1q_u8(bits + 32);\n\
+  const uint8x16_t hi=   vld1q_u8(bits + 48);\n\
+  const uint8x16_t rows= vld1q_u8(yyrows);\n\
+  for (;  i + 16 <= n;  i += 16)\n\
+    {\n\
+      uint8x16_t c=   vld1q_u8(p + i);\n\
+      uint8x16_t l=   vandq_u8(c, vdupq_n_u8(15));\n\
+      uint8x16_t h=   vshrq_n_u8(c, 4);\n\
+      uint8x16_t t=   vbslq_u8(vcgtq_u8(h, vdupq_n_u8(7)), vqtbl1q_u8(hi, l), vqtbl1q_u8(lo, l));\n\
+      uint8x16_t hit= vtstq_u8(t, vqtbl1q_u8(rows, h));\n\
+      if (0 == vminvq_u8(hit)) break;\n\
+    }\n\
+#endif\n\
+  while (i < n && (bits[p[i] >> 3] & (1 << (p[i] & 7))))\n\
+    ++i;\n\
+  return i;\n\
+}\n\
+\n\
+YY_LOCAL(int) yymatchClassRun(GREG *G, unsigned char *bits)\n\
+{\n\
+  int yysav= G->pos;\n\
+  while (G->pos < G->limit || yyrefill(G))\n\
+    {\n\
+      G->pos += yyscanClass(bits, (unsigned char *)G->buf + G->pos, G->limit - G->pos);\n\
+      if (G->pos < G->limit) break;\n\
+    }\n\
+  yyprintf((stderr, \"  %s yymatchClassRun(%d) @ %s\\n\", G->pos > yysav ? \"ok  \" : \"fail\", G->pos - yysav, G->buf+G->pos));\n\
+  return G->pos - yysav;\n\
+}\n\
+\n\
 YY_LOCAL(void) yyDo(GREG *G, yyaction action, int begin, int end)\n\
 {\n\
   while (G->thunkpos >= G->thunkslen)\n\
@@ -556,8 +762,88 @@ YY_LOCAL(void) yyDone(GREG *G)\n\
   G->thunkpos= 0;\n\
 }\n\
 \n\
+#ifdef YY_MEMO\n\
+YY_LOCAL(yymemo *) yyMemoSlot(yymemo *memos, int memoslen, int rule, int pos)\n\
+{\n\
+  unsigned int mask= memoslen - 1;\n\
+  unsigned int i= ((unsigned int)pos * 2654435761u + (unsigned int)rule) & mask;\n\
+  while (memos[i].rule && (memos[i].rule != rule || memos[i].pos != pos))\n\
+    i= (i + 1) & mask;\n\
+  return &memos[i];\n\
+}\n\
+\n\
+YY_LOCAL(int) yyMemoFetch(GREG *G, int rule)\n\
+{\n\
+  yymemo *memo;\n\
+  int i;\n\
+  if (!G->memocount) return -1;\n\
+  memo= yyMemoSlot(G->memos, G->memoslen, rule, G->pos);\n\
+  if (!memo->rule) return -1;\n\
+  for (i= 0; i < memo->thunkcount; ++i)\n\
+    {\n\
+      yythunk *thunk= &G->memothunks[memo->thunks + i];\n\
+      yyDo(G, thunk->action, thunk->begin, thunk->end);\n\
+    }\n\
+  G->pos= memo->end;\n\
+  G->begin= memo->begin;\n\
+  G->end= memo->textend;\n\
+  yyprintf((stderr, \"  memo %d @ %d -> %d\\n\", rule, memo->pos, memo->ok));\n\
+  return memo->ok;\n\
+}\n\
+\n\
+YY_LOCAL(void) yyMemoStore(GREG *G, int rule, int pos, int thunkpos, int ok)\n\
+{\n\
+  yymemo *memo;\n\
+  int count= G->thunkpos - thunkpos;\n\
+  if (2 * (G->memocount + 1) > G->memoslen)\n\
+    {\n\
+      int i, memoslen= G->memoslen ? 2 * G->memoslen : YY_MEMO_START_SIZE;\n\
+      yymemo *memos= (yymemo*)YY_CALLOC(memoslen, sizeof(yymemo), G->data);\n\
+      for (i= 0; i < G->memoslen; ++i)\n\
+        if (G->memos[i].rule)\n\
+          *yyMemoSlot(memos, memoslen, G->memos[i].rule, G->memos[i].pos)= G->memos[i];\n\
+      if (G->memos) YY_FREE(G->memos);\n\
+      G->memos= memos;\n\
+      G->memoslen= memoslen;\n\
+    }\n\
+  memo= yyMemoSlot(G->memos, G->memoslen, rule, pos);\n\
+  if (memo->rule) return;\n\
+  if (!G->memothunkslen)\n\
+    {\n\
+      G->memothunkslen= YY_STACK_SIZE;\n\
+      G->memothunks= (yythunk*)YY_ALLOC(sizeof(yythunk) * G->memothunkslen, G->data);\n\
+    }\n\
+  while (G->memothunkpos + count > G->memothunkslen)\n\
+    {\n\
+      G->memothunkslen *= 2;\n\
+      G->memothunks= (yythunk*)YY_REALLOC(G->memothunks, sizeof(yythunk) * G->memothunkslen, G->data);\n\
+    }\n\
+  memcpy(G->memothunks + G->memothunkpos, G->thunks + thunkpos, sizeof(yythunk) * count);\n\
+  memo->rule= rule;\n\
+  memo->pos= pos;\n\
+  memo->ok= ok;\n\
+  memo->end= G->pos;\n\
+  memo->begin= G->begin;\n\
+  memo->textend= G->end;\n\
+  memo->thunks= G->memothunkpos;\n\
+  memo->thunkcount= count;\n\
+  G->memothunkpos += count;\n\
+  ++G->memocount;\n\
+}\n\
+\n\
+YY_LOCAL(void) yyMemoClear(GREG *G)\n\
+{\n\
+  if (G->memocount) memset(G->memos, 0, sizeof(yymemo) * G->memoslen);\n\
+  G->memocount= 0;\n\
+  G->memothunkpos= 0;\n\
+}\n\
+#endif\n\
+\n\
 YY_LOCAL(void) yyCommit(GREG *G)\n\
 {\n\
+#ifdef YY_MEMO\n\
+  yyMemoClear(G);\n\
+#endif\n\
   if ((G->limit -= G->pos))\n\
     {\n\
       memmove(G->buf, G->buf + G->pos, G->limit);\n\
@@ -627,6 +913,7 @@ YY_PARSE(int) YY_NAME(parse_from)(GREG *G, yyrule yystart)\n\
   (void)yymatchChar;\n\
   (void)yymatchString;\n\
   (void)yymatchClass;\n\
+  (void)yymatchClassRun;\n\
   (void)yyDo;\n\
   (void)yyText;\n\
   (void)yyDone;\n\
@@ -635,6 +922,10 @@ YY_PARSE(int) YY_NAME(parse_from)(GREG *G, yyrule yystart)\n\
   (void)yyPush;\n\
   (void)yyPop;\n\
   (void)yySet;\n\
+#ifdef YY_MEMO\n\
+  (void)yyMemoFetch;\n\
+  (void)yyMemoStore;\n\
+#endif\n\
 }\n\
 \n\
 YY_PARSE(int) YY_NAME(parse)(GREG *G)\n\
@@ -652,6 +943,10 @@ YY_PARSE(void) YY_NAME(deinit)(GREG *G)\n\
     if (G->text) YY_FREE(G->text);\n\
     if (G->thunks) YY_FREE(G->thunks);\n\
     if (G->vals) YY_FREE(G->vals);\n\
+#ifdef YY_MEMO\n\
+    if (G->memos) YY_FREE(G->memos);\n\
+    if (G->memothunks) YY_FREE(G->memothunks);\n\
+#endif\n\
 }\n\
 YY_PARSE(GREG *) YY_NAME(parse_new)(YY_XTYPE data)\n\
 {\n\
@@ -18,8 +18,34 @@ enum markdown_formats {
     GROFF_MM_FORMAT
 };
 
+/* markdown_to_attr_string keeps all parsing and printing state on the stack,
+ * so it may be called concurrently from several threads. The merged styles
+ * for each attribute set are interned across calls, keyed by the identity of
+ * the attributes dictionary; call markdown_cache_clear after mutating one. */
 NSMutableAttributedString* markdown_to_attr_string(NSString *text, int extensions, NSDictionary* attributes);
 
+/* markdown_to_cached_attr_string returns a shared, immutable rendering and
+ * only parses text that is not already in the cache. Attribute sets are
+ * matched by identity, so rebuilt attribute dictionaries miss the cache. */
+NSAttributedString* markdown_to_cached_attr_string(NSString *text, int extensions, NSDictionary* attributes);
+
+struct markdown_cache_stats {
+    NSUInteger hits;
+    NSUInteger misses;
+    NSUInteger evictions;
+    NSUInteger count;       /* number of cached renderings */
+    NSUInteger cost;        /* estimated bytes held */
+    NSUInteger limit;       /* maximum estimated bytes held */
+};
+
+void markdown_cache_set_limit(NSUInteger bytes);
+void markdown_cache_clear(void);     /* also forgets interned styles */
+struct markdown_cache_stats markdown_cache_get_stats(void);
+
+/* markdown_to_nsstring and markdown_to_string render text as HTML; the
+ * other formats are not implemented and produce an empty result.
+ * markdown_to_string returns autoreleased UTF-8 bytes, valid until the
+ * current autorelease pool is drained. */
 NSMutableString * markdown_to_nsstring(NSString *text, int extensions, int output_format);
 const char * markdown_to_string(NSString *text, int extensions, int output_format);
 
@@ -23,126 +23,269 @@
 
 #define TABSTOP 4
 
-/* preformat_text - allocate and copy text buffer while
- * performing tab expansion. */
-static NSMutableString *preformat_text(NSString *text) {
-    NSMutableString *buf = [[[NSMutableString alloc] init] autorelease];
-    unichar next_char;
-    int len = 0;
+/* preformat_text - convert text to a UTF-8 buffer while
+ * performing tab expansion.  nil text is treated as empty. */
+static NSMutableData *preformat_text(NSString *text) {
+    const char *source = text ? [text UTF8String] : "";
+    NSUInteger length = strlen(source);
+    NSMutableData *buf = [NSMutableData dataWithCapacity:length + length / 8 + 2];
+    NSUInteger start = 0;
     int charstotab = TABSTOP;
-    for (NSUInteger i = 0; i < text.length; ++i) {
-        next_char = [text characterAtIndex:i];
+    for (NSUInteger i = 0; i < length; ++i) {
+        unsigned char next_char = source[i];
         switch (next_char) {
         case '\t':
-            while (charstotab > 0)
-                [buf appendCharacter:' '], len++, charstotab--;
+            [buf appendBytes:source + start length:i - start];
+            [buf appendBytes:"    " length:charstotab];
+            start = i + 1;
+            charstotab = TABSTOP;
             break;
         case '\n':
-            [buf appendCharacter:'\n'], len++, charstotab = TABSTOP;
+            charstotab = TABSTOP;
             break;
         default:
-            [buf appendCharacter:next_char], len++, charstotab--;
+            /* count characters, not UTF-8 continuation bytes */
+            if ((next_char & 0xC0) != 0x80 && --charstotab == 0)
+                charstotab = TABSTOP;
         }
-        if (charstotab == 0)
-            charstotab = TABSTOP;
     }
-    [buf appendString:@"\n\n"];
+    [buf appendBytes:source + start length:length - start];
+    [buf appendBytes:"\n\n" length:2];
     return(buf);
 }
 
 /* process_raw_blocks - traverses an element list, replacing any RAW elements with
  * the result of parsing them as markdown text, and recursing into the children
  * of parent elements.  The result should be a tree of elements without any RAWs. */
-static element * process_raw_blocks(element *input, int extensions, element *references, element *notes) {
+static element * process_raw_blocks(Arena *arena, element *input, int extensions, element *references, element *notes) {
     element *current = NULL;
-    element *last_child = NULL;
     current = input;
 
     while (current != NULL) {
         if (current->key == RAW) {
+            element *last_child = NULL;
             current->key = LIST;
             /* \001 is used to indicate boundaries between nested lists when there
-             * is no blank line.  We split the string by \001 and parse
-             * each chunk separately. */
-            NSArray *chunks = [current->contents.str componentsSeparatedByString:@"\001"];
-            for (NSString *contents in chunks) {
+             * is no blank line.  We parse each \001-separated slice of the
+             * block's text separately, in place. */
+            const char *bytes = [current->contents.str UTF8String];
+            const char *end = bytes + strlen(bytes);
+            for (;;) {
+                const char *stop = memchr(bytes, '\001', end - bytes);
+                if (stop == NULL)
+                    stop = end;
+                element *chunk = parse_markdown(arena, bytes, stop - bytes, extensions, references, notes);
                 if (!last_child) {
-                    current->children = parse_markdown(contents, extensions, references, notes);
+                    current->children = chunk;
                     last_child = current->children;
                 } else {
                     while (last_child->next != NULL)
                         last_child = last_child->next;
-                    last_child->next = parse_markdown(contents, extensions, references, notes);
+                    last_child->next = chunk;
                 }
+                if (stop == end)
+                    break;
+                bytes = stop + 1;
             }
-            [current->contents.str release];
             current->contents.str = nil;
         }
         if (current->children != NULL)
-            current->children = process_raw_blocks(current->children, extensions, references, notes);
+            current->children = process_raw_blocks(arena, current->children, extensions, references, notes);
         current = current->next;
     }
     return input;
 }
 
+/* parse_text - parse text into a tree of elements owned by arena. */
+static element * parse_text(Arena *arena, NSString *text, int extensions) {
+    NSMutableData *formatted_text = preformat_text(text);
+    element *references = NULL;
+    element *notes = NULL;
+    element *result = parse_document(arena, [formatted_text bytes], [formatted_text length], extensions, &references, &notes);
+    return process_raw_blocks(arena, result, extensions, references, notes);
+}
+
+/* markdown_to_data - render text in one of the text output formats,
+ * returning UTF-8 bytes followed by a NUL that the length does not count. */
+static NSData * markdown_to_data(NSString *text, int extensions, int output_format) {
+    Arena *arena = new_arena();
+    element *result = parse_text(arena, text, extensions);
+
+    Buffer out;
+    init_buffer(&out, text.length + text.length / 2);
+    print_element_list(&out, result, output_format, extensions);
+
+    free_arena(arena);
+    return [NSData dataWithBytesNoCopy:out.bytes length:out.length freeWhenDone:YES];
+}
+
+NSMutableString * markdown_to_nsstring(NSString *text, int extensions, int output_format) {
+    NSData *data = markdown_to_data(text, extensions, output_format);
+    return [[[NSMutableString alloc] initWithBytes:[data bytes] length:[data length] encoding:NSUTF8StringEncoding] autorelease];
+}
+
+const char * markdown_to_string(NSString *text, int extensions, int output_format) {
+    return [markdown_to_data(text, extensions, output_format) bytes];
+}
+
 NSMutableAttributedString* markdown_to_attr_string(NSString *text, int extensions, NSDictionary* attributes) {
     NSMutableAttributedString *out = [[[NSMutableAttributedString alloc] init] autorelease];
     
-    NSMutableString *formatted_text = preformat_text(text);
-    
-    element *references = parse_references(formatted_text, extensions);
-    element *notes = parse_notes(formatted_text, extensions, references);
-    element *result = parse_markdown(formatted_text, extensions, references, notes);
-    result = process_raw_blocks(result, extensions, references, notes);
+    Arena *arena = new_arena();
+    element *result = parse_text(arena, text, extensions);
     
     [out beginEditing];
-    
-    NSDictionary *_attributes[] = {
-        [LIST] =        [attributes objectForKey:[NSNumber numberWithInt:LIST]],
-        [RAW] =         [attributes objectForKey:[NSNumber numberWithInt:RAW]],
-        [SPACE]=        [attributes objectForKey:[NSNumber numberWithInt:SPACE]],
-        [LINEBREAK]=    [attributes objectForKey:[NSNumber numberWithInt:LINEBREAK]],
-        [ELLIPSIS]=     [attributes objectForKey:[NSNumber numberWithInt:ELLIPSIS]],
-        [EMDASH]=       [attributes objectForKey:[NSNumber numberWithInt:EMDASH]],
-        [ENDASH]=       [attributes objectForKey:[NSNumber numberWithInt:ENDASH]],
-        [APOSTROPHE]=   [attributes objectForKey:[NSNumber numberWithInt:APOSTROPHE]],
-        [SINGLEQUOTED]= [attributes objectForKey:[NSNumber numberWithInt:SINGLEQUOTED]],
-        [DOUBLEQUOTED]= [attributes objectForKey:[NSNumber numberWithInt:DOUBLEQUOTED]],
-        [STRING]=       [attributes objectForKey:[NSNumber numberWithInt:STRING]],
-        [LINK]=         [attributes objectForKey:[NSNumber numberWithInt:LINK]],
-        [IMAGE]=        [attributes objectForKey:[NSNumber numberWithInt:IMAGE]],
-        [CODE]=         [attributes objectForKey:[NSNumber numberWithInt:CODE]],
-        [HTML]=         [attributes objectForKey:[NSNumber numberWithInt:HTML]],
-        [EMPH]=         [attributes objectForKey:[NSNumber numberWithInt:EMPH]],
-        [STRONG]=       [attributes objectForKey:[NSNumber numberWithInt:STRONG]],
-        [PLAIN]=        [attributes objectForKey:[NSNumber numberWithInt:PLAIN]],
-        [PARA]=         [attributes objectForKey:[NSNumber numberWithInt:PARA]],
-        [LISTITEM]=     [attributes objectForKey:[NSNumber numberWithInt:LISTITEM]],
-        [BULLETLIST]=   [attributes objectForKey:[NSNumber numberWithInt:BULLETLIST]],
-        [ORDEREDLIST]=  [attributes objectForKey:[NSNumber numberWithInt:ORDEREDLIST]],
-        [H1]=           [attributes objectForKey:[NSNumber numberWithInt:H1]],
-        [H2]=           [attributes objectForKey:[NSNumber numberWithInt:H2]],
-        [H3]=           [attributes objectForKey:[NSNumber numberWithInt:H3]],
-        [H4]=           [attributes objectForKey:[NSNumber numberWithInt:H4]],
-        [H5]=           [attributes objectForKey:[NSNumber numberWithInt:H5]],
-        [H6]=           [attributes objectForKey:[NSNumber numberWithInt:H6]],
-        [BLOCKQUOTE]=   [attributes objectForKey:[NSNumber numberWithInt:BLOCKQUOTE]],
-        [VERBATIM]=     [attributes objectForKey:[NSNumber numberWithInt:VERBATIM]],
-        [HTMLBLOCK]=    [attributes objectForKey:[NSNumber numberWithInt:HTMLBLOCK]],
-        [HRULE]=        [attributes objectForKey:[NSNumber numberWithInt:HRULE]],
-        [REFERENCE]=    [attributes objectForKey:[NSNumber numberWithInt:REFERENCE]],
-        [NOTE]=         [attributes objectForKey:[NSNumber numberWithInt:NOTE]],
-    };
-
-    
-    print_element_list_attr(out, result, extensions, _attributes, @{});
+    print_element_list_attr(out, result, extensions, style_root(attributes));
     [out endEditing];
     
-    free_element_list(result);
-    free_element_list(references);
+    free_arena(arena);
     return out;
 }
 
+/**********************************************************************
+
+  Cache of rendered attributed strings.
+  Entries are keyed by (text, extensions, attribute set) and kept in
+  least-recently-used order; the oldest entries are evicted when the
+  total estimated cost exceeds the limit.
+
+ ***********************************************************************/
+
+#define DEFAULT_CACHE_LIMIT (1024 * 1024)
+
+@interface MarkdownCacheEntry : NSObject {
+@public
+    NSString *text;
+    int extensions;
+    NSDictionary *attributes;   /* compared by identity */
+    NSAttributedString *result;
+    NSUInteger cost;
+    NSUInteger hash;
+    MarkdownCacheEntry *prev;   /* unretained, toward most recently used */
+    MarkdownCacheEntry *next;   /* unretained, toward least recently used */
+}
+@end
+
+@implementation MarkdownCacheEntry
+
+- (NSUInteger)hash {
+    return hash;
+}
+
+- (BOOL)isEqual:(id)object {
+    MarkdownCacheEntry *other = (MarkdownCacheEntry *) object;
+    return (other->hash == hash) &&
+           (other->extensions == extensions) &&
+           (other->attributes == attributes) &&
+           [other->text isEqualToString:text];
+}
+
+- (void)dealloc {
+    [text release];
+    [attributes release];
+    [result release];
+    [super dealloc];
+}
+
+@end
+
+static NSMutableSet *cache_entries = nil;
+static MarkdownCacheEntry *cache_head = nil;   /* most recently used */
+static MarkdownCacheEntry *cache_tail = nil;   /* least recently used */
+static struct markdown_cache_stats cache_stats = { 0, 0, 0, 0, 0, DEFAULT_CACHE_LIMIT };
+
+static void cache_unlink(MarkdownCacheEntry *entry) {
+    if (entry->prev)
+        entry->prev->next = entry->next;
+    else
+        cache_head = entry->next;
+    if (entry->next)
+        entry->next->prev = entry->prev;
+    else
+        cache_tail = entry->prev;
+    entry->prev = entry->next = nil;
+}
+
+static void cache_push_front(MarkdownCacheEntry *entry) {
+    entry->prev = nil;
+    entry->next = cache_head;
+    if (cache_head)
+        cache_head->prev = entry;
+    cache_head = entry;
+    if (!cache_tail)
+        cache_tail = entry;
+}
+
+/* cache_trim - evict least recently used entries until under 'limit'. */
+static void cache_trim(NSUInteger limit) {
+    while (cache_tail && cache_stats.cost > limit) {
+        MarkdownCacheEntry *victim = cache_tail;
+        cache_unlink(victim);
+        cache_stats.cost -= victim->cost;
+        cache_stats.count--;
+        cache_stats.evictions++;
+        [cache_entries removeObject:victim];
+    }
+}
+
+NSAttributedString* markdown_to_cached_attr_string(NSString *text, int extensions, NSDictionary* attributes) {
+    MarkdownCacheEntry *probe = [[[MarkdownCacheEntry alloc] init] autorelease];
+    probe->text = [text copy];
+    probe->extensions = extensions;
+    probe->attributes = [attributes retain];
+    probe->hash = [text hash] ^ (NSUInteger) extensions ^ (NSUInteger) attributes;
+
+    @synchronized([MarkdownCacheEntry class]) {
+        if (!cache_entries)
+            cache_entries = [[NSMutableSet alloc] init];
+        MarkdownCacheEntry *entry = [cache_entries member:probe];
+        if (entry) {
+            cache_stats.hits++;
+            cache_unlink(entry);
+            cache_push_front(entry);
+            return [[entry->result retain] autorelease];
+        }
+        cache_stats.misses++;
+    }
+
+    /* render outside the lock; markdown_to_attr_string is reentrant */
+    probe->result = [markdown_to_attr_string(text, extensions, attributes) copy];
+    probe->cost = (text.length + probe->result.length) * sizeof(unichar) + sizeof(MarkdownCacheEntry);
+
+    @synchronized([MarkdownCacheEntry class]) {
+        if (![cache_entries member:probe] && probe->cost <= cache_stats.limit) {
+            [cache_entries addObject:probe];
+            cache_push_front(probe);
+            cache_stats.cost += probe->cost;
+            cache_stats.count++;
+            cache_trim(cache_stats.limit);
+        }
+    }
+    return [[probe->result retain] autorelease];
+}
+
+void markdown_cache_set_limit(NSUInteger bytes) {
+    @synchronized([MarkdownCacheEntry class]) {
+        cache_stats.limit = bytes;
+        cache_trim(bytes);
+    }
+}
+
+void markdown_cache_clear(void) {
+    @synchronized([MarkdownCacheEntry class]) {
+        cache_trim(0);
+    }
+    clear_style_roots();
+}
+
+struct markdown_cache_stats markdown_cache_get_stats(void) {
+    struct markdown_cache_stats stats;
+    @synchronized([MarkdownCacheEntry class]) {
+        stats = cache_stats;
+    }
+    return stats;
+}
+
 @implementation NSString (Sugar)
 
 - (const char *)defaultCString {
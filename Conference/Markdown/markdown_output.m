@@ -25,30 +25,98 @@
 #import "markdown_peg.h"
 #import "platform.h"
 
-static int extensions;
-
-static void print_attr_string(NSMutableAttributedString *out, NSString *str, NSDictionary *current);
-static void print_attr_element_list(NSMutableAttributedString *out, element *list, NSDictionary *attributes[], NSDictionary *current);
-static void print_attr_element(NSMutableAttributedString *out, element *elt, NSDictionary *attributes[], NSDictionary *current);
+/* Printing state for one call to print_element_list_attr.
+ * Kept per call rather than in globals so documents can be printed concurrently. */
+struct Output {
+    int extensions;
+    int indentation;
+    int padded;                 /* Number of newlines after last output.
+                                   Starts at 2 so no newlines are needed at start. */
+    NSMutableArray *endnotes;   /* List of endnotes to print after main content. */
+    int notenumber;             /* Number of footnote. */
+};
+
+/* Text printed for an attributed string, kept as one character buffer and a
+ * table of attribute runs until the whole document has been printed. */
+struct Run {
+    NSUInteger start;           /* index of the run's first character */
+    NSDictionary *attributes;   /* unretained; interned styles outlive the print */
+};
+
+struct Runs {
+    unichar *chars;
+    NSUInteger length;
+    NSUInteger capacity;
+    struct Run *runs;
+    NSUInteger count;
+    NSUInteger runs_capacity;
+};
+
+static void print_attr_string(struct Runs *out, NSString *str, NSDictionary *current);
+static void print_attr_element_list(struct Output *state, struct Runs *out, element *list, MarkdownStyle *current);
+static void print_attr_element(struct Output *state, struct Runs *out, element *elt, MarkdownStyle *current);
+static void add_endnote(struct Output *state, element *elt);
 /**********************************************************************
 
-  Utility functions for printing
+  Output buffer
 
  ***********************************************************************/
 
-static int indentation = 0;
-static int padded = 2;      /* Number of newlines after last output.
-                               Starts at 2 so no newlines are needed at start.
-                               */
+/* init_buffer - start an empty buffer with room for 'capacity' bytes. */
+void init_buffer(Buffer *buf, NSUInteger capacity) {
+    buf->capacity = capacity + 1;
+    buf->bytes = malloc(buf->capacity);
+    buf->bytes[0] = '\0';
+    buf->length = 0;
+}
+
+/* buffer_reserve - make room for 'extra' more bytes and the terminating NUL. */
+static void buffer_reserve(Buffer *buf, NSUInteger extra) {
+    NSUInteger needed = buf->length + extra + 1;
+    if (needed > buf->capacity) {
+        NSUInteger capacity = buf->capacity ? buf->capacity : 256;
+        while (capacity < needed)
+            capacity *= 2;
+        buf->bytes = realloc(buf->bytes, capacity);
+        buf->capacity = capacity;
+    }
+}
 
-static NSMutableArray *endnotes = nil; /* List of endnotes to print after main content. */
-static int notenumber = 0;  /* Number of footnote. */
+static void buffer_append(Buffer *buf, const char *bytes, NSUInteger length) {
+    buffer_reserve(buf, length);
+    memcpy(buf->bytes + buf->length, bytes, length);
+    buf->length += length;
+    buf->bytes[buf->length] = '\0';
+}
+
+/* append a string literal without measuring it */
+#define buffer_append_literal(buf, literal) buffer_append(buf, literal, sizeof(literal) - 1)
+
+static void buffer_append_int(Buffer *buf, int n) {
+    char digits[16];
+    buffer_append(buf, digits, snprintf(digits, sizeof(digits), "%d", n));
+}
+
+/* buffer_append_string - append the UTF-8 encoding of str, converting
+ * straight into the buffer.  Returns the number of bytes added. */
+static NSUInteger buffer_append_string(Buffer *buf, NSString *str) {
+    NSUInteger length = str.length;
+    NSUInteger used = 0;
+    if (length == 0)
+        return 0;
+    buffer_reserve(buf, length * 3);
+    [str getBytes:buf->bytes + buf->length maxLength:length * 3 usedLength:&used
+         encoding:NSUTF8StringEncoding options:0 range:NSMakeRange(0, length) remainingRange:NULL];
+    buf->length += used;
+    buf->bytes[buf->length] = '\0';
+    return used;
+}
 
 /* pad - add newlines if needed */
-static void pad(NSMutableString *out, int num) {
-    while (num-- > padded)
-        [out appendString:@"\n"];
-    padded = num;
+static void pad(struct Output *state, Buffer *out, int num) {
+    while (num-- > state->padded)
+        buffer_append_literal(out, "\n");
+    state->padded = num;
 }
 
 /**********************************************************************
@@ -57,41 +125,336 @@ static void pad(NSMutableString *out, int num) {
 
  ***********************************************************************/
 
-/* print_html_string - print string, escaping for HTML  
+/* html_entity - the escape for an HTML special character, or NULL. */
+static const char *html_entity(unsigned char ch) {
+    switch (ch) {
+    case '&':   return "&amp;";
+    case '<':   return "&lt;";
+    case '>':   return "&gt;";
+    case '"':   return "&quot;";
+    default:    return NULL;
+    }
+}
+
+/* print_html_string - print string, escaping for HTML
  * If obfuscate selected, convert characters to hex or decimal entities at random */
-static void print_html_string(NSMutableString *out, NSString *str, bool obfuscate) {
-  NSUInteger i;
-  unichar ch;
-  for (i = 0; i < str.length; ++i) {
-    ch = [str characterAtIndex:i];
-        switch (ch) {
-        case '&':
-            [out appendString:@"&amp;"];
-            break;
-        case '<':
-            [out appendString:@"&lt;"];
-            break;
-        case '>':
-            [out appendString:@"&gt;"];
-            break;
-        case '"':
-            [out appendString:@"&quot;"];
-            break;
-        default:
-            if (obfuscate) {
+static void print_html_string(Buffer *out, NSString *str, bool obfuscate) {
+    if (str == nil)
+        return;
+    if (obfuscate) {
+        const unsigned char *s;
+        for (s = (const unsigned char *) [str UTF8String]; *s; ++s) {
+            const char *entity = html_entity(*s);
+            if (entity) {
+                buffer_append(out, entity, strlen(entity));
+            } else if (*s >= 0x80) {
+                buffer_append(out, (const char *) s, 1);
+            } else {
+                char ref[8];
                 if (rand() % 2 == 0)
-                    [out appendFormat:@"&#%d;", (int) ch];
+                    buffer_append(out, ref, snprintf(ref, sizeof(ref), "&#%d;", (int) *s));
                 else
-                    [out appendFormat:@"&#x%x;", (unsigned int) ch];
+                    buffer_append(out, ref, snprintf(ref, sizeof(ref), "&#x%x;", (unsigned int) *s));
             }
-            else
-                [out appendCharacter:ch];
         }
+        return;
+    }
+
+    /* Encode in place, then widen any special characters from the back. */
+    NSUInteger start = out->length;
+    NSUInteger used = buffer_append_string(out, str);
+    NSUInteger extra = 0;
+    NSUInteger i;
+    for (i = start; i < start + used; ++i) {
+        const char *entity = html_entity(out->bytes[i]);
+        if (entity)
+            extra += strlen(entity) - 1;
+    }
+    if (extra == 0)
+        return;
+    buffer_reserve(out, extra);
+    char *src = out->bytes + start + used;
+    char *dst = src + extra;
+    out->length += extra;
+    out->bytes[out->length] = '\0';
+    while (src > out->bytes + start) {
+        const char *entity = html_entity(*--src);
+        if (entity) {
+            size_t n = strlen(entity);
+            dst -= n;
+            memcpy(dst, entity, n);
+        } else {
+            *--dst = *src;
+        }
+    }
+}
+
+static void print_html_element_list(struct Output *state, Buffer *out, element *list, bool obfuscate);
+
+/* print_html_element - print an element as HTML. */
+static void print_html_element(struct Output *state, Buffer *out, element *elt, bool obfuscate) {
+    int lev;
+    switch (elt->key) {
+    case SPACE:
+        buffer_append_string(out, elt->contents.str);
+        break;
+    case LINEBREAK:
+        buffer_append_literal(out, "<br/>\n");
+        break;
+    case STRING:
+        print_html_string(out, elt->contents.str, obfuscate);
+        break;
+    case ELLIPSIS:
+        buffer_append_literal(out, "&hellip;");
+        break;
+    case EMDASH:
+        buffer_append_literal(out, "&mdash;");
+        break;
+    case ENDASH:
+        buffer_append_literal(out, "&ndash;");
+        break;
+    case APOSTROPHE:
+        buffer_append_literal(out, "&rsquo;");
+        break;
+    case SINGLEQUOTED:
+        buffer_append_literal(out, "&lsquo;");
+        print_html_element_list(state, out, elt->children, obfuscate);
+        buffer_append_literal(out, "&rsquo;");
+        break;
+    case DOUBLEQUOTED:
+        buffer_append_literal(out, "&ldquo;");
+        print_html_element_list(state, out, elt->children, obfuscate);
+        buffer_append_literal(out, "&rdquo;");
+        break;
+    case CODE:
+        buffer_append_literal(out, "<code>");
+        print_html_string(out, elt->contents.str, obfuscate);
+        buffer_append_literal(out, "</code>");
+        break;
+    case HTML:
+        buffer_append_string(out, elt->contents.str);
+        break;
+    case LINK:
+        if ([elt->contents.link->url hasPrefix:@"mailto:"])
+            obfuscate = true;  /* obfuscate mailto: links */
+        buffer_append_literal(out, "<a href=\"");
+        print_html_string(out, elt->contents.link->url, obfuscate);
+        buffer_append_literal(out, "\"");
+        if (elt->contents.link->title.length > 0) {
+            buffer_append_literal(out, " title=\"");
+            print_html_string(out, elt->contents.link->title, obfuscate);
+            buffer_append_literal(out, "\"");
+        }
+        buffer_append_literal(out, ">");
+        print_html_element_list(state, out, elt->contents.link->label, obfuscate);
+        buffer_append_literal(out, "</a>");
+        break;
+    case IMAGE:
+        buffer_append_literal(out, "<img src=\"");
+        print_html_string(out, elt->contents.link->url, obfuscate);
+        buffer_append_literal(out, "\" alt=\"");
+        print_html_element_list(state, out, elt->contents.link->label, obfuscate);
+        buffer_append_literal(out, "\"");
+        if (elt->contents.link->title.length > 0) {
+            buffer_append_literal(out, " title=\"");
+            print_html_string(out, elt->contents.link->title, obfuscate);
+            buffer_append_literal(out, "\"");
+        }
+        buffer_append_literal(out, " />");
+        break;
+    case EMPH:
+        buffer_append_literal(out, "<em>");
+        print_html_element_list(state, out, elt->children, obfuscate);
+        buffer_append_literal(out, "</em>");
+        break;
+    case STRONG:
+        buffer_append_literal(out, "<strong>");
+        print_html_element_list(state, out, elt->children, obfuscate);
+        buffer_append_literal(out, "</strong>");
+        break;
+    case LIST:
+        print_html_element_list(state, out, elt->children, obfuscate);
+        break;
+    case RAW:
+        /* Shouldn't occur - these are handled by process_raw_blocks() */
+        assert(elt->key != RAW);
+        break;
+    case H1: case H2: case H3: case H4: case H5: case H6:
+        lev = elt->key - H1 + 1;  /* assumes H1 ... H6 are in order */
+        pad(state, out, 2);
+        buffer_append_literal(out, "<h");
+        buffer_append_int(out, lev);
+        buffer_append_literal(out, ">");
+        print_html_element_list(state, out, elt->children, obfuscate);
+        buffer_append_literal(out, "</h");
+        buffer_append_int(out, lev);
+        buffer_append_literal(out, ">");
+        state->padded = 0;
+        break;
+    case PLAIN:
+        pad(state, out, 1);
+        print_html_element_list(state, out, elt->children, obfuscate);
+        state->padded = 0;
+        break;
+    case PARA:
+        pad(state, out, 2);
+        buffer_append_literal(out, "<p>");
+        print_html_element_list(state, out, elt->children, obfuscate);
+        buffer_append_literal(out, "</p>");
+        state->padded = 0;
+        break;
+    case HRULE:
+        pad(state, out, 2);
+        buffer_append_literal(out, "<hr />");
+        state->padded = 0;
+        break;
+    case HTMLBLOCK:
+        pad(state, out, 2);
+        buffer_append_string(out, elt->contents.str);
+        state->padded = 0;
+        break;
+    case VERBATIM:
+        pad(state, out, 2);
+        buffer_append_literal(out, "<pre><code>");
+        print_html_string(out, elt->contents.str, obfuscate);
+        buffer_append_literal(out, "</code></pre>");
+        state->padded = 0;
+        break;
+    case BULLETLIST:
+        pad(state, out, 2);
+        buffer_append_literal(out, "<ul>");
+        state->padded = 0;
+        print_html_element_list(state, out, elt->children, obfuscate);
+        pad(state, out, 1);
+        buffer_append_literal(out, "</ul>");
+        state->padded = 0;
+        break;
+    case ORDEREDLIST:
+        pad(state, out, 2);
+        buffer_append_literal(out, "<ol>");
+        state->padded = 0;
+        print_html_element_list(state, out, elt->children, obfuscate);
+        pad(state, out, 1);
+        buffer_append_literal(out, "</ol>");
+        state->padded = 0;
+        break;
+    case LISTITEM:
+        pad(state, out, 1);
+        buffer_append_literal(out, "<li>");
+        state->padded = 2;
+        print_html_element_list(state, out, elt->children, obfuscate);
+        buffer_append_literal(out, "</li>");
+        state->padded = 0;
+        break;
+    case BLOCKQUOTE:
+        pad(state, out, 2);
+        buffer_append_literal(out, "<blockquote>\n");
+        state->padded = 2;
+        print_html_element_list(state, out, elt->children, obfuscate);
+        pad(state, out, 1);
+        buffer_append_literal(out, "</blockquote>");
+        state->padded = 0;
+        break;
+    case REFERENCE:
+        /* Nonprinting */
+        break;
+    case NOTE:
+        /* if contents.str == 0, then print note; else ignore, since this
+         * is a note block that has been incorporated into the notes list */
+        if (elt->contents.str == nil) {
+            add_endnote(state, elt);
+            ++state->notenumber;
+            buffer_append_literal(out, "<a class=\"noteref\" id=\"fnref");
+            buffer_append_int(out, state->notenumber);
+            buffer_append_literal(out, "\" href=\"#fn");
+            buffer_append_int(out, state->notenumber);
+            buffer_append_literal(out, "\" title=\"Jump to note ");
+            buffer_append_int(out, state->notenumber);
+            buffer_append_literal(out, "\">[");
+            buffer_append_int(out, state->notenumber);
+            buffer_append_literal(out, "]</a>");
+        }
+        break;
+    default:
+        fprintf(stderr, "print_html_element encountered unknown element key = %d\n", elt->key);
+        exit(EXIT_FAILURE);
     }
 }
 
-static void print_attr_string(NSMutableAttributedString *out, NSString *str, NSDictionary* current) {
-    [out appendAttributedString:[[[NSAttributedString alloc]initWithString:str attributes:current] autorelease]];
+static void print_html_element_list(struct Output *state, Buffer *out, element *list, bool obfuscate) {
+    while (list != NULL) {
+        print_html_element(state, out, list, obfuscate);
+        list = list->next;
+    }
+}
+
+/* print_html_endnotes - print the notes collected by print_html_element. */
+static void print_html_endnotes(struct Output *state, Buffer *out) {
+    int counter = 0;
+    if (state->endnotes == nil)
+        return;
+    buffer_append_literal(out, "<hr/>\n<ol id=\"notes\">");
+    for (NSValue *note in state->endnotes) {
+        element *note_elt = (element *) [note pointerValue];
+        counter++;
+        pad(state, out, 1);
+        buffer_append_literal(out, "<li id=\"fn");
+        buffer_append_int(out, counter);
+        buffer_append_literal(out, "\">\n");
+        state->padded = 2;
+        print_html_element_list(state, out, note_elt->children, false);
+        buffer_append_literal(out, " <a href=\"#fnref");
+        buffer_append_int(out, counter);
+        buffer_append_literal(out, "\" title=\"Jump back to reference\">[back]</a>");
+        pad(state, out, 1);
+        buffer_append_literal(out, "</li>");
+    }
+    pad(state, out, 1);
+    buffer_append_literal(out, "</ol>");
+}
+
+/* print_attr_string - add str to the character buffer, extending the last
+ * run when it has the same (interned) attributes. */
+static void print_attr_string(struct Runs *out, NSString *str, NSDictionary* current) {
+    NSUInteger length = str.length;
+    if (length == 0)
+        return;
+    if (out->length + length > out->capacity) {
+        out->capacity = out->capacity ? out->capacity : 256;
+        while (out->length + length > out->capacity)
+            out->capacity *= 2;
+        out->chars = realloc(out->chars, out->capacity * sizeof(unichar));
+    }
+    [str getCharacters:out->chars + out->length range:NSMakeRange(0, length)];
+    if (out->count == 0 || out->runs[out->count - 1].attributes != current) {
+        if (out->count == out->runs_capacity) {
+            out->runs_capacity = out->runs_capacity ? 2 * out->runs_capacity : 32;
+            out->runs = realloc(out->runs, out->runs_capacity * sizeof(struct Run));
+        }
+        out->runs[out->count].start = out->length;
+        out->runs[out->count].attributes = current;
+        out->count++;
+    }
+    out->length += length;
+}
+
+/* flush_runs - append the buffered text to out, setting each run's
+ * attributes once, and release the buffers. */
+static void flush_runs(struct Runs *runs, NSMutableAttributedString *out) {
+    NSUInteger base = out.length;
+    NSUInteger i;
+    if (runs->length > 0) {
+        NSString *text = [[NSString alloc] initWithCharactersNoCopy:runs->chars length:runs->length freeWhenDone:YES];
+        [out replaceCharactersInRange:NSMakeRange(base, 0) withString:text];
+        [text release];
+        for (i = 0; i < runs->count; i++) {
+            NSUInteger end = (i + 1 < runs->count) ? runs->runs[i + 1].start : runs->length;
+            [out setAttributes:runs->runs[i].attributes range:NSMakeRange(base + runs->runs[i].start, end - runs->runs[i].start)];
+        }
+    } else {
+        free(runs->chars);
+    }
+    free(runs->runs);
 }
 
 
@@ -152,43 +515,149 @@ static NSMutableDictionary *merge(NSDictionary *into, NSDictionary *with) {
     return ret;
 }
 
-static void print_attr_element_list(NSMutableAttributedString *out, element *list, NSDictionary *attributes[], NSDictionary *current) {
+/**********************************************************************
+
+  Interned styles
+
+  A MarkdownStyle holds the merged attributes for text nested in one
+  particular chain of elements.  The style for an element inside another
+  is merged once and kept in its parent, so a document allocates one
+  dictionary per distinct nesting rather than one per element.
+
+ ***********************************************************************/
+
+#define BROKENLINK (NOTE + 1)   /* pseudo-key for links whose URL doesn't parse */
+#define STYLE_KEYS (NOTE + 2)
+
+@interface MarkdownStyle : NSObject {
+@public
+    NSDictionary *attributes;               /* merged attributes for text in this style */
+    MarkdownStyle *root;                    /* unretained, holds the attributes for each key */
+    NSDictionary *source;                   /* root only: the attribute set, retained so it keeps its address */
+    NSDictionary *elements[STYLE_KEYS];     /* root only: unmerged attributes for each key */
+    MarkdownStyle *children[STYLE_KEYS];    /* styles nested in this one, made on first use */
+}
+@end
+
+@implementation MarkdownStyle
+
+- (void)dealloc {
+    int key;
+    [attributes release];
+    [source release];
+    for (key = 0; key < STYLE_KEYS; key++) {
+        [elements[key] release];
+        [children[key] release];
+    }
+    [super dealloc];
+}
+
+@end
+
+/* new_style - a style with the given attributes and no children yet. */
+static MarkdownStyle *new_style(MarkdownStyle *root, NSDictionary *attributes) {
+    MarkdownStyle *style = [[MarkdownStyle alloc] init];
+    style->attributes = [attributes copy];
+    style->root = root ? root : style;
+    return style;
+}
+
+/* child_style - the style for an element with 'key' nested in 'parent'.
+ * Styles are shared between threads, so new children are published with
+ * release/acquire ordering and made under the parent's lock. */
+static MarkdownStyle *child_style(MarkdownStyle *parent, int key) {
+    MarkdownStyle *child = __atomic_load_n(&parent->children[key], __ATOMIC_ACQUIRE);
+    if (child == nil) {
+        @synchronized(parent) {
+            child = parent->children[key];
+            if (child == nil) {
+                NSDictionary *with = parent->root->elements[key];
+                child = new_style(parent->root, with ? merge(parent->attributes, with) : parent->attributes);
+                __atomic_store_n(&parent->children[key], child, __ATOMIC_RELEASE);
+            }
+        }
+    }
+    return child;
+}
+
+/* Root styles are kept for at most this many attribute sets. Callers
+ * normally reuse a few dictionaries; one that builds a new dictionary for
+ * every rendering only costs a rebuild of the roots now and then. */
+#define MAX_STYLE_ROOTS 32
+
+static NSMutableDictionary *style_roots = nil;
+
+/* style_root - the shared root style for an attribute set keyed by element
+ * (as NSNumbers), made the first time the set is seen. The root retains
+ * the set, so its address can't be reused by another one while it is in
+ * the table. */
+MarkdownStyle * style_root(NSDictionary *attributes) {
+    NSValue *identity = [NSValue valueWithNonretainedObject:attributes];
+    MarkdownStyle *root;
+    @synchronized([MarkdownStyle class]) {
+        if (!style_roots)
+            style_roots = [[NSMutableDictionary alloc] init];
+        root = [style_roots objectForKey:identity];
+        if (!root) {
+            int key;
+            if ([style_roots count] >= MAX_STYLE_ROOTS)
+                [style_roots removeAllObjects];
+            root = [new_style(nil, @{}) autorelease];
+            root->source = [attributes retain];
+            for (key = 0; key < BROKENLINK; key++)
+                root->elements[key] = [[attributes objectForKey:[NSNumber numberWithInt:key]] retain];
+            root->elements[BROKENLINK] = [@{NSForegroundColorAttributeName: [TARGET_PLATFORM_COLOR redColor]} retain];
+            [style_roots setObject:root forKey:identity];
+        }
+        root = [[root retain] autorelease];
+    }
+    return root;
+}
+
+/* clear_style_roots - forget all root styles; renderings in progress keep theirs. */
+void clear_style_roots(void) {
+    @synchronized([MarkdownStyle class]) {
+        [style_roots removeAllObjects];
+    }
+}
+
+static void print_attr_element_list(struct Output *state, struct Runs *out, element *list, MarkdownStyle *current) {
     while (list != NULL) {
-        print_attr_element(out, list, attributes, current);
+        print_attr_element(state, out, list, current);
         list = list->next;
     }
 }
 
 
-/* add_endnote - add an endnote to global endnotes list. */
-static void add_endnote(element *elt) {
-    if (endnotes == nil)
-        endnotes = [[NSMutableArray alloc] init];
-   [endnotes insertObject:[NSValue valueWithPointer:(const void*)elt] atIndex:0];
+/* add_endnote - add an endnote to the endnotes list. */
+static void add_endnote(struct Output *state, element *elt) {
+    if (state->endnotes == nil)
+        state->endnotes = [[[NSMutableArray alloc] init] autorelease];
+   [state->endnotes addObject:[NSValue valueWithPointer:(const void*)elt]];
 }
 
-static void print_attr_element(NSMutableAttributedString *out, element *elt, NSDictionary *attributes[], NSDictionary *current) {
+static void print_attr_element(struct Output *state, struct Runs *out, element *elt, MarkdownStyle *current) {
 
     switch (elt->key) {
-        case SPACE:         print_attr_string(out, @" ",current);  break;
-        case LINEBREAK:     print_attr_string(out, @"\n",current);  break;
-        case STRING:        print_attr_string(out, elt->contents.str, current);  break;
-        case ELLIPSIS:      print_attr_string(out, @"\u2026",current); break;
-        case EMDASH:        print_attr_string(out, @"\u2014",current); break;
-        case ENDASH:        print_attr_string(out, @"\u2013",current); break;
-        case APOSTROPHE:    print_attr_string(out, @"\u02BC",current); break;
+        case SPACE:         print_attr_string(out, @" ", current->attributes);  break;
+        case LINEBREAK:     print_attr_string(out, @"\n", current->attributes);  break;
+        case STRING:        print_attr_string(out, elt->contents.str, current->attributes);  break;
+        case ELLIPSIS:      print_attr_string(out, @"\u2026", current->attributes); break;
+        case EMDASH:        print_attr_string(out, @"\u2014", current->attributes); break;
+        case ENDASH:        print_attr_string(out, @"\u2013", current->attributes); break;
+        case APOSTROPHE:    print_attr_string(out, @"\u02BC", current->attributes); break;
         case SINGLEQUOTED:
-            print_attr_string(out, @"\u2018",current);
-            print_attr_element_list(out, elt->children, attributes, current);
-            print_attr_string(out, @"\u2019",current);
+            print_attr_string(out, @"\u2018", current->attributes);
+            print_attr_element_list(state, out, elt->children, current);
+            print_attr_string(out, @"\u2019", current->attributes);
             break;
         case DOUBLEQUOTED:
-            print_attr_string(out, @"\u201C",current);
-            print_attr_element_list(out, elt->children, attributes, current);
-            print_attr_string(out, @"\u201D",current);
+            print_attr_string(out, @"\u201C", current->attributes);
+            print_attr_element_list(state, out, elt->children, current);
+            print_attr_string(out, @"\u201D", current->attributes);
             break;
         case CODE:
-            print_attr_string(out, elt->contents.str, merge(current, attributes[elt->key]));
+            print_attr_string(out, elt->contents.str, child_style(current, elt->key)->attributes);
             break;
         case HTML:
             //[out appendFormat:@"%@", elt->contents.str];
@@ -196,77 +665,79 @@ static void print_attr_element(NSMutableAttributedString *out, element *elt, NSD
         case LINK:;
             NSURL *url = [NSURL URLWithString:elt->contents.link->url];
             if (url) {
-                NSDictionary *linkAttibutes = @{@"attributedMarkdownURL": url};
-                print_attr_element_list(out, elt->contents.link->label, attributes, merge(current, merge(attributes[elt->key], linkAttibutes)));
+                /* the URL differs from link to link, so this style is not interned */
+                MarkdownStyle *link = child_style(current, elt->key);
+                NSMutableDictionary *linkAttributes = [[link->attributes mutableCopy] autorelease];
+                [linkAttributes setObject:url forKey:@"attributedMarkdownURL"];
+                print_attr_element_list(state, out, elt->contents.link->label, [new_style(link->root, linkAttributes) autorelease]);
             } else {
-                NSDictionary *attributesBroken = @{NSForegroundColorAttributeName: [TARGET_PLATFORM_COLOR redColor]}; // Make this attributes[BROKEN]
-                print_attr_element_list(out, elt->contents.link->label, attributes, merge(current, attributesBroken));
-                print_attr_string(out, [NSString stringWithFormat: @" (%@)", elt->contents.link->url], current);
+                print_attr_element_list(state, out, elt->contents.link->label, child_style(current, BROKENLINK));
+                print_attr_string(out, [NSString stringWithFormat: @" (%@)", elt->contents.link->url], current->attributes);
             }
             break;
         case IMAGE:
             // NOT CURRENTLY SUPPORTED
             break;
         case EMPH: case STRONG:
-            print_attr_element_list(out, elt->children, attributes, merge(current, attributes[elt->key]));
+            print_attr_element_list(state, out, elt->children, child_style(current, elt->key));
             break;
         case LIST:
-            print_attr_element_list(out, elt->children, attributes, merge(current, attributes[elt->key]));
+            print_attr_element_list(state, out, elt->children, child_style(current, elt->key));
             break;
         case RAW:
             /* Shouldn't occur - these are handled by process_raw_blocks() */
             assert(elt->key != RAW);
             break;
         case H1: case H2: case H3: case H4: case H5: case H6:
-            print_attr_element_list(out, elt->children, attributes, merge(current, attributes[elt->key]));
-            //print_attr_string(out, @"\n",current);
-            print_attr_string(out, @"\n",current);
+            print_attr_element_list(state, out, elt->children, child_style(current, elt->key));
+            //print_attr_string(out, @"\n", current->attributes);
+            print_attr_string(out, @"\n", current->attributes);
             break;
         case PLAIN:
-            print_attr_element_list(out, elt->children, attributes, merge(current, attributes[elt->key]));
+            print_attr_element_list(state, out, elt->children, child_style(current, elt->key));
             break;
         case PARA:
-            //NSLog(@"%@",merge(current, attributes[elt->key]));
-            print_attr_element_list(out, elt->children, attributes, merge(current, attributes[elt->key]));
-            //print_attr_string(out, @"\n",current);
-            print_attr_string(out, @"\n",current);
+            //NSLog(@"%@",child_style(current, elt->key)->attributes);
+            print_attr_element_list(state, out, elt->children, child_style(current, elt->key));
+            //print_attr_string(out, @"\n", current->attributes);
+            print_attr_string(out, @"\n", current->attributes);
             break;
-        case HRULE:         print_attr_string(out, @"\n-----------------------------------------------------\n", merge(current, attributes[elt->key])); break;
-        case HTMLBLOCK:     print_attr_string(out, elt->contents.str, merge(current, attributes[elt->key])); break;
-        case VERBATIM:      print_attr_string(out, elt->contents.str, merge(current, attributes[elt->key])); break;
+        case HRULE:         print_attr_string(out, @"\n-----------------------------------------------------\n", child_style(current, elt->key)->attributes); break;
+        case HTMLBLOCK:     print_attr_string(out, elt->contents.str, child_style(current, elt->key)->attributes); break;
+        case VERBATIM:      print_attr_string(out, elt->contents.str, child_style(current, elt->key)->attributes); break;
         case BULLETLIST:
             //pad(out, 2);
-            padded = 0;
-            print_attr_string(out, @"\n",current);
-            indentation+=1;
-            print_attr_element_list(out, elt->children, attributes, merge(current, attributes[elt->key]));
+            state->padded = 0;
+            print_attr_string(out, @"\n", current->attributes);
+            state->indentation+=1;
+            print_attr_element_list(state, out, elt->children, child_style(current, elt->key));
             //pad(out, 1);
-            indentation-=1;
-            print_attr_string(out, @"\n",current);
-            padded = 0;
+            state->indentation-=1;
+            print_attr_string(out, @"\n", current->attributes);
+            state->padded = 0;
             break;
         case ORDEREDLIST:
             //pad(out, 2);
-            padded = 0;
-            print_attr_element_list(out, elt->children, attributes, merge(current, attributes[elt->key]));
+            state->padded = 0;
+            print_attr_element_list(state, out, elt->children, child_style(current, elt->key));
             //pad(out, 1);
-            padded = 0;
+            state->padded = 0;
             break;
         case LISTITEM:
             //pad(out, 1);
-            print_attr_string(out, @"\u2022  ",current);
-            padded = 2;
-            print_attr_element_list(out, elt->children, attributes, merge(current, attributes[elt->key]));
-            print_attr_string(out, @"\n",current);
-            padded = 0;
+            print_attr_string(out, @"\u2022  ", current->attributes);
+            state->padded = 2;
+            print_attr_element_list(state, out, elt->children, child_style(current, elt->key));
+            print_attr_string(out, @"\n", current->attributes);
+            state->padded = 0;
             break;
         case BLOCKQUOTE:
             //pad(out, 2);
-            padded = 2;
+            state->padded = 2;
             //NSLog(@"block");
-            print_attr_element_list(out, elt->children, attributes, merge(current, attributes[elt->key]));
+            print_attr_element_list(state, out, elt->children, child_style(current, elt->key));
             //pad(out, 1);
-            padded = 0;
+            state->padded = 0;
             break;
         case REFERENCE:
             /* Nonprinting */
@@ -275,8 +746,8 @@ static void print_attr_element(NSMutableAttributedString *out, element *elt, NSD
             /* if contents.str == 0, then print note; else ignore, since this
              * is a note block that has been incorporated into the notes list */
             /*if (elt->contents.str == 0) {
-                add_endnote(elt);
-                ++notenumber;
+                add_endnote(state, elt);
+                ++state->notenumber;
                 [out appendFormat:@"<a class=\"noteref\" id=\"fnref%d\" href=\"#fn%d\" title=\"Jump to note %d\">[%d]</a>",
                  notenumber, notenumber, notenumber, notenumber];
             }*/
@@ -293,15 +764,39 @@ static void print_attr_element(NSMutableAttributedString *out, element *elt, NSD
 
  ***********************************************************************/
 
-void print_element_list_attr(NSMutableAttributedString *out, element *elt, int exts,NSDictionary *attributes[], NSDictionary *current) {
-    /* Initialize globals */
-    endnotes = nil;
-    notenumber = 0;
-    
-    extensions = exts;
-    padded = 2;  /* set padding to 2, so no extra blank lines at beginning */
-    print_attr_element_list(out, elt, attributes, current);
-    if (endnotes != nil) {
+void print_element_list(Buffer *out, element *elt, int format, int exts) {
+    struct Output state;
+    state.endnotes = nil;
+    state.notenumber = 0;
+    state.extensions = exts;
+    state.indentation = 0;
+    state.padded = 2;  /* set padding to 2, so no extra blank lines at beginning */
+    switch (format) {
+    case HTML_FORMAT:
+        print_html_element_list(&state, out, elt, false);
+        if (state.endnotes != nil) {
+            pad(&state, out, 2);
+            print_html_endnotes(&state, out);
+        }
+        break;
+    default:
+        /* LaTeX and groff output are not implemented */
+        fprintf(stderr, "print_element_list - unsupported format = %d\n", format);
+        break;
+    }
+}
+
+void print_element_list_attr(NSMutableAttributedString *out, element *elt, int exts, MarkdownStyle *root) {
+    struct Output state;
+    state.endnotes = nil;
+    state.notenumber = 0;
+    state.extensions = exts;
+    state.indentation = 0;
+    state.padded = 2;  /* set padding to 2, so no extra blank lines at beginning */
+    struct Runs runs = { NULL, 0, 0, NULL, 0, 0 };
+    print_attr_element_list(&state, &runs, elt, root);
+    flush_runs(&runs, out);
+    if (state.endnotes != nil) {
        // pad(out, 2);
        // print_attr_endnotes(out);
     }
@@ -3,6 +3,11 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#if defined(__SSSE3__)
+#include <tmmintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#endif
 struct _GREG;
 #define YYRULECOUNT 242
 
@@ -99,6 +104,10 @@ struct _GREG;
 #define YY_BUFFER_START_SIZE 1024
 #endif
 
+#ifndef YY_MEMO_START_SIZE
+#define YY_MEMO_START_SIZE 1024
+#endif
+
 #ifndef YY_PART
 #define yydata G->data
 #define yy G->ss
@@ -107,6 +116,11 @@ struct _yythunk; // forward declaration
 typedef void (*yyaction)(struct _GREG *G, char *yytext, int yyleng, struct _yythunk *thunkpos, YY_XTYPE YY_XVAR);
 typedef struct _yythunk { int begin, end;  yyaction  action;  struct _yythunk *next; } yythunk;
 
+#ifdef YY_MEMO
+/* result of a memoized rule at a position: where it ended, and the thunks it left */
+typedef struct _yymemo { int rule, pos, ok, end, begin, textend, thunks, thunkcount; } yymemo;
+#endif
+
 typedef struct _GREG {
   char *buf;
   int buflen;
@@ -125,6 +139,14 @@ typedef struct _GREG {
   YYSTYPE *vals;
   int valslen;
   YY_XTYPE data;
+#ifdef YY_MEMO
+  yymemo *memos;
+  int memoslen;
+  int memocount;
+  yythunk *memothunks;
+  int memothunkslen;
+  int memothunkpos;
+#endif
 } GREG;
 
 YY_LOCAL(int) yyrefill(GREG *G)
@@ -193,6 +215,57 @@ YY_LOCAL(int) yymatchClass(GREG *G, unsigned char *bits)
   return 0;
 }
 
+YY_LOCAL(int) yyscanClass(const unsigned char *bits, const unsigned char *p, int n)
+{
+  int i= 0;
+#if defined(__SSSE3__)
+  const __m128i lo=   _mm_loadu_si128((const __m128i *)(bits + 32));
+  const __m128i hi=   _mm_loadu_si128((const __m128i *)(bits + 48));
+  const __m128i rows= _mm_setr_epi8(1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8, 16, 32, 64, -128);
+  const __m128i nib=  _mm_set1_epi8(15);
+  const __m128i seven= _mm_set1_epi8(7);
+  for (;  i + 16 <= n;  i += 16)
+    {
+      __m128i c=    _mm_loadu_si128((const __m128i *)(p + i));
+      __m128i l=    _mm_and_si128(c, nib);
+      __m128i h=    _mm_and_si128(_mm_srli_epi16(c, 4), nib);
+      __m128i high= _mm_cmpgt_epi8(h, seven);
+      __m128i t=    _mm_or_si128(_mm_andnot_si128(high, _mm_shuffle_epi8(lo, l)), _mm_and_si128(high, _mm_shuffle_epi8(hi, l)));
+      __m128i hit=  _mm_and_si128(t, _mm_shuffle_epi8(rows, h));
+      if (_mm_movemask_epi8(_mm_cmpeq_epi8(hit, _mm_setzero_si128()))) break;
+    }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+  static const unsigned char yyrows[16]= { 1, 2, 4, 8, 16, 32, 64, 128, 1, 2, 4, 8, 16, 32, 64, 128 };
+  const uint8x16_t lo=   vld1q_u8(bits + 32);
+  const uint8x16_t hi=   vld1q_u8(bits + 48);
+  const uint8x16_t rows= vld1q_u8(yyrows);
+  for (;  i + 16 <= n;  i += 16)
+    {
+      uint8x16_t c=   vld1q_u8(p + i);
+      uint8x16_t l=   vandq_u8(c, vdupq_n_u8(15));
+      uint8x16_t h=   vshrq_n_u8(c, 4);
+      uint8x16_t t=   vbslq_u8(vcgtq_u8(h, vdupq_n_u8(7)), vqtbl1q_u8(hi, l), vqtbl1q_u8(lo, l));
+      uint8x16_t hit= vtstq_u8(t, vqtbl1q_u8(rows, h));
+      if (0 == vminvq_u8(hit)) break;
+    }
+#endif
+  while (i < n && (bits[p[i] >> 3] & (1 << (p[i] & 7))))
+    ++i;
+  return i;
+}
+
+YY_LOCAL(int) yymatchClassRun(GREG *G, unsigned char *bits)
+{
+  int yysav= G->pos;
+  while (G->pos < G->limit || yyrefill(G))
+    {
+      G->pos += yyscanClass(bits, (unsigned char *)G->buf + G->pos, G->limit - G->pos);
+      if (G->pos < G->limit) break;
+    }
+  yyprintf((stderr, "  %s yymatchClassRun(%d) @ %s\n", G->pos > yysav ? "ok  " : "fail", G->pos - yysav, G->buf+G->pos));
+  return G->pos - yysav;
+}
+
 YY_LOCAL(void) yyDo(GREG *G, yyaction action, int begin, int end)
 {
   while (G->thunkpos >= G->thunkslen)
@@ -237,8 +310,88 @@ YY_LOCAL(void) yyDone(GREG *G)
   G->thunkpos= 0;
 }
 
+#ifdef YY_MEMO
+YY_LOCAL(yymemo *) yyMemoSlot(yymemo *memos, int memoslen, int rule, int pos)
+{
+  unsigned int mask= memoslen - 1;
+  unsigned int i= ((unsigned int)pos * 2654435761u + (unsigned int)rule) & mask;
+  while (memos[i].rule && (memos[i].rule != rule || memos[i].pos != pos))
+    i= (i + 1) & mask;
+  return &memos[i];
+}
+
+YY_LOCAL(int) yyMemoFetch(GREG *G, int rule)
+{
+  yymemo *memo;
+  int i;
+  if (!G->memocount) return -1;
+  memo= yyMemoSlot(G->memos, G->memoslen, rule, G->pos);
+  if (!memo->rule) return -1;
+  for (i= 0; i < memo->thunkcount; ++i)
+    {
+      yythunk *thunk= &G->memothunks[memo->thunks + i];
+      yyDo(G, thunk->action, thunk->begin, thunk->end);
+    }
+  G->pos= memo->end;
+  G->begin= memo->begin;
+  G->end= memo->textend;
+  yyprintf((stderr, "  memo %d @ %d -> %d\n", rule, memo->pos, memo->ok));
+  return memo->ok;
+}
+
+YY_LOCAL(void) yyMemoStore(GREG *G, int rule, int pos, int thunkpos, int ok)
+{
+  yymemo *memo;
+  int count= G->thunkpos - thunkpos;
+  if (2 * (G->memocount + 1) > G->memoslen)
+    {
+      int i, memoslen= G->memoslen ? 2 * G->memoslen : YY_MEMO_START_SIZE;
+      yymemo *memos= (yymemo*)YY_CALLOC(memoslen, sizeof(yymemo), G->data);
+      for (i= 0; i < G->memoslen; ++i)
+        if (G->memos[i].rule)
+          *yyMemoSlot(memos, memoslen, G->memos[i].rule, G->memos[i].pos)= G->memos[i];
+      if (G->memos) YY_FREE(G->memos);
+      G->memos= memos;
+      G->memoslen= memoslen;
+    }
+  memo= yyMemoSlot(G->memos, G->memoslen, rule, pos);
+  if (memo->rule) return;
+  if (!G->memothunkslen)
+    {
+      G->memothunkslen= YY_STACK_SIZE;
+      G->memothunks= (yythunk*)YY_ALLOC(sizeof(yythunk) * G->memothunkslen, G->data);
+    }
+  while (G->memothunkpos + count > G->memothunkslen)
+    {
+      G->memothunkslen *= 2;
+      G->memothunks= (yythunk*)YY_REALLOC(G->memothunks, sizeof(yythunk) * G->memothunkslen, G->data);
+    }
+  memcpy(G->memothunks + G->memothunkpos, G->thunks + thunkpos, sizeof(yythunk) * count);
+  memo->rule= rule;
+  memo->pos= pos;
+  memo->ok= ok;
+  memo->end= G->pos;
+  memo->begin= G->begin;
+  memo->textend= G->end;
+  memo->thunks= G->memothunkpos;
+  memo->thunkcount= count;
+  G->memothunkpos += count;
+  ++G->memocount;
+}
+
+YY_LOCAL(void) yyMemoClear(GREG *G)
+{
+  if (G->memocount) memset(G->memos, 0, sizeof(yymemo) * G->memoslen);
+  G->memocount= 0;
+  G->memothunkpos= 0;
+}
+#endif
+
 YY_LOCAL(void) yyCommit(GREG *G)
 {
+#ifdef YY_MEMO
+  yyMemoClear(G);
+#endif
   if ((G->limit -= G->pos))
     {
       memmove(G->buf, G->buf + G->pos, G->limit);
@@ -519,7 +672,7 @@ YY_ACTION(void) yy_3_RawNoteBlock(GREG *G, char *yytext, int yyleng, yythunk *th
 {
 #define a G->val[-1]
   yyprintf((stderr, "do yy_3_RawNoteBlock\n"));
-     yy = mk_str_from_list(a, true);
+     yy = mk_str_from_list(yydata, a, true);
                     yy->key = RAW;
                 ;
 #undef a
@@ -528,7 +681,7 @@ YY_ACTION(void) yy_2_RawNoteBlock(GREG *G, char *yytext, int yyleng, yythunk *th
 {
 #define a G->val[-1]
   yyprintf((stderr, "do yy_2_RawNoteBlock\n"));
-   a = cons(mk_str(yytext), a); ;
+   a = cons(mk_str(yydata, yytext), a); ;
 #undef a
 }
 YY_ACTION(void) yy_1_RawNoteBlock(GREG *G, char *yytext, int yyleng, yythunk *thunk, YY_XTYPE YY_XVAR)
@@ -543,7 +696,7 @@ YY_ACTION(void) yy_2_Notes(GREG *G, char *yytext, int yyleng, yythunk *thunk, YY
 #define b G->val[-1]
 #define a G->val[-2]
   yyprintf((stderr, "do yy_2_Notes\n"));
-   md.notes = reverse(a); ;
+   yydata->notes = reverse(a); ;
 #undef b
 #undef a
 }
@@ -560,7 +713,7 @@ YY_ACTION(void) yy_2_InlineNote(GREG *G, char *yytext, int yyleng, yythunk *thun
 {
 #define a G->val[-1]
   yyprintf((stderr, "do yy_2_InlineNote\n"));
-   yy = mk_list(NOTE, a); ;
+   yy = mk_list(yydata, NOTE, a); ;
 #undef a
 }
 YY_ACTION(void) yy_1_InlineNote(GREG *G, char *yytext, int yyleng, yythunk *thunk, YY_XTYPE YY_XVAR)
@@ -575,8 +728,8 @@ YY_ACTION(void) yy_3_Note(GREG *G, char *yytext, int yyleng, yythunk *thunk, YY_
 #define a G->val[-1]
 #define ref G->val[-2]
   yyprintf((stderr, "do yy_3_Note\n"));
-     yy = mk_list(NOTE, a);
-                    yy->contents.str = [ref->contents.str mutableCopy];
+     yy = mk_list(yydata, NOTE, a);
+                    yy->contents.str = arena_own(yydata->arena, [ref->contents.str mutableCopy]);
                 ;
 #undef a
 #undef ref
@@ -602,21 +755,15 @@ YY_ACTION(void) yy_1_Note(GREG *G, char *yytext, int yyleng, yythunk *thunk, YY_
 YY_ACTION(void) yy_1_RawNoteReference(GREG *G, char *yytext, int yyleng, yythunk *thunk, YY_XTYPE YY_XVAR)
 {
   yyprintf((stderr, "do yy_1_RawNoteReference\n"));
-   yy = mk_str(yytext); ;
+   yy = mk_str(yydata, yytext); ;
 }
 YY_ACTION(void) yy_1_NoteReference(GREG *G, char *yytext, int yyleng, yythunk *thunk, YY_XTYPE YY_XVAR)
 {
 #define ref G->val[-1]
   yyprintf((stderr, "do yy_1_NoteReference\n"));
-     element *match;
-                    if (find_note(&match, ref->contents.str)) {
-                        yy = mk_element(NOTE);
-                        assert(match->children != NULL);
-                        yy->children = match->children;
-                    } else {
-                        NSString *s = [NSString stringWithFormat:@"[^%@]", [ref->contents.str substringFromIndex:4]];
-                        yy = mk_str(s.defaultCString);
-                    }
+     NSString *s = [NSString stringWithFormat:@"[^%@]", [ref->contents.str substringFromIndex:4]];
+                    yy = mk_str(yydata, s.UTF8String);
+                    defer(yydata, NOTE, yy, NULL, ref);
                 ;
 #undef ref
 }
@@ -625,7 +772,7 @@ YY_ACTION(void) yy_2_DoubleQuoted(GREG *G, char *yytext, int yyleng, yythunk *th
 #define b G->val[-1]
 #define a G->val[-2]
   yyprintf((stderr, "do yy_2_DoubleQuoted\n"));
-   yy = mk_list(DOUBLEQUOTED, a); ;
+   yy = mk_list(yydata, DOUBLEQUOTED, a); ;
 #undef b
 #undef a
 }
@@ -643,7 +790,7 @@ YY_ACTION(void) yy_2_SingleQuoted(GREG *G, char *yytext, int yyleng, yythunk *th
 #define b G->val[-1]
 #define a G->val[-2]
   yyprintf((stderr, "do yy_2_SingleQuoted\n"));
-   yy = mk_list(SINGLEQUOTED, a); ;
+   yy = mk_list(yydata, SINGLEQUOTED, a); ;
 #undef b
 #undef a
 }
@@ -659,27 +806,27 @@ YY_ACTION(void) yy_1_SingleQuoted(GREG *G, char *yytext, int yyleng, yythunk *th
 YY_ACTION(void) yy_1_EmDash(GREG *G, char *yytext, int yyleng, yythunk *thunk, YY_XTYPE YY_XVAR)
 {
   yyprintf((stderr, "do yy_1_EmDash\n"));
-   yy = mk_element(EMDASH); ;
+   yy = mk_element(yydata, EMDASH); ;
 }
 YY_ACTION(void) yy_1_EnDash(GREG *G, char *yytext, int yyleng, yythunk *thunk, YY_XTYPE YY_XVAR)
 {
   yyprintf((stderr, "do yy_1_EnDash\n"));
-   yy = mk_element(ENDASH); ;
+   yy = mk_element(yydata, ENDASH); ;
 }
 YY_ACTION(void) yy_1_Ellipsis(GREG *G, char *yytext, int yyleng, yythunk *thunk, YY_XTYPE YY_XVAR)
 {
   yyprintf((stderr, "do yy_1_Ellipsis\n"));
-   yy = mk_element(ELLIPSIS); ;
+   yy = mk_element(yydata, ELLIPSIS); ;
 }
 YY_ACTION(void) yy_1_Apostrophe(GREG *G, char *yytext, int yyleng, yythunk *thunk, YY_XTYPE YY_XVAR)
 {
   yyprintf((stderr, "do yy_1_Apostrophe\n"));
-   yy = mk_element(APOSTROPHE); ;
+   yy = mk_element(yydata, APOSTROPHE); ;
 }
 YY_ACTION(void) yy_1_Line(GREG *G, char *yytext, int yyleng, yythunk *thunk, YY_XTYPE YY_XVAR)
 {
   yyprintf((stderr, "do yy_1_Line\n"));
-   yy = mk_str(yytext); ;
+   yy = mk_str(yydata, yytext); ;
 }
 YY_ACTION(void) yy_1_StartList(GREG *G, char *yytext, int yyleng, yythunk *thunk, YY_XTYPE YY_XVAR)
 {
@@ -689,10 +836,10 @@ YY_ACTION(void) yy_1_StartList(GREG *G, char *yytext, int yyleng, yythunk *thunk
 YY_ACTION(void) yy_1_RawHtml(GREG *G, char *yytext, int yyleng, yythunk *thunk, YY_XTYPE YY_XVAR)
 {
   yyprintf((stderr, "do yy_1_RawHtml\n"));
-     if (extension(EXT_FILTER_HTML)) {
-                    yy = mk_list(LIST, NULL);
+     if (extension(yydata, EXT_FILTER_HTML)) {
+                    yy = mk_list(yydata, LIST, NULL);
                 } else {
-                    yy = mk_str(yytext);
+                    yy = mk_str(yydata, yytext);
                     yy->key = HTML;
                 }
             ;
@@ -700,14 +847,14 @@ YY_ACTION(void) yy_1_RawHtml(GREG *G, char *yytext, int yyleng, yythunk *thunk,
 YY_ACTION(void) yy_1_Code(GREG *G, char *yytext, int yyleng, yythunk *thunk, YY_XTYPE YY_XVAR)
 {
   yyprintf((stderr, "do yy_1_Code\n"));
-   yy = mk_str(yytext); yy->key = CODE; ;
+   yy = mk_str(yydata, yytext); yy->key = CODE; ;
 }
 YY_ACTION(void) yy_2_References(GREG *G, char *yytext, int yyleng, yythunk *thunk, YY_XTYPE YY_XVAR)
 {
 #define b G->val[-1]
 #define a G->val[-2]
   yyprintf((stderr, "do yy_2_References\n"));
-   md.references = reverse(a); ;
+   yydata->references = reverse(a); ;
 #undef b
 #undef a
 }
@@ -723,19 +870,19 @@ YY_ACTION(void) yy_1_References(GREG *G, char *yytext, int yyleng, yythunk *thun
 YY_ACTION(void) yy_1_RefTitle(GREG *G, char *yytext, int yyleng, yythunk *thunk, YY_XTYPE YY_XVAR)
 {
   yyprintf((stderr, "do yy_1_RefTitle\n"));
-   yy = mk_str(yytext); ;
+   yy = mk_str(yydata, yytext); ;
 }
 YY_ACTION(void) yy_1_RefSrc(GREG *G, char *yytext, int yyleng, yythunk *thunk, YY_XTYPE YY_XVAR)
 {
   yyprintf((stderr, "do yy_1_RefSrc\n"));
-   yy = mk_str(yytext); 
+   yy = mk_str(yydata, yytext); 
            yy->key = HTML; ;
 }
 YY_ACTION(void) yy_2_Label(GREG *G, char *yytext, int yyleng, yythunk *thunk, YY_XTYPE YY_XVAR)
 {
 #define a G->val[-1]
   yyprintf((stderr, "do yy_2_Label\n"));
-   yy = mk_list(LIST, a); ;
+   yy = mk_list(yydata, LIST, a); ;
 #undef a
 }
 YY_ACTION(void) yy_1_Label(GREG *G, char *yytext, int yyleng, yythunk *thunk, YY_XTYPE YY_XVAR)
@@ -751,10 +898,7 @@ YY_ACTION(void) yy_1_Reference(GREG *G, char *yytext, int yyleng, yythunk *thunk
 #define s G->val[-2]
 #define l G->val[-3]
   yyprintf((stderr, "do yy_1_Reference\n"));
-   yy = mk_link(l->children, s->contents.str, t->contents.str);
-              free_element(s);
-              free_element(t);
-              free(l);
+   yy = mk_link(yydata, l->children, s->contents.str, t->contents.str);
               yy->key = REFERENCE; ;
 #undef t
 #undef s
@@ -764,25 +908,24 @@ YY_ACTION(void) yy_1_AutoLinkEmail(GREG *G, char *yytext, int yyleng, yythunk *t
 {
   yyprintf((stderr, "do yy_1_AutoLinkEmail\n"));
      NSString *mailto = [NSString stringWithFormat:@"mailto:%s", yytext];
-                    yy = mk_link(mk_str(yytext), mailto, @"");
-                    free(mailto);
+                    yy = mk_link(yydata, mk_str(yydata, yytext), mailto, @"");
                 ;
 }
 YY_ACTION(void) yy_1_AutoLinkUrl(GREG *G, char *yytext, int yyleng, yythunk *thunk, YY_XTYPE YY_XVAR)
 {
   yyprintf((stderr, "do yy_1_AutoLinkUrl\n"));
      NSString *url = [NSString stringWithFormat:@"%s", yytext];
-                    yy = mk_link(mk_str(yytext), url, @""); ;
+                    yy = mk_link(yydata, mk_str(yydata, yytext), url, @""); ;
 }
 YY_ACTION(void) yy_1_Title(GREG *G, char *yytext, int yyleng, yythunk *thunk, YY_XTYPE YY_XVAR)
 {
   yyprintf((stderr, "do yy_1_Title\n"));
-   yy = mk_str(yytext); ;
+   yy = mk_str(yydata, yytext); ;
 }
 YY_ACTION(void) yy_1_Source(GREG *G, char *yytext, int yyleng, yythunk *thunk, YY_XTYPE YY_XVAR)
 {
   yyprintf((stderr, "do yy_1_Source\n"));
-   yy = mk_str(yytext); ;
+   yy = mk_str(yydata, yytext); ;
 }
 YY_ACTION(void) yy_1_ExplicitLink(GREG *G, char *yytext, int yyleng, yythunk *thunk, YY_XTYPE YY_XVAR)
 {
@@ -790,10 +933,7 @@ YY_ACTION(void) yy_1_ExplicitLink(GREG *G, char *yytext, int yyleng, yythunk *th
 #define s G->val[-2]
 #define l G->val[-3]
   yyprintf((stderr, "do yy_1_ExplicitLink\n"));
-   yy = mk_link(l->children, s->contents.str, t->contents.str);
-                  free_element(s);
-                  free_element(t);
-                  free(l); ;
+   yy = mk_link(yydata, l->children, s->contents.str, t->contents.str); ;
 #undef t
 #undef s
 #undef l
@@ -802,17 +942,11 @@ YY_ACTION(void) yy_1_ReferenceLinkSingle(GREG *G, char *yytext, int yyleng, yyth
 {
 #define a G->val[-1]
   yyprintf((stderr, "do yy_1_ReferenceLinkSingle\n"));
-     Link match;
-                           if (find_reference(&match, a->children)) {
-                               yy = mk_link(a->children, match.url, match.title);
-                               free(a);
-                           }
-                           else {
-                               element *result;
-                               result = mk_element(LIST);
-                               result->children = cons(mk_str("["), cons(a, cons(mk_str("]"), mk_str(yytext))));
-                               yy = result;
-                           }
+     element *result;
+                           result = mk_element(yydata, LIST);
+                           result->children = cons(mk_str(yydata, "["), cons(a, cons(mk_str(yydata, "]"), mk_str(yydata, yytext))));
+                           defer(yydata, LINK, result, a->children, a->children);
+                           yy = result;
                        ;
 #undef a
 }
@@ -821,18 +955,12 @@ YY_ACTION(void) yy_1_ReferenceLinkDouble(GREG *G, char *yytext, int yyleng, yyth
 #define b G->val[-1]
 #define a G->val[-2]
   yyprintf((stderr, "do yy_1_ReferenceLinkDouble\n"));
-     Link match;
-                           if (find_reference(&match, b->children)) {
-                               yy = mk_link(a->children, match.url, match.title);
-                               free(a);
-                               free_element_list(b);
-                           } else {
-                               element *result;
-                               result = mk_element(LIST);
-                               result->children = cons(mk_str("["), cons(a, cons(mk_str("]"), cons(mk_str(yytext),
-                                                   cons(mk_str("["), cons(b, mk_str("]")))))));
-                               yy = result;
-                           }
+     element *result;
+                           result = mk_element(yydata, LIST);
+                           result->children = cons(mk_str(yydata, "["), cons(a, cons(mk_str(yydata, "]"), cons(mk_str(yydata, yytext),
+                                               cons(mk_str(yydata, "["), cons(b, mk_str(yydata, "]")))))));
+                           defer(yydata, LINK, result, a->children, b->children);
+                           yy = result;
                        ;
 #undef b
 #undef a
@@ -845,14 +973,14 @@ YY_ACTION(void) yy_1_Image(GREG *G, char *yytext, int yyleng, yythunk *thunk, YY
           } else {
               element *result;
               result = yy;
-              yy->children = cons(mk_str("!"), result->children);
+              yy->children = cons(mk_str(yydata, "!"), result->children);
           } ;
 }
 YY_ACTION(void) yy_3_StrongUl(GREG *G, char *yytext, int yyleng, yythunk *thunk, YY_XTYPE YY_XVAR)
 {
 #define a G->val[-1]
   yyprintf((stderr, "do yy_3_StrongUl\n"));
-   yy = mk_list(STRONG, a); ;
+   yy = mk_list(yydata, STRONG, a); ;
 #undef a
 }
 YY_ACTION(void) yy_2_StrongUl(GREG *G, char *yytext, int yyleng, yythunk *thunk, YY_XTYPE YY_XVAR)
@@ -880,7 +1008,7 @@ YY_ACTION(void) yy_3_StrongStar(GREG *G, char *yytext, int yyleng, yythunk *thun
 {
 #define a G->val[-1]
   yyprintf((stderr, "do yy_3_StrongStar\n"));
-   yy = mk_list(STRONG, a); ;
+   yy = mk_list(yydata, STRONG, a); ;
 #undef a
 }
 YY_ACTION(void) yy_2_StrongStar(GREG *G, char *yytext, int yyleng, yythunk *thunk, YY_XTYPE YY_XVAR)
@@ -908,7 +1036,7 @@ YY_ACTION(void) yy_3_EmphUl(GREG *G, char *yytext, int yyleng, yythunk *thunk, Y
 {
 #define a G->val[-1]
   yyprintf((stderr, "do yy_3_EmphUl\n"));
-   yy = mk_list(EMPH, a); ;
+   yy = mk_list(yydata, EMPH, a); ;
 #undef a
 }
 YY_ACTION(void) yy_2_EmphUl(GREG *G, char *yytext, int yyleng, yythunk *thunk, YY_XTYPE YY_XVAR)
@@ -936,7 +1064,7 @@ YY_ACTION(void) yy_3_EmphStar(GREG *G, char *yytext, int yyleng, yythunk *thunk,
 {
 #define a G->val[-1]
   yyprintf((stderr, "do yy_3_EmphStar\n"));
-   yy = mk_list(EMPH, a); ;
+   yy = mk_list(yydata, EMPH, a); ;
 #undef a
 }
 YY_ACTION(void) yy_2_EmphStar(GREG *G, char *yytext, int yyleng, yythunk *thunk, YY_XTYPE YY_XVAR)
@@ -963,17 +1091,17 @@ YY_ACTION(void) yy_1_OneStarClose(GREG *G, char *yytext, int yyleng, yythunk *th
 YY_ACTION(void) yy_1_UlOrStarLine(GREG *G, char *yytext, int yyleng, yythunk *thunk, YY_XTYPE YY_XVAR)
 {
   yyprintf((stderr, "do yy_1_UlOrStarLine\n"));
-   yy = mk_str(yytext); ;
+   yy = mk_str(yydata, yytext); ;
 }
 YY_ACTION(void) yy_1_Symbol(GREG *G, char *yytext, int yyleng, yythunk *thunk, YY_XTYPE YY_XVAR)
 {
   yyprintf((stderr, "do yy_1_Symbol\n"));
-   yy = mk_str(yytext); ;
+   yy = mk_str(yydata, yytext); ;
 }
 YY_ACTION(void) yy_1_LineBreak(GREG *G, char *yytext, int yyleng, yythunk *thunk, YY_XTYPE YY_XVAR)
 {
   yyprintf((stderr, "do yy_1_LineBreak\n"));
-   yy = mk_element(LINEBREAK); ;
+   yy = mk_element(yydata, LINEBREAK); ;
 }
 YY_ACTION(void) yy_1_TerminalEndline(GREG *G, char *yytext, int yyleng, yythunk *thunk, YY_XTYPE YY_XVAR)
 {
@@ -983,28 +1111,28 @@ YY_ACTION(void) yy_1_TerminalEndline(GREG *G, char *yytext, int yyleng, yythunk
 YY_ACTION(void) yy_1_NormalEndline(GREG *G, char *yytext, int yyleng, yythunk *thunk, YY_XTYPE YY_XVAR)
 {
   yyprintf((stderr, "do yy_1_NormalEndline\n"));
-   yy = mk_str("\n");
+   yy = mk_str(yydata, "\n");
                     yy->key = SPACE; ;
 }
 YY_ACTION(void) yy_1_Entity(GREG *G, char *yytext, int yyleng, yythunk *thunk, YY_XTYPE YY_XVAR)
 {
   yyprintf((stderr, "do yy_1_Entity\n"));
-   yy = mk_str(yytext); yy->key = HTML; ;
+   yy = mk_str(yydata, yytext); yy->key = HTML; ;
 }
 YY_ACTION(void) yy_1_EscapedChar(GREG *G, char *yytext, int yyleng, yythunk *thunk, YY_XTYPE YY_XVAR)
 {
   yyprintf((stderr, "do yy_1_EscapedChar\n"));
-   yy = mk_str(yytext); ;
+   yy = mk_str(yydata, yytext); ;
 }
 YY_ACTION(void) yy_1_Str(GREG *G, char *yytext, int yyleng, yythunk *thunk, YY_XTYPE YY_XVAR)
 {
   yyprintf((stderr, "do yy_1_Str\n"));
-   yy = mk_str(yytext); ;
+   yy = mk_str(yydata, yytext); ;
 }
 YY_ACTION(void) yy_1_Space(GREG *G, char *yytext, int yyleng, yythunk *thunk, YY_XTYPE YY_XVAR)
 {
   yyprintf((stderr, "do yy_1_Space\n"));
-   yy = mk_str(" ");
+   yy = mk_str(yydata, " ");
           yy->key = SPACE; ;
 }
 YY_ACTION(void) yy_3_Inlines(GREG *G, char *yytext, int yyleng, yythunk *thunk, YY_XTYPE YY_XVAR)
@@ -1012,7 +1140,7 @@ YY_ACTION(void) yy_3_Inlines(GREG *G, char *yytext, int yyleng, yythunk *thunk,
 #define c G->val[-1]
 #define a G->val[-2]
   yyprintf((stderr, "do yy_3_Inlines\n"));
-   yy = mk_list(LIST, a); ;
+   yy = mk_list(yydata, LIST, a); ;
 #undef c
 #undef a
 }
@@ -1037,10 +1165,10 @@ YY_ACTION(void) yy_1_Inlines(GREG *G, char *yytext, int yyleng, yythunk *thunk,
 YY_ACTION(void) yy_1_StyleBlock(GREG *G, char *yytext, int yyleng, yythunk *thunk, YY_XTYPE YY_XVAR)
 {
   yyprintf((stderr, "do yy_1_StyleBlock\n"));
-     if (extension(EXT_FILTER_STYLES)) {
-                        yy = mk_list(LIST, NULL);
+     if (extension(yydata, EXT_FILTER_STYLES)) {
+                        yy = mk_list(yydata, LIST, NULL);
                     } else {
-                        yy = mk_str(yytext);
+                        yy = mk_str(yydata, yytext);
                         yy->key = HTMLBLOCK;
                     }
                 ;
@@ -1048,10 +1176,10 @@ YY_ACTION(void) yy_1_StyleBlock(GREG *G, char *yytext, int yyleng, yythunk *thun
 YY_ACTION(void) yy_1_HtmlBlock(GREG *G, char *yytext, int yyleng, yythunk *thunk, YY_XTYPE YY_XVAR)
 {
   yyprintf((stderr, "do yy_1_HtmlBlock\n"));
-     if (extension(EXT_FILTER_HTML)) {
-                    yy = mk_list(LIST, NULL);
+     if (extension(yydata, EXT_FILTER_HTML)) {
+                    yy = mk_list(yydata, LIST, NULL);
                 } else {
-                    yy = mk_str(yytext);
+                    yy = mk_str(yydata, yytext);
                     yy->key = HTMLBLOCK;
                 }
             ;
@@ -1065,7 +1193,7 @@ YY_ACTION(void) yy_3_ListContinuationBlock(GREG *G, char *yytext, int yyleng, yy
 {
 #define a G->val[-1]
   yyprintf((stderr, "do yy_3_ListContinuationBlock\n"));
-    yy = mk_str_from_list(a, false); ;
+    yy = mk_str_from_list(yydata, a, false); ;
 #undef a
 }
 YY_ACTION(void) yy_2_ListContinuationBlock(GREG *G, char *yytext, int yyleng, yythunk *thunk, YY_XTYPE YY_XVAR)
@@ -1080,16 +1208,16 @@ YY_ACTION(void) yy_1_ListContinuationBlock(GREG *G, char *yytext, int yyleng, yy
 #define a G->val[-1]
   yyprintf((stderr, "do yy_1_ListContinuationBlock\n"));
      if (strlen(yytext) == 0)
-                                   a = cons(mk_str("\001"), a); /* block separator */
+                                   a = cons(mk_str(yydata, "\001"), a); /* block separator */
                               else
-                                   a = cons(mk_str(yytext), a); ;
+                                   a = cons(mk_str(yydata, yytext), a); ;
 #undef a
 }
 YY_ACTION(void) yy_3_ListBlock(GREG *G, char *yytext, int yyleng, yythunk *thunk, YY_XTYPE YY_XVAR)
 {
 #define a G->val[-1]
   yyprintf((stderr, "do yy_3_ListBlock\n"));
-   yy = mk_str_from_list(a, false); ;
+   yy = mk_str_from_list(yydata, a, false); ;
 #undef a
 }
 YY_ACTION(void) yy_2_ListBlock(GREG *G, char *yytext, int yyleng, yythunk *thunk, YY_XTYPE YY_XVAR)
@@ -1111,9 +1239,9 @@ YY_ACTION(void) yy_3_ListItemTight(GREG *G, char *yytext, int yyleng, yythunk *t
 #define a G->val[-1]
   yyprintf((stderr, "do yy_3_ListItemTight\n"));
     element *raw;
-               raw = mk_str_from_list(a, false);
+               raw = mk_str_from_list(yydata, a, false);
                raw->key = RAW;
-               yy = mk_element(LISTITEM);
+               yy = mk_element(yydata, LISTITEM);
                yy->children = raw;
             ;
 #undef a
@@ -1137,9 +1265,9 @@ YY_ACTION(void) yy_3_ListItem(GREG *G, char *yytext, int yyleng, yythunk *thunk,
 #define a G->val[-1]
   yyprintf((stderr, "do yy_3_ListItem\n"));
     element *raw;
-               raw = mk_str_from_list(a, false);
+               raw = mk_str_from_list(yydata, a, false);
                raw->key = RAW;
-               yy = mk_element(LISTITEM);
+               yy = mk_element(yydata, LISTITEM);
                yy->children = raw;
             ;
 #undef a
@@ -1163,7 +1291,7 @@ YY_ACTION(void) yy_2_ListLoose(GREG *G, char *yytext, int yyleng, yythunk *thunk
 #define b G->val[-1]
 #define a G->val[-2]
   yyprintf((stderr, "do yy_2_ListLoose\n"));
-   yy = mk_list(LIST, a); ;
+   yy = mk_list(yydata, LIST, a); ;
 #undef b
 #undef a
 }
@@ -1184,7 +1312,7 @@ YY_ACTION(void) yy_2_ListTight(GREG *G, char *yytext, int yyleng, yythunk *thunk
 {
 #define a G->val[-1]
   yyprintf((stderr, "do yy_2_ListTight\n"));
-   yy = mk_list(LIST, a); ;
+   yy = mk_list(yydata, LIST, a); ;
 #undef a
 }
 YY_ACTION(void) yy_1_ListTight(GREG *G, char *yytext, int yyleng, yythunk *thunk, YY_XTYPE YY_XVAR)
@@ -1202,13 +1330,13 @@ YY_ACTION(void) yy_1_BulletList(GREG *G, char *yytext, int yyleng, yythunk *thun
 YY_ACTION(void) yy_1_HorizontalRule(GREG *G, char *yytext, int yyleng, yythunk *thunk, YY_XTYPE YY_XVAR)
 {
   yyprintf((stderr, "do yy_1_HorizontalRule\n"));
-   yy = mk_element(HRULE); ;
+   yy = mk_element(yydata, HRULE); ;
 }
 YY_ACTION(void) yy_2_Verbatim(GREG *G, char *yytext, int yyleng, yythunk *thunk, YY_XTYPE YY_XVAR)
 {
 #define a G->val[-1]
   yyprintf((stderr, "do yy_2_Verbatim\n"));
-   yy = mk_str_from_list(a, false);
+   yy = mk_str_from_list(yydata, a, false);
                  yy->key = VERBATIM; ;
 #undef a
 }
@@ -1223,7 +1351,7 @@ YY_ACTION(void) yy_3_VerbatimChunk(GREG *G, char *yytext, int yyleng, yythunk *t
 {
 #define a G->val[-1]
   yyprintf((stderr, "do yy_3_VerbatimChunk\n"));
-   yy = mk_str_from_list(a, false); ;
+   yy = mk_str_from_list(yydata, a, false); ;
 #undef a
 }
 YY_ACTION(void) yy_2_VerbatimChunk(GREG *G, char *yytext, int yyleng, yythunk *thunk, YY_XTYPE YY_XVAR)
@@ -1237,14 +1365,14 @@ YY_ACTION(void) yy_1_VerbatimChunk(GREG *G, char *yytext, int yyleng, yythunk *t
 {
 #define a G->val[-1]
   yyprintf((stderr, "do yy_1_VerbatimChunk\n"));
-   a = cons(mk_str("\n"), a); ;
+   a = cons(mk_str(yydata, "\n"), a); ;
 #undef a
 }
 YY_ACTION(void) yy_4_BlockQuoteRaw(GREG *G, char *yytext, int yyleng, yythunk *thunk, YY_XTYPE YY_XVAR)
 {
 #define a G->val[-1]
   yyprintf((stderr, "do yy_4_BlockQuoteRaw\n"));
-     yy = mk_str_from_list(a, true);
+     yy = mk_str_from_list(yydata, a, true);
                      yy->key = RAW;
                  ;
 #undef a
@@ -1253,7 +1381,7 @@ YY_ACTION(void) yy_3_BlockQuoteRaw(GREG *G, char *yytext, int yyleng, yythunk *t
 {
 #define a G->val[-1]
   yyprintf((stderr, "do yy_3_BlockQuoteRaw\n"));
-   a = cons(mk_str("\n"), a); ;
+   a = cons(mk_str(yydata, "\n"), a); ;
 #undef a
 }
 YY_ACTION(void) yy_2_BlockQuoteRaw(GREG *G, char *yytext, int yyleng, yythunk *thunk, YY_XTYPE YY_XVAR)
@@ -1274,7 +1402,7 @@ YY_ACTION(void) yy_1_BlockQuote(GREG *G, char *yytext, int yyleng, yythunk *thun
 {
 #define a G->val[-1]
   yyprintf((stderr, "do yy_1_BlockQuote\n"));
-    yy = mk_element(BLOCKQUOTE);
+    yy = mk_element(yydata, BLOCKQUOTE);
                 yy->children = a;
              ;
 #undef a
@@ -1283,7 +1411,7 @@ YY_ACTION(void) yy_2_SetextHeading2(GREG *G, char *yytext, int yyleng, yythunk *
 {
 #define a G->val[-1]
   yyprintf((stderr, "do yy_2_SetextHeading2\n"));
-   yy = mk_list(H2, a); ;
+   yy = mk_list(yydata, H2, a); ;
 #undef a
 }
 YY_ACTION(void) yy_1_SetextHeading2(GREG *G, char *yytext, int yyleng, yythunk *thunk, YY_XTYPE YY_XVAR)
@@ -1297,7 +1425,7 @@ YY_ACTION(void) yy_2_SetextHeading1(GREG *G, char *yytext, int yyleng, yythunk *
 {
 #define a G->val[-1]
   yyprintf((stderr, "do yy_2_SetextHeading1\n"));
-   yy = mk_list(H1, a); ;
+   yy = mk_list(yydata, H1, a); ;
 #undef a
 }
 YY_ACTION(void) yy_1_SetextHeading1(GREG *G, char *yytext, int yyleng, yythunk *thunk, YY_XTYPE YY_XVAR)
@@ -1312,8 +1440,7 @@ YY_ACTION(void) yy_2_AtxHeading(GREG *G, char *yytext, int yyleng, yythunk *thun
 #define a G->val[-1]
 #define s G->val[-2]
   yyprintf((stderr, "do yy_2_AtxHeading\n"));
-   yy = mk_list(s->key, a);
-              free(s); ;
+   yy = mk_list(yydata, s->key, a); ;
 #undef a
 #undef s
 }
@@ -1329,7 +1456,7 @@ YY_ACTION(void) yy_1_AtxHeading(GREG *G, char *yytext, int yyleng, yythunk *thun
 YY_ACTION(void) yy_1_AtxStart(GREG *G, char *yytext, int yyleng, yythunk *thunk, YY_XTYPE YY_XVAR)
 {
   yyprintf((stderr, "do yy_1_AtxStart\n"));
-   yy = mk_element(H1 + (int)(strlen(yytext) - 1)); ;
+   yy = mk_element(yydata, H1 + (int)(strlen(yytext) - 1)); ;
 }
 YY_ACTION(void) yy_1_Plain(GREG *G, char *yytext, int yyleng, yythunk *thunk, YY_XTYPE YY_XVAR)
 {
@@ -1349,7 +1476,7 @@ YY_ACTION(void) yy_2_Doc(GREG *G, char *yytext, int yyleng, yythunk *thunk, YY_X
 {
 #define a G->val[-1]
   yyprintf((stderr, "do yy_2_Doc\n"));
-   md.parse_result = reverse(a); ;
+   yydata->parse_result = reverse(a); ;
 #undef a
 }
 YY_ACTION(void) yy_1_Doc(GREG *G, char *yytext, int yyleng, yythunk *thunk, YY_XTYPE YY_XVAR)
@@ -1402,23 +1529,7 @@ YY_RULE(int) yy_RawNoteBlock(GREG *G)
 }
 YY_RULE(int) yy_RawNoteReference(GREG *G)
 {  int yypos0= G->pos, yythunkpos0= G->thunkpos;
-  yyprintf((stderr, "%s\n", "RawNoteReference"));  if (!yymatchString(G, "[^")) goto l13;  yyText(G, G->begin, G->end);  if (!(YY_BEGIN)) goto l13;
-  {  int yypos16= G->pos, yythunkpos16= G->thunkpos;  if (!yy_Newline(G)) { goto l16; }  goto l13;
-  l16:;	  G->pos= yypos16; G->thunkpos= yythunkpos16;
-  }
-  {  int yypos17= G->pos, yythunkpos17= G->thunkpos;  if (!yymatchChar(G, ']')) goto l17;  goto l13;
-  l17:;	  G->pos= yypos17; G->thunkpos= yythunkpos17;
-  }  if (!yymatchDot(G)) goto l13;
-  l14:;	
-  {  int yypos15= G->pos, yythunkpos15= G->thunkpos;
-  {  int yypos18= G->pos, yythunkpos18= G->thunkpos;  if (!yy_Newline(G)) { goto l18; }  goto l15;
-  l18:;	  G->pos= yypos18; G->thunkpos= yythunkpos18;
-  }
-  {  int yypos19= G->pos, yythunkpos19= G->thunkpos;  if (!yymatchChar(G, ']')) goto l19;  goto l15;
-  l19:;	  G->pos= yypos19; G->thunkpos= yythunkpos19;
-  }  if (!yymatchDot(G)) goto l15;  goto l14;
-  l15:;	  G->pos= yypos15; G->thunkpos= yythunkpos15;
-  }  yyText(G, G->begin, G->end);  if (!(YY_END)) goto l13;  if (!yymatchChar(G, ']')) goto l13;  yyDo(G, yy_1_RawNoteReference, G->begin, G->end);
+  yyprintf((stderr, "%s\n", "RawNoteReference"));  if (!yymatchString(G, "[^")) goto l13;  yyText(G, G->begin, G->end);  if (!(YY_BEGIN)) goto l13;  if (!yymatchClassRun(G, (unsigned char *)"\377\333\377\377\377\377\377\377\377\377\377\337\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\376\377\377\336\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377")) goto l13;  yyText(G, G->begin, G->end);  if (!(YY_END)) goto l13;  if (!yymatchChar(G, ']')) goto l13;  yyDo(G, yy_1_RawNoteReference, G->begin, G->end);
   yyprintf((stderr, "  ok   %s @ %s\n", "RawNoteReference", G->buf+G->pos));
   return 1;
   l13:;	  G->pos= yypos0; G->thunkpos= yythunkpos0;
@@ -1599,14 +1710,14 @@ YY_RULE(int) yy_NonAlphanumeric(GREG *G)
 YY_RULE(int) yy_ExtendedSpecialChar(GREG *G)
 {  int yypos0= G->pos, yythunkpos0= G->thunkpos;
   yyprintf((stderr, "%s\n", "ExtendedSpecialChar"));
-  {  int yypos59= G->pos, yythunkpos59= G->thunkpos;  yyText(G, G->begin, G->end);  if (!( extension(EXT_SMART) )) goto l60;
+  {  int yypos59= G->pos, yythunkpos59= G->thunkpos;  yyText(G, G->begin, G->end);  if (!( extension(yydata, EXT_SMART) )) goto l60;
   {  int yypos61= G->pos, yythunkpos61= G->thunkpos;  if (!yymatchChar(G, '.')) goto l62;  goto l61;
   l62:;	  G->pos= yypos61; G->thunkpos= yythunkpos61;  if (!yymatchChar(G, '-')) goto l63;  goto l61;
   l63:;	  G->pos= yypos61; G->thunkpos= yythunkpos61;  if (!yymatchChar(G, '\'')) goto l64;  goto l61;
   l64:;	  G->pos= yypos61; G->thunkpos= yythunkpos61;  if (!yymatchChar(G, '"')) goto l60;
   }
   l61:;	  goto l59;
-  l60:;	  G->pos= yypos59; G->thunkpos= yythunkpos59;  yyText(G, G->begin, G->end);  if (!( extension(EXT_NOTES) )) goto l58;  if (!yymatchChar(G, '^')) goto l58;
+  l60:;	  G->pos= yypos59; G->thunkpos= yythunkpos59;  yyText(G, G->begin, G->end);  if (!( extension(yydata, EXT_NOTES) )) goto l58;  if (!yymatchChar(G, '^')) goto l58;
   }
   l59:;	
   yyprintf((stderr, "  ok   %s @ %s\n", "ExtendedSpecialChar", G->buf+G->pos));
@@ -1627,22 +1738,8 @@ YY_RULE(int) yy_AlphanumericAscii(GREG *G)
 YY_RULE(int) yy_Quoted(GREG *G)
 {  int yypos0= G->pos, yythunkpos0= G->thunkpos;
   yyprintf((stderr, "%s\n", "Quoted"));
-  {  int yypos67= G->pos, yythunkpos67= G->thunkpos;  if (!yymatchChar(G, '"')) goto l68;
-  l69:;	
-  {  int yypos70= G->pos, yythunkpos70= G->thunkpos;
-  {  int yypos71= G->pos, yythunkpos71= G->thunkpos;  if (!yymatchChar(G, '"')) goto l71;  goto l70;
-  l71:;	  G->pos= yypos71; G->thunkpos= yythunkpos71;
-  }  if (!yymatchDot(G)) goto l70;  goto l69;
-  l70:;	  G->pos= yypos70; G->thunkpos= yythunkpos70;
-  }  if (!yymatchChar(G, '"')) goto l68;  goto l67;
-  l68:;	  G->pos= yypos67; G->thunkpos= yythunkpos67;  if (!yymatchChar(G, '\'')) goto l66;
-  l72:;	
-  {  int yypos73= G->pos, yythunkpos73= G->thunkpos;
-  {  int yypos74= G->pos, yythunkpos74= G->thunkpos;  if (!yymatchChar(G, '\'')) goto l74;  goto l73;
-  l74:;	  G->pos= yypos74; G->thunkpos= yythunkpos74;
-  }  if (!yymatchDot(G)) goto l73;  goto l72;
-  l73:;	  G->pos= yypos73; G->thunkpos= yythunkpos73;
-  }  if (!yymatchChar(G, '\'')) goto l66;
+  {  int yypos67= G->pos, yythunkpos67= G->thunkpos;  if (!yymatchChar(G, '"')) goto l68;  yymatchClassRun(G, (unsigned char *)"\377\377\377\377\373\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\373\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377");  if (!yymatchChar(G, '"')) goto l68;  goto l67;
+  l68:;	  G->pos= yypos67; G->thunkpos= yythunkpos67;  if (!yymatchChar(G, '\'')) goto l66;  yymatchClassRun(G, (unsigned char *)"\377\377\377\377\177\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\373\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377");  if (!yymatchChar(G, '\'')) goto l66;
   }
   l67:;	
   yyprintf((stderr, "  ok   %s @ %s\n", "Quoted", G->buf+G->pos));
@@ -1657,11 +1754,7 @@ YY_RULE(int) yy_HtmlTag(GREG *G)
   {  int yypos76= G->pos, yythunkpos76= G->thunkpos;  if (!yymatchChar(G, '/')) goto l76;  goto l77;
   l76:;	  G->pos= yypos76; G->thunkpos= yythunkpos76;
   }
-  l77:;	  if (!yy_AlphanumericAscii(G)) { goto l75; }
-  l78:;	
-  {  int yypos79= G->pos, yythunkpos79= G->thunkpos;  if (!yy_AlphanumericAscii(G)) { goto l79; }  goto l78;
-  l79:;	  G->pos= yypos79; G->thunkpos= yythunkpos79;
-  }  if (!yy_Spnl(G)) { goto l75; }
+  l77:;	  if (!yymatchClassRun(G, (unsigned char *)"\000\000\000\000\000\000\377\003\376\377\377\007\376\377\377\007\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\250\370\370\370\370\370\370\370\370\370\360\120\120\120\120\120\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000")) goto l75;  if (!yy_Spnl(G)) { goto l75; }
   l80:;	
   {  int yypos81= G->pos, yythunkpos81= G->thunkpos;  if (!yy_HtmlAttribute(G)) { goto l81; }  goto l80;
   l81:;	  G->pos= yypos81; G->thunkpos= yythunkpos81;
@@ -1870,11 +1963,7 @@ YY_RULE(int) yy_RefTitle(GREG *G)
 }
 YY_RULE(int) yy_RefSrc(GREG *G)
 {  int yypos0= G->pos, yythunkpos0= G->thunkpos;
-  yyprintf((stderr, "%s\n", "RefSrc"));  yyText(G, G->begin, G->end);  if (!(YY_BEGIN)) goto l134;  if (!yy_Nonspacechar(G)) { goto l134; }
-  l135:;	
-  {  int yypos136= G->pos, yythunkpos136= G->thunkpos;  if (!yy_Nonspacechar(G)) { goto l136; }  goto l135;
-  l136:;	  G->pos= yypos136; G->thunkpos= yythunkpos136;
-  }  yyText(G, G->begin, G->end);  if (!(YY_END)) goto l134;  yyDo(G, yy_1_RefSrc, G->begin, G->end);
+  yyprintf((stderr, "%s\n", "RefSrc"));  yyText(G, G->begin, G->end);  if (!(YY_BEGIN)) goto l134;  if (!yymatchClassRun(G, (unsigned char *)"\377\331\377\377\376\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\373\377\377\377\377\377\377\377\377\376\376\377\377\376\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377")) goto l134;  yyText(G, G->begin, G->end);  if (!(YY_END)) goto l134;  yyDo(G, yy_1_RefSrc, G->begin, G->end);
   yyprintf((stderr, "  ok   %s @ %s\n", "RefSrc", G->buf+G->pos));
   return 1;
   l134:;	  G->pos= yypos0; G->thunkpos= yythunkpos0;
@@ -1883,27 +1972,7 @@ YY_RULE(int) yy_RefSrc(GREG *G)
 }
 YY_RULE(int) yy_AutoLinkEmail(GREG *G)
 {  int yypos0= G->pos, yythunkpos0= G->thunkpos;
-  yyprintf((stderr, "%s\n", "AutoLinkEmail"));  if (!yymatchChar(G, '<')) goto l137;  yyText(G, G->begin, G->end);  if (!(YY_BEGIN)) goto l137;  if (!yymatchClass(G, (unsigned char *)"\000\000\000\000\000\050\377\003\376\377\377\207\376\377\377\007\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000")) goto l137;
-  l138:;	
-  {  int yypos139= G->pos, yythunkpos139= G->thunkpos;  if (!yymatchClass(G, (unsigned char *)"\000\000\000\000\000\050\377\003\376\377\377\207\376\377\377\007\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000")) goto l139;  goto l138;
-  l139:;	  G->pos= yypos139; G->thunkpos= yythunkpos139;
-  }  if (!yymatchChar(G, '@')) goto l137;
-  {  int yypos142= G->pos, yythunkpos142= G->thunkpos;  if (!yy_Newline(G)) { goto l142; }  goto l137;
-  l142:;	  G->pos= yypos142; G->thunkpos= yythunkpos142;
-  }
-  {  int yypos143= G->pos, yythunkpos143= G->thunkpos;  if (!yymatchChar(G, '>')) goto l143;  goto l137;
-  l143:;	  G->pos= yypos143; G->thunkpos= yythunkpos143;
-  }  if (!yymatchDot(G)) goto l137;
-  l140:;	
-  {  int yypos141= G->pos, yythunkpos141= G->thunkpos;
-  {  int yypos144= G->pos, yythunkpos144= G->thunkpos;  if (!yy_Newline(G)) { goto l144; }  goto l141;
-  l144:;	  G->pos= yypos144; G->thunkpos= yythunkpos144;
-  }
-  {  int yypos145= G->pos, yythunkpos145= G->thunkpos;  if (!yymatchChar(G, '>')) goto l145;  goto l141;
-  l145:;	  G->pos= yypos145; G->thunkpos= yythunkpos145;
-  }  if (!yymatchDot(G)) goto l141;  goto l140;
-  l141:;	  G->pos= yypos141; G->thunkpos= yythunkpos141;
-  }  yyText(G, G->begin, G->end);  if (!(YY_END)) goto l137;  if (!yymatchChar(G, '>')) goto l137;  yyDo(G, yy_1_AutoLinkEmail, G->begin, G->end);
+  yyprintf((stderr, "%s\n", "AutoLinkEmail"));  if (!yymatchChar(G, '<')) goto l137;  yyText(G, G->begin, G->end);  if (!(YY_BEGIN)) goto l137;  if (!yymatchClassRun(G, (unsigned char *)"\000\000\000\000\000\050\377\003\376\377\377\207\376\377\377\007\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\250\370\370\370\370\370\370\370\370\370\360\124\120\124\120\160\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000")) goto l137;  if (!yymatchChar(G, '@')) goto l137;  if (!yymatchClassRun(G, (unsigned char *)"\377\333\377\377\377\377\377\277\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\376\377\377\376\367\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377")) goto l137;  yyText(G, G->begin, G->end);  if (!(YY_END)) goto l137;  if (!yymatchChar(G, '>')) goto l137;  yyDo(G, yy_1_AutoLinkEmail, G->begin, G->end);
   yyprintf((stderr, "  ok   %s @ %s\n", "AutoLinkEmail", G->buf+G->pos));
   return 1;
   l137:;	  G->pos= yypos0; G->thunkpos= yythunkpos0;
@@ -1912,27 +1981,7 @@ YY_RULE(int) yy_AutoLinkEmail(GREG *G)
 }
 YY_RULE(int) yy_AutoLinkUrl(GREG *G)
 {  int yypos0= G->pos, yythunkpos0= G->thunkpos;
-  yyprintf((stderr, "%s\n", "AutoLinkUrl"));  if (!yymatchChar(G, '<')) goto l146;  yyText(G, G->begin, G->end);  if (!(YY_BEGIN)) goto l146;  if (!yymatchClass(G, (unsigned char *)"\000\000\000\000\000\000\000\000\376\377\377\007\376\377\377\007\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000")) goto l146;
-  l147:;	
-  {  int yypos148= G->pos, yythunkpos148= G->thunkpos;  if (!yymatchClass(G, (unsigned char *)"\000\000\000\000\000\000\000\000\376\377\377\007\376\377\377\007\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000")) goto l148;  goto l147;
-  l148:;	  G->pos= yypos148; G->thunkpos= yythunkpos148;
-  }  if (!yymatchString(G, "://")) goto l146;
-  {  int yypos151= G->pos, yythunkpos151= G->thunkpos;  if (!yy_Newline(G)) { goto l151; }  goto l146;
-  l151:;	  G->pos= yypos151; G->thunkpos= yythunkpos151;
-  }
-  {  int yypos152= G->pos, yythunkpos152= G->thunkpos;  if (!yymatchChar(G, '>')) goto l152;  goto l146;
-  l152:;	  G->pos= yypos152; G->thunkpos= yythunkpos152;
-  }  if (!yymatchDot(G)) goto l146;
-  l149:;	
-  {  int yypos150= G->pos, yythunkpos150= G->thunkpos;
-  {  int yypos153= G->pos, yythunkpos153= G->thunkpos;  if (!yy_Newline(G)) { goto l153; }  goto l150;
-  l153:;	  G->pos= yypos153; G->thunkpos= yythunkpos153;
-  }
-  {  int yypos154= G->pos, yythunkpos154= G->thunkpos;  if (!yymatchChar(G, '>')) goto l154;  goto l150;
-  l154:;	  G->pos= yypos154; G->thunkpos= yythunkpos154;
-  }  if (!yymatchDot(G)) goto l150;  goto l149;
-  l150:;	  G->pos= yypos150; G->thunkpos= yythunkpos150;
-  }  yyText(G, G->begin, G->end);  if (!(YY_END)) goto l146;  if (!yymatchChar(G, '>')) goto l146;  yyDo(G, yy_1_AutoLinkUrl, G->begin, G->end);
+  yyprintf((stderr, "%s\n", "AutoLinkUrl"));  if (!yymatchChar(G, '<')) goto l146;  yyText(G, G->begin, G->end);  if (!(YY_BEGIN)) goto l146;  if (!yymatchClassRun(G, (unsigned char *)"\000\000\000\000\000\000\000\000\376\377\377\007\376\377\377\007\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\240\360\360\360\360\360\360\360\360\360\360\120\120\120\120\120\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000")) goto l146;  if (!yymatchString(G, "://")) goto l146;  if (!yymatchClassRun(G, (unsigned char *)"\377\333\377\377\377\377\377\277\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\376\377\377\376\367\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377")) goto l146;  yyText(G, G->begin, G->end);  if (!(YY_END)) goto l146;  if (!yymatchChar(G, '>')) goto l146;  yyDo(G, yy_1_AutoLinkUrl, G->begin, G->end);
   yyprintf((stderr, "  ok   %s @ %s\n", "AutoLinkUrl", G->buf+G->pos));
   return 1;
   l146:;	  G->pos= yypos0; G->thunkpos= yythunkpos0;
@@ -2000,29 +2049,7 @@ YY_RULE(int) yy_SourceContents(GREG *G)
   {  int yypos171= G->pos, yythunkpos171= G->thunkpos;
   l173:;	
   {  int yypos174= G->pos, yythunkpos174= G->thunkpos;
-  {  int yypos175= G->pos, yythunkpos175= G->thunkpos;
-  {  int yypos179= G->pos, yythunkpos179= G->thunkpos;  if (!yymatchChar(G, '(')) goto l179;  goto l176;
-  l179:;	  G->pos= yypos179; G->thunkpos= yythunkpos179;
-  }
-  {  int yypos180= G->pos, yythunkpos180= G->thunkpos;  if (!yymatchChar(G, ')')) goto l180;  goto l176;
-  l180:;	  G->pos= yypos180; G->thunkpos= yythunkpos180;
-  }
-  {  int yypos181= G->pos, yythunkpos181= G->thunkpos;  if (!yymatchChar(G, '>')) goto l181;  goto l176;
-  l181:;	  G->pos= yypos181; G->thunkpos= yythunkpos181;
-  }  if (!yy_Nonspacechar(G)) { goto l176; }
-  l177:;	
-  {  int yypos178= G->pos, yythunkpos178= G->thunkpos;
-  {  int yypos182= G->pos, yythunkpos182= G->thunkpos;  if (!yymatchChar(G, '(')) goto l182;  goto l178;
-  l182:;	  G->pos= yypos182; G->thunkpos= yythunkpos182;
-  }
-  {  int yypos183= G->pos, yythunkpos183= G->thunkpos;  if (!yymatchChar(G, ')')) goto l183;  goto l178;
-  l183:;	  G->pos= yypos183; G->thunkpos= yythunkpos183;
-  }
-  {  int yypos184= G->pos, yythunkpos184= G->thunkpos;  if (!yymatchChar(G, '>')) goto l184;  goto l178;
-  l184:;	  G->pos= yypos184; G->thunkpos= yythunkpos184;
-  }  if (!yy_Nonspacechar(G)) { goto l178; }  goto l177;
-  l178:;	  G->pos= yypos178; G->thunkpos= yythunkpos178;
-  }  goto l175;
+  {  int yypos175= G->pos, yythunkpos175= G->thunkpos;  if (!yymatchClassRun(G, (unsigned char *)"\377\331\377\377\376\374\377\277\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\373\377\377\377\377\377\377\377\373\372\376\377\377\376\367\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377")) goto l176;  goto l175;
   l176:;	  G->pos= yypos175; G->thunkpos= yythunkpos175;  if (!yymatchChar(G, '(')) goto l174;  if (!yy_SourceContents(G)) { goto l174; }  if (!yymatchChar(G, ')')) goto l174;
   }
   l175:;	  goto l173;
@@ -2065,15 +2092,20 @@ YY_RULE(int) yy_Source(GREG *G)
   return 0;
 }
 YY_RULE(int) yy_Label(GREG *G)
-{  int yypos0= G->pos, yythunkpos0= G->thunkpos;  yyDo(G, yyPush, 1, 0);
+{
+#ifdef YY_MEMO
+  int yymemopos= G->pos, yymemothunkpos= G->thunkpos;
+  switch (yyMemoFetch(G, 201)) { case 0: return 0; case 1: return 1; }
+#endif
+  int yypos0= G->pos, yythunkpos0= G->thunkpos;  yyDo(G, yyPush, 1, 0);
   yyprintf((stderr, "%s\n", "Label"));  if (!yymatchChar(G, '[')) goto l192;
   {  int yypos193= G->pos, yythunkpos193= G->thunkpos;
   {  int yypos195= G->pos, yythunkpos195= G->thunkpos;  if (!yymatchChar(G, '^')) goto l195;  goto l194;
   l195:;	  G->pos= yypos195; G->thunkpos= yythunkpos195;
-  }  yyText(G, G->begin, G->end);  if (!( extension(EXT_NOTES) )) goto l194;  goto l193;
+  }  yyText(G, G->begin, G->end);  if (!( extension(yydata, EXT_NOTES) )) goto l194;  goto l193;
   l194:;	  G->pos= yypos193; G->thunkpos= yythunkpos193;
   {  int yypos196= G->pos, yythunkpos196= G->thunkpos;  if (!yymatchDot(G)) goto l192;  G->pos= yypos196; G->thunkpos= yythunkpos196;
-  }  yyText(G, G->begin, G->end);  if (!( !extension(EXT_NOTES) )) goto l192;
+  }  yyText(G, G->begin, G->end);  if (!( !extension(yydata, EXT_NOTES) )) goto l192;
   }
   l193:;	  if (!yy_StartList(G)) { goto l192; }  yyDo(G, yySet, -1, 0);
   l197:;	
@@ -2084,9 +2116,15 @@ YY_RULE(int) yy_Label(GREG *G)
   l198:;	  G->pos= yypos198; G->thunkpos= yythunkpos198;
   }  if (!yymatchChar(G, ']')) goto l192;  yyDo(G, yy_2_Label, G->begin, G->end);
   yyprintf((stderr, "  ok   %s @ %s\n", "Label", G->buf+G->pos));  yyDo(G, yyPop, 1, 0);
+#ifdef YY_MEMO
+  yyMemoStore(G, 201, yymemopos, yymemothunkpos, 1);
+#endif
   return 1;
   l192:;	  G->pos= yypos0; G->thunkpos= yythunkpos0;
   yyprintf((stderr, "  fail %s @ %s\n", "Label", G->buf+G->pos));
+#ifdef YY_MEMO
+  yyMemoStore(G, 201, yymemopos, yymemothunkpos, 0);
+#endif
   return 0;
 }
 YY_RULE(int) yy_ReferenceLinkSingle(GREG *G)
@@ -2360,16 +2398,8 @@ YY_RULE(int) yy_EmphStar(GREG *G)
 YY_RULE(int) yy_StarLine(GREG *G)
 {  int yypos0= G->pos, yythunkpos0= G->thunkpos;
   yyprintf((stderr, "%s\n", "StarLine"));
-  {  int yypos261= G->pos, yythunkpos261= G->thunkpos;  yyText(G, G->begin, G->end);  if (!(YY_BEGIN)) goto l262;  if (!yymatchString(G, "****")) goto l262;
-  l263:;	
-  {  int yypos264= G->pos, yythunkpos264= G->thunkpos;  if (!yymatchChar(G, '*')) goto l264;  goto l263;
-  l264:;	  G->pos= yypos264; G->thunkpos= yythunkpos264;
-  }  yyText(G, G->begin, G->end);  if (!(YY_END)) goto l262;  goto l261;
-  l262:;	  G->pos= yypos261; G->thunkpos= yythunkpos261;  yyText(G, G->begin, G->end);  if (!(YY_BEGIN)) goto l260;  if (!yy_Spacechar(G)) { goto l260; }  if (!yymatchChar(G, '*')) goto l260;
-  l265:;	
-  {  int yypos266= G->pos, yythunkpos266= G->thunkpos;  if (!yymatchChar(G, '*')) goto l266;  goto l265;
-  l266:;	  G->pos= yypos266; G->thunkpos= yythunkpos266;
-  }
+  {  int yypos261= G->pos, yythunkpos261= G->thunkpos;  yyText(G, G->begin, G->end);  if (!(YY_BEGIN)) goto l262;  if (!yymatchString(G, "****")) goto l262;  yymatchClassRun(G, (unsigned char *)"\000\000\000\000\000\004\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\004\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000");  yyText(G, G->begin, G->end);  if (!(YY_END)) goto l262;  goto l261;
+  l262:;	  G->pos= yypos261; G->thunkpos= yythunkpos261;  yyText(G, G->begin, G->end);  if (!(YY_BEGIN)) goto l260;  if (!yy_Spacechar(G)) { goto l260; }  if (!yymatchClassRun(G, (unsigned char *)"\000\000\000\000\000\004\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\004\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000")) goto l260;
   {  int yypos267= G->pos, yythunkpos267= G->thunkpos;  if (!yy_Spacechar(G)) { goto l260; }  G->pos= yypos267; G->thunkpos= yythunkpos267;
   }  yyText(G, G->begin, G->end);  if (!(YY_END)) goto l260;
   }
@@ -2383,16 +2413,8 @@ YY_RULE(int) yy_StarLine(GREG *G)
 YY_RULE(int) yy_UlLine(GREG *G)
 {  int yypos0= G->pos, yythunkpos0= G->thunkpos;
   yyprintf((stderr, "%s\n", "UlLine"));
-  {  int yypos269= G->pos, yythunkpos269= G->thunkpos;  yyText(G, G->begin, G->end);  if (!(YY_BEGIN)) goto l270;  if (!yymatchString(G, "____")) goto l270;
-  l271:;	
-  {  int yypos272= G->pos, yythunkpos272= G->thunkpos;  if (!yymatchChar(G, '_')) goto l272;  goto l271;
-  l272:;	  G->pos= yypos272; G->thunkpos= yythunkpos272;
-  }  yyText(G, G->begin, G->end);  if (!(YY_END)) goto l270;  goto l269;
-  l270:;	  G->pos= yypos269; G->thunkpos= yythunkpos269;  yyText(G, G->begin, G->end);  if (!(YY_BEGIN)) goto l268;  if (!yy_Spacechar(G)) { goto l268; }  if (!yymatchChar(G, '_')) goto l268;
-  l273:;	
-  {  int yypos274= G->pos, yythunkpos274= G->thunkpos;  if (!yymatchChar(G, '_')) goto l274;  goto l273;
-  l274:;	  G->pos= yypos274; G->thunkpos= yythunkpos274;
-  }
+  {  int yypos269= G->pos, yythunkpos269= G->thunkpos;  yyText(G, G->begin, G->end);  if (!(YY_BEGIN)) goto l270;  if (!yymatchString(G, "____")) goto l270;  yymatchClassRun(G, (unsigned char *)"\000\000\000\000\000\000\000\000\000\000\000\200\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\040\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000");  yyText(G, G->begin, G->end);  if (!(YY_END)) goto l270;  goto l269;
+  l270:;	  G->pos= yypos269; G->thunkpos= yythunkpos269;  yyText(G, G->begin, G->end);  if (!(YY_BEGIN)) goto l268;  if (!yy_Spacechar(G)) { goto l268; }  if (!yymatchClassRun(G, (unsigned char *)"\000\000\000\000\000\000\000\000\000\000\000\200\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\040\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000")) goto l268;
   {  int yypos275= G->pos, yythunkpos275= G->thunkpos;  if (!yy_Spacechar(G)) { goto l268; }  G->pos= yypos275; G->thunkpos= yythunkpos275;
   }  yyText(G, G->begin, G->end);  if (!(YY_END)) goto l268;
   }
@@ -2450,16 +2472,8 @@ YY_RULE(int) yy_NormalEndline(GREG *G)
   l293:;	  G->pos= yypos293; G->thunkpos= yythunkpos293;
   }
   {  int yypos294= G->pos, yythunkpos294= G->thunkpos;  if (!yy_Line(G)) { goto l294; }
-  {  int yypos295= G->pos, yythunkpos295= G->thunkpos;  if (!yymatchString(G, "===")) goto l296;
-  l297:;	
-  {  int yypos298= G->pos, yythunkpos298= G->thunkpos;  if (!yymatchChar(G, '=')) goto l298;  goto l297;
-  l298:;	  G->pos= yypos298; G->thunkpos= yythunkpos298;
-  }  goto l295;
-  l296:;	  G->pos= yypos295; G->thunkpos= yythunkpos295;  if (!yymatchString(G, "---")) goto l294;
-  l299:;	
-  {  int yypos300= G->pos, yythunkpos300= G->thunkpos;  if (!yymatchChar(G, '-')) goto l300;  goto l299;
-  l300:;	  G->pos= yypos300; G->thunkpos= yythunkpos300;
-  }
+  {  int yypos295= G->pos, yythunkpos295= G->thunkpos;  if (!yymatchString(G, "===")) goto l296;  yymatchClassRun(G, (unsigned char *)"\000\000\000\000\000\000\000\040\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\010\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000");  goto l295;
+  l296:;	  G->pos= yypos295; G->thunkpos= yythunkpos295;  if (!yymatchString(G, "---")) goto l294;  yymatchClassRun(G, (unsigned char *)"\000\000\000\000\000\040\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\004\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000");
   }
   l295:;	  if (!yy_Newline(G)) { goto l294; }  goto l290;
   l294:;	  G->pos= yypos294; G->thunkpos= yythunkpos294;
@@ -2490,11 +2504,7 @@ YY_RULE(int) yy_LineBreak(GREG *G)
 }
 YY_RULE(int) yy_CharEntity(GREG *G)
 {  int yypos0= G->pos, yythunkpos0= G->thunkpos;
-  yyprintf((stderr, "%s\n", "CharEntity"));  yyText(G, G->begin, G->end);  if (!(YY_BEGIN)) goto l303;  if (!yymatchChar(G, '&')) goto l303;  if (!yymatchClass(G, (unsigned char *)"\000\000\000\000\000\000\377\003\376\377\377\007\376\377\377\007\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000")) goto l303;
-  l304:;	
-  {  int yypos305= G->pos, yythunkpos305= G->thunkpos;  if (!yymatchClass(G, (unsigned char *)"\000\000\000\000\000\000\377\003\376\377\377\007\376\377\377\007\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000")) goto l305;  goto l304;
-  l305:;	  G->pos= yypos305; G->thunkpos= yythunkpos305;
-  }  if (!yymatchChar(G, ';')) goto l303;  yyText(G, G->begin, G->end);  if (!(YY_END)) goto l303;
+  yyprintf((stderr, "%s\n", "CharEntity"));  yyText(G, G->begin, G->end);  if (!(YY_BEGIN)) goto l303;  if (!yymatchChar(G, '&')) goto l303;  if (!yymatchClassRun(G, (unsigned char *)"\000\000\000\000\000\000\377\003\376\377\377\007\376\377\377\007\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\250\370\370\370\370\370\370\370\370\370\360\120\120\120\120\120\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000")) goto l303;  if (!yymatchChar(G, ';')) goto l303;  yyText(G, G->begin, G->end);  if (!(YY_END)) goto l303;
   yyprintf((stderr, "  ok   %s @ %s\n", "CharEntity", G->buf+G->pos));
   return 1;
   l303:;	  G->pos= yypos0; G->thunkpos= yythunkpos0;
@@ -2503,11 +2513,7 @@ YY_RULE(int) yy_CharEntity(GREG *G)
 }
 YY_RULE(int) yy_DecEntity(GREG *G)
 {  int yypos0= G->pos, yythunkpos0= G->thunkpos;
-  yyprintf((stderr, "%s\n", "DecEntity"));  yyText(G, G->begin, G->end);  if (!(YY_BEGIN)) goto l306;  if (!yymatchChar(G, '&')) goto l306;  if (!yymatchChar(G, '#')) goto l306;  if (!yymatchClass(G, (unsigned char *)"\000\000\000\000\000\000\377\003\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000")) goto l306;
-  l307:;	
-  {  int yypos308= G->pos, yythunkpos308= G->thunkpos;  if (!yymatchClass(G, (unsigned char *)"\000\000\000\000\000\000\377\003\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000")) goto l308;  goto l307;
-  l308:;	  G->pos= yypos308; G->thunkpos= yythunkpos308;
-  }  yyText(G, G->begin, G->end);  if (!(YY_END)) goto l306;  if (!yymatchChar(G, ';')) goto l306;  yyText(G, G->begin, G->end);  if (!(YY_END)) goto l306;
+  yyprintf((stderr, "%s\n", "DecEntity"));  yyText(G, G->begin, G->end);  if (!(YY_BEGIN)) goto l306;  if (!yymatchChar(G, '&')) goto l306;  if (!yymatchChar(G, '#')) goto l306;  if (!yymatchClassRun(G, (unsigned char *)"\000\000\000\000\000\000\377\003\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\010\010\010\010\010\010\010\010\010\010\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000")) goto l306;  yyText(G, G->begin, G->end);  if (!(YY_END)) goto l306;  if (!yymatchChar(G, ';')) goto l306;  yyText(G, G->begin, G->end);  if (!(YY_END)) goto l306;
   yyprintf((stderr, "  ok   %s @ %s\n", "DecEntity", G->buf+G->pos));
   return 1;
   l306:;	  G->pos= yypos0; G->thunkpos= yythunkpos0;
@@ -2516,11 +2522,7 @@ YY_RULE(int) yy_DecEntity(GREG *G)
 }
 YY_RULE(int) yy_HexEntity(GREG *G)
 {  int yypos0= G->pos, yythunkpos0= G->thunkpos;
-  yyprintf((stderr, "%s\n", "HexEntity"));  yyText(G, G->begin, G->end);  if (!(YY_BEGIN)) goto l309;  if (!yymatchChar(G, '&')) goto l309;  if (!yymatchChar(G, '#')) goto l309;  if (!yymatchClass(G, (unsigned char *)"\000\000\000\000\000\000\000\000\000\000\000\001\000\000\000\001\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000")) goto l309;  if (!yymatchClass(G, (unsigned char *)"\000\000\000\000\000\000\377\003\176\000\000\000\176\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000")) goto l309;
-  l310:;	
-  {  int yypos311= G->pos, yythunkpos311= G->thunkpos;  if (!yymatchClass(G, (unsigned char *)"\000\000\000\000\000\000\377\003\176\000\000\000\176\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000")) goto l311;  goto l310;
-  l311:;	  G->pos= yypos311; G->thunkpos= yythunkpos311;
-  }  if (!yymatchChar(G, ';')) goto l309;  yyText(G, G->begin, G->end);  if (!(YY_END)) goto l309;
+  yyprintf((stderr, "%s\n", "HexEntity"));  yyText(G, G->begin, G->end);  if (!(YY_BEGIN)) goto l309;  if (!yymatchChar(G, '&')) goto l309;  if (!yymatchChar(G, '#')) goto l309;  if (!yymatchClass(G, (unsigned char *)"\000\000\000\000\000\000\000\000\000\000\000\001\000\000\000\001\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000")) goto l309;  if (!yymatchClassRun(G, (unsigned char *)"\000\000\000\000\000\000\377\003\176\000\000\000\176\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\010\130\130\130\130\130\130\010\010\010\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000")) goto l309;  if (!yymatchChar(G, ';')) goto l309;  yyText(G, G->begin, G->end);  if (!(YY_END)) goto l309;
   yyprintf((stderr, "  ok   %s @ %s\n", "HexEntity", G->buf+G->pos));
   return 1;
   l309:;	  G->pos= yypos0; G->thunkpos= yythunkpos0;
@@ -2695,7 +2697,7 @@ YY_RULE(int) yy_Symbol(GREG *G)
 }
 YY_RULE(int) yy_Smart(GREG *G)
 {  int yypos0= G->pos, yythunkpos0= G->thunkpos;
-  yyprintf((stderr, "%s\n", "Smart"));  yyText(G, G->begin, G->end);  if (!( extension(EXT_SMART) )) goto l448;
+  yyprintf((stderr, "%s\n", "Smart"));  yyText(G, G->begin, G->end);  if (!( extension(yydata, EXT_SMART) )) goto l448;
   {  int yypos449= G->pos, yythunkpos449= G->thunkpos;  if (!yy_Ellipsis(G)) { goto l450; }  goto l449;
   l450:;	  G->pos= yypos449; G->thunkpos= yythunkpos449;  if (!yy_Dash(G)) { goto l451; }  goto l449;
   l451:;	  G->pos= yypos449; G->thunkpos= yythunkpos449;  if (!yy_SingleQuoted(G)) { goto l452; }  goto l449;
@@ -2752,25 +2754,11 @@ YY_RULE(int) yy_Code(GREG *G)
 {  int yypos0= G->pos, yythunkpos0= G->thunkpos;
   yyprintf((stderr, "%s\n", "Code"));
   {  int yypos464= G->pos, yythunkpos464= G->thunkpos;  if (!yy_Ticks1(G)) { goto l465; }  if (!yy_Sp(G)) { goto l465; }  yyText(G, G->begin, G->end);  if (!(YY_BEGIN)) goto l465;
-  {  int yypos468= G->pos, yythunkpos468= G->thunkpos;
-  {  int yypos472= G->pos, yythunkpos472= G->thunkpos;  if (!yymatchChar(G, '`')) goto l472;  goto l469;
-  l472:;	  G->pos= yypos472; G->thunkpos= yythunkpos472;
-  }  if (!yy_Nonspacechar(G)) { goto l469; }
-  l470:;	
-  {  int yypos471= G->pos, yythunkpos471= G->thunkpos;
-  {  int yypos473= G->pos, yythunkpos473= G->thunkpos;  if (!yymatchChar(G, '`')) goto l473;  goto l471;
-  l473:;	  G->pos= yypos473; G->thunkpos= yythunkpos473;
-  }  if (!yy_Nonspacechar(G)) { goto l471; }  goto l470;
-  l471:;	  G->pos= yypos471; G->thunkpos= yythunkpos471;
-  }  goto l468;
+  {  int yypos468= G->pos, yythunkpos468= G->thunkpos;  if (!yymatchClassRun(G, (unsigned char *)"\377\331\377\377\376\377\377\377\377\377\377\377\376\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\273\377\377\377\377\377\377\377\377\376\376\377\377\376\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377")) goto l469;  goto l468;
   l469:;	  G->pos= yypos468; G->thunkpos= yythunkpos468;
   {  int yypos475= G->pos, yythunkpos475= G->thunkpos;  if (!yy_Ticks1(G)) { goto l475; }  goto l474;
   l475:;	  G->pos= yypos475; G->thunkpos= yythunkpos475;
-  }  if (!yymatchChar(G, '`')) goto l474;
-  l476:;	
-  {  int yypos477= G->pos, yythunkpos477= G->thunkpos;  if (!yymatchChar(G, '`')) goto l477;  goto l476;
-  l477:;	  G->pos= yypos477; G->thunkpos= yythunkpos477;
-  }  goto l468;
+  }  if (!yymatchChar(G, '`')) goto l474;  yymatchClassRun(G, (unsigned char *)"\000\000\000\000\000\000\000\000\000\000\000\000\001\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\100\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000");  goto l468;
   l474:;	  G->pos= yypos468; G->thunkpos= yythunkpos468;
   {  int yypos478= G->pos, yythunkpos478= G->thunkpos;  if (!yy_Sp(G)) { goto l478; }  if (!yy_Ticks1(G)) { goto l478; }  goto l465;
   l478:;	  G->pos= yypos478; G->thunkpos= yythunkpos478;
@@ -2786,25 +2774,11 @@ YY_RULE(int) yy_Code(GREG *G)
   l468:;	
   l466:;	
   {  int yypos467= G->pos, yythunkpos467= G->thunkpos;
-  {  int yypos482= G->pos, yythunkpos482= G->thunkpos;
-  {  int yypos486= G->pos, yythunkpos486= G->thunkpos;  if (!yymatchChar(G, '`')) goto l486;  goto l483;
-  l486:;	  G->pos= yypos486; G->thunkpos= yythunkpos486;
-  }  if (!yy_Nonspacechar(G)) { goto l483; }
-  l484:;	
-  {  int yypos485= G->pos, yythunkpos485= G->thunkpos;
-  {  int yypos487= G->pos, yythunkpos487= G->thunkpos;  if (!yymatchChar(G, '`')) goto l487;  goto l485;
-  l487:;	  G->pos= yypos487; G->thunkpos= yythunkpos487;
-  }  if (!yy_Nonspacechar(G)) { goto l485; }  goto l484;
-  l485:;	  G->pos= yypos485; G->thunkpos= yythunkpos485;
-  }  goto l482;
+  {  int yypos482= G->pos, yythunkpos482= G->thunkpos;  if (!yymatchClassRun(G, (unsigned char *)"\377\331\377\377\376\377\377\377\377\377\377\377\376\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\273\377\377\377\377\377\377\377\377\376\376\377\377\376\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377")) goto l483;  goto l482;
   l483:;	  G->pos= yypos482; G->thunkpos= yythunkpos482;
   {  int yypos489= G->pos, yythunkpos489= G->thunkpos;  if (!yy_Ticks1(G)) { goto l489; }  goto l488;
   l489:;	  G->pos= yypos489; G->thunkpos= yythunkpos489;
-  }  if (!yymatchChar(G, '`')) goto l488;
-  l490:;	
-  {  int yypos491= G->pos, yythunkpos491= G->thunkpos;  if (!yymatchChar(G, '`')) goto l491;  goto l490;
-  l491:;	  G->pos= yypos491; G->thunkpos= yythunkpos491;
-  }  goto l482;
+  }  if (!yymatchChar(G, '`')) goto l488;  yymatchClassRun(G, (unsigned char *)"\000\000\000\000\000\000\000\000\000\000\000\000\001\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\100\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000");  goto l482;
   l488:;	  G->pos= yypos482; G->thunkpos= yythunkpos482;
   {  int yypos492= G->pos, yythunkpos492= G->thunkpos;  if (!yy_Sp(G)) { goto l492; }  if (!yy_Ticks1(G)) { goto l492; }  goto l467;
   l492:;	  G->pos= yypos492; G->thunkpos= yythunkpos492;
@@ -2821,25 +2795,11 @@ YY_RULE(int) yy_Code(GREG *G)
   l467:;	  G->pos= yypos467; G->thunkpos= yythunkpos467;
   }  yyText(G, G->begin, G->end);  if (!(YY_END)) goto l465;  if (!yy_Sp(G)) { goto l465; }  if (!yy_Ticks1(G)) { goto l465; }  goto l464;
   l465:;	  G->pos= yypos464; G->thunkpos= yythunkpos464;  if (!yy_Ticks2(G)) { goto l496; }  if (!yy_Sp(G)) { goto l496; }  yyText(G, G->begin, G->end);  if (!(YY_BEGIN)) goto l496;
-  {  int yypos499= G->pos, yythunkpos499= G->thunkpos;
-  {  int yypos503= G->pos, yythunkpos503= G->thunkpos;  if (!yymatchChar(G, '`')) goto l503;  goto l500;
-  l503:;	  G->pos= yypos503; G->thunkpos= yythunkpos503;
-  }  if (!yy_Nonspacechar(G)) { goto l500; }
-  l501:;	
-  {  int yypos502= G->pos, yythunkpos502= G->thunkpos;
-  {  int yypos504= G->pos, yythunkpos504= G->thunkpos;  if (!yymatchChar(G, '`')) goto l504;  goto l502;
-  l504:;	  G->pos= yypos504; G->thunkpos= yythunkpos504;
-  }  if (!yy_Nonspacechar(G)) { goto l502; }  goto l501;
-  l502:;	  G->pos= yypos502; G->thunkpos= yythunkpos502;
-  }  goto l499;
+  {  int yypos499= G->pos, yythunkpos499= G->thunkpos;  if (!yymatchClassRun(G, (unsigned char *)"\377\331\377\377\376\377\377\377\377\377\377\377\376\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\273\377\377\377\377\377\377\377\377\376\376\377\377\376\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377")) goto l500;  goto l499;
   l500:;	  G->pos= yypos499; G->thunkpos= yythunkpos499;
   {  int yypos506= G->pos, yythunkpos506= G->thunkpos;  if (!yy_Ticks2(G)) { goto l506; }  goto l505;
   l506:;	  G->pos= yypos506; G->thunkpos= yythunkpos506;
-  }  if (!yymatchChar(G, '`')) goto l505;
-  l507:;	
-  {  int yypos508= G->pos, yythunkpos508= G->thunkpos;  if (!yymatchChar(G, '`')) goto l508;  goto l507;
-  l508:;	  G->pos= yypos508; G->thunkpos= yythunkpos508;
-  }  goto l499;
+  }  if (!yymatchChar(G, '`')) goto l505;  yymatchClassRun(G, (unsigned char *)"\000\000\000\000\000\000\000\000\000\000\000\000\001\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\100\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000");  goto l499;
   l505:;	  G->pos= yypos499; G->thunkpos= yythunkpos499;
   {  int yypos509= G->pos, yythunkpos509= G->thunkpos;  if (!yy_Sp(G)) { goto l509; }  if (!yy_Ticks2(G)) { goto l509; }  goto l496;
   l509:;	  G->pos= yypos509; G->thunkpos= yythunkpos509;
@@ -2855,25 +2815,11 @@ YY_RULE(int) yy_Code(GREG *G)
   l499:;	
   l497:;	
   {  int yypos498= G->pos, yythunkpos498= G->thunkpos;
-  {  int yypos513= G->pos, yythunkpos513= G->thunkpos;
-  {  int yypos517= G->pos, yythunkpos517= G->thunkpos;  if (!yymatchChar(G, '`')) goto l517;  goto l514;
-  l517:;	  G->pos= yypos517; G->thunkpos= yythunkpos517;
-  }  if (!yy_Nonspacechar(G)) { goto l514; }
-  l515:;	
-  {  int yypos516= G->pos, yythunkpos516= G->thunkpos;
-  {  int yypos518= G->pos, yythunkpos518= G->thunkpos;  if (!yymatchChar(G, '`')) goto l518;  goto l516;
-  l518:;	  G->pos= yypos518; G->thunkpos= yythunkpos518;
-  }  if (!yy_Nonspacechar(G)) { goto l516; }  goto l515;
-  l516:;	  G->pos= yypos516; G->thunkpos= yythunkpos516;
-  }  goto l513;
+  {  int yypos513= G->pos, yythunkpos513= G->thunkpos;  if (!yymatchClassRun(G, (unsigned char *)"\377\331\377\377\376\377\377\377\377\377\377\377\376\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\273\377\377\377\377\377\377\377\377\376\376\377\377\376\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377")) goto l514;  goto l513;
   l514:;	  G->pos= yypos513; G->thunkpos= yythunkpos513;
   {  int yypos520= G->pos, yythunkpos520= G->thunkpos;  if (!yy_Ticks2(G)) { goto l520; }  goto l519;
   l520:;	  G->pos= yypos520; G->thunkpos= yythunkpos520;
-  }  if (!yymatchChar(G, '`')) goto l519;
-  l521:;	
-  {  int yypos522= G->pos, yythunkpos522= G->thunkpos;  if (!yymatchChar(G, '`')) goto l522;  goto l521;
-  l522:;	  G->pos= yypos522; G->thunkpos= yythunkpos522;
-  }  goto l513;
+  }  if (!yymatchChar(G, '`')) goto l519;  yymatchClassRun(G, (unsigned char *)"\000\000\000\000\000\000\000\000\000\000\000\000\001\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\100\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000");  goto l513;
   l519:;	  G->pos= yypos513; G->thunkpos= yythunkpos513;
   {  int yypos523= G->pos, yythunkpos523= G->thunkpos;  if (!yy_Sp(G)) { goto l523; }  if (!yy_Ticks2(G)) { goto l523; }  goto l498;
   l523:;	  G->pos= yypos523; G->thunkpos= yythunkpos523;
@@ -2890,25 +2836,11 @@ YY_RULE(int) yy_Code(GREG *G)
   l498:;	  G->pos= yypos498; G->thunkpos= yythunkpos498;
   }  yyText(G, G->begin, G->end);  if (!(YY_END)) goto l496;  if (!yy_Sp(G)) { goto l496; }  if (!yy_Ticks2(G)) { goto l496; }  goto l464;
   l496:;	  G->pos= yypos464; G->thunkpos= yythunkpos464;  if (!yy_Ticks3(G)) { goto l527; }  if (!yy_Sp(G)) { goto l527; }  yyText(G, G->begin, G->end);  if (!(YY_BEGIN)) goto l527;
-  {  int yypos530= G->pos, yythunkpos530= G->thunkpos;
-  {  int yypos534= G->pos, yythunkpos534= G->thunkpos;  if (!yymatchChar(G, '`')) goto l534;  goto l531;
-  l534:;	  G->pos= yypos534; G->thunkpos= yythunkpos534;
-  }  if (!yy_Nonspacechar(G)) { goto l531; }
-  l532:;	
-  {  int yypos533= G->pos, yythunkpos533= G->thunkpos;
-  {  int yypos535= G->pos, yythunkpos535= G->thunkpos;  if (!yymatchChar(G, '`')) goto l535;  goto l533;
-  l535:;	  G->pos= yypos535; G->thunkpos= yythunkpos535;
-  }  if (!yy_Nonspacechar(G)) { goto l533; }  goto l532;
-  l533:;	  G->pos= yypos533; G->thunkpos= yythunkpos533;
-  }  goto l530;
+  {  int yypos530= G->pos, yythunkpos530= G->thunkpos;  if (!yymatchClassRun(G, (unsigned char *)"\377\331\377\377\376\377\377\377\377\377\377\377\376\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\273\377\377\377\377\377\377\377\377\376\376\377\377\376\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377")) goto l531;  goto l530;
   l531:;	  G->pos= yypos530; G->thunkpos= yythunkpos530;
   {  int yypos537= G->pos, yythunkpos537= G->thunkpos;  if (!yy_Ticks3(G)) { goto l537; }  goto l536;
   l537:;	  G->pos= yypos537; G->thunkpos= yythunkpos537;
-  }  if (!yymatchChar(G, '`')) goto l536;
-  l538:;	
-  {  int yypos539= G->pos, yythunkpos539= G->thunkpos;  if (!yymatchChar(G, '`')) goto l539;  goto l538;
-  l539:;	  G->pos= yypos539; G->thunkpos= yythunkpos539;
-  }  goto l530;
+  }  if (!yymatchChar(G, '`')) goto l536;  yymatchClassRun(G, (unsigned char *)"\000\000\000\000\000\000\000\000\000\000\000\000\001\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\100\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000");  goto l530;
   l536:;	  G->pos= yypos530; G->thunkpos= yythunkpos530;
   {  int yypos540= G->pos, yythunkpos540= G->thunkpos;  if (!yy_Sp(G)) { goto l540; }  if (!yy_Ticks3(G)) { goto l540; }  goto l527;
   l540:;	  G->pos= yypos540; G->thunkpos= yythunkpos540;
@@ -2924,25 +2856,11 @@ YY_RULE(int) yy_Code(GREG *G)
   l530:;	
   l528:;	
   {  int yypos529= G->pos, yythunkpos529= G->thunkpos;
-  {  int yypos544= G->pos, yythunkpos544= G->thunkpos;
-  {  int yypos548= G->pos, yythunkpos548= G->thunkpos;  if (!yymatchChar(G, '`')) goto l548;  goto l545;
-  l548:;	  G->pos= yypos548; G->thunkpos= yythunkpos548;
-  }  if (!yy_Nonspacechar(G)) { goto l545; }
-  l546:;	
-  {  int yypos547= G->pos, yythunkpos547= G->thunkpos;
-  {  int yypos549= G->pos, yythunkpos549= G->thunkpos;  if (!yymatchChar(G, '`')) goto l549;  goto l547;
-  l549:;	  G->pos= yypos549; G->thunkpos= yythunkpos549;
-  }  if (!yy_Nonspacechar(G)) { goto l547; }  goto l546;
-  l547:;	  G->pos= yypos547; G->thunkpos= yythunkpos547;
-  }  goto l544;
+  {  int yypos544= G->pos, yythunkpos544= G->thunkpos;  if (!yymatchClassRun(G, (unsigned char *)"\377\331\377\377\376\377\377\377\377\377\377\377\376\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\273\377\377\377\377\377\377\377\377\376\376\377\377\376\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377")) goto l545;  goto l544;
   l545:;	  G->pos= yypos544; G->thunkpos= yythunkpos544;
   {  int yypos551= G->pos, yythunkpos551= G->thunkpos;  if (!yy_Ticks3(G)) { goto l551; }  goto l550;
   l551:;	  G->pos= yypos551; G->thunkpos= yythunkpos551;
-  }  if (!yymatchChar(G, '`')) goto l550;
-  l552:;	
-  {  int yypos553= G->pos, yythunkpos553= G->thunkpos;  if (!yymatchChar(G, '`')) goto l553;  goto l552;
-  l553:;	  G->pos= yypos553; G->thunkpos= yythunkpos553;
-  }  goto l544;
+  }  if (!yymatchChar(G, '`')) goto l550;  yymatchClassRun(G, (unsigned char *)"\000\000\000\000\000\000\000\000\000\000\000\000\001\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\100\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000");  goto l544;
   l550:;	  G->pos= yypos544; G->thunkpos= yythunkpos544;
   {  int yypos554= G->pos, yythunkpos554= G->thunkpos;  if (!yy_Sp(G)) { goto l554; }  if (!yy_Ticks3(G)) { goto l554; }  goto l529;
   l554:;	  G->pos= yypos554; G->thunkpos= yythunkpos554;
@@ -2959,25 +2877,11 @@ YY_RULE(int) yy_Code(GREG *G)
   l529:;	  G->pos= yypos529; G->thunkpos= yythunkpos529;
   }  yyText(G, G->begin, G->end);  if (!(YY_END)) goto l527;  if (!yy_Sp(G)) { goto l527; }  if (!yy_Ticks3(G)) { goto l527; }  goto l464;
   l527:;	  G->pos= yypos464; G->thunkpos= yythunkpos464;  if (!yy_Ticks4(G)) { goto l558; }  if (!yy_Sp(G)) { goto l558; }  yyText(G, G->begin, G->end);  if (!(YY_BEGIN)) goto l558;
-  {  int yypos561= G->pos, yythunkpos561= G->thunkpos;
-  {  int yypos565= G->pos, yythunkpos565= G->thunkpos;  if (!yymatchChar(G, '`')) goto l565;  goto l562;
-  l565:;	  G->pos= yypos565; G->thunkpos= yythunkpos565;
-  }  if (!yy_Nonspacechar(G)) { goto l562; }
-  l563:;	
-  {  int yypos564= G->pos, yythunkpos564= G->thunkpos;
-  {  int yypos566= G->pos, yythunkpos566= G->thunkpos;  if (!yymatchChar(G, '`')) goto l566;  goto l564;
-  l566:;	  G->pos= yypos566; G->thunkpos= yythunkpos566;
-  }  if (!yy_Nonspacechar(G)) { goto l564; }  goto l563;
-  l564:;	  G->pos= yypos564; G->thunkpos= yythunkpos564;
-  }  goto l561;
+  {  int yypos561= G->pos, yythunkpos561= G->thunkpos;  if (!yymatchClassRun(G, (unsigned char *)"\377\331\377\377\376\377\377\377\377\377\377\377\376\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\273\377\377\377\377\377\377\377\377\376\376\377\377\376\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377")) goto l562;  goto l561;
   l562:;	  G->pos= yypos561; G->thunkpos= yythunkpos561;
   {  int yypos568= G->pos, yythunkpos568= G->thunkpos;  if (!yy_Ticks4(G)) { goto l568; }  goto l567;
   l568:;	  G->pos= yypos568; G->thunkpos= yythunkpos568;
-  }  if (!yymatchChar(G, '`')) goto l567;
-  l569:;	
-  {  int yypos570= G->pos, yythunkpos570= G->thunkpos;  if (!yymatchChar(G, '`')) goto l570;  goto l569;
-  l570:;	  G->pos= yypos570; G->thunkpos= yythunkpos570;
-  }  goto l561;
+  }  if (!yymatchChar(G, '`')) goto l567;  yymatchClassRun(G, (unsigned char *)"\000\000\000\000\000\000\000\000\000\000\000\000\001\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\100\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000");  goto l561;
   l567:;	  G->pos= yypos561; G->thunkpos= yythunkpos561;
   {  int yypos571= G->pos, yythunkpos571= G->thunkpos;  if (!yy_Sp(G)) { goto l571; }  if (!yy_Ticks4(G)) { goto l571; }  goto l558;
   l571:;	  G->pos= yypos571; G->thunkpos= yythunkpos571;
@@ -2993,25 +2897,11 @@ YY_RULE(int) yy_Code(GREG *G)
   l561:;	
   l559:;	
   {  int yypos560= G->pos, yythunkpos560= G->thunkpos;
-  {  int yypos575= G->pos, yythunkpos575= G->thunkpos;
-  {  int yypos579= G->pos, yythunkpos579= G->thunkpos;  if (!yymatchChar(G, '`')) goto l579;  goto l576;
-  l579:;	  G->pos= yypos579; G->thunkpos= yythunkpos579;
-  }  if (!yy_Nonspacechar(G)) { goto l576; }
-  l577:;	
-  {  int yypos578= G->pos, yythunkpos578= G->thunkpos;
-  {  int yypos580= G->pos, yythunkpos580= G->thunkpos;  if (!yymatchChar(G, '`')) goto l580;  goto l578;
-  l580:;	  G->pos= yypos580; G->thunkpos= yythunkpos580;
-  }  if (!yy_Nonspacechar(G)) { goto l578; }  goto l577;
-  l578:;	  G->pos= yypos578; G->thunkpos= yythunkpos578;
-  }  goto l575;
+  {  int yypos575= G->pos, yythunkpos575= G->thunkpos;  if (!yymatchClassRun(G, (unsigned char *)"\377\331\377\377\376\377\377\377\377\377\377\377\376\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\273\377\377\377\377\377\377\377\377\376\376\377\377\376\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377")) goto l576;  goto l575;
   l576:;	  G->pos= yypos575; G->thunkpos= yythunkpos575;
   {  int yypos582= G->pos, yythunkpos582= G->thunkpos;  if (!yy_Ticks4(G)) { goto l582; }  goto l581;
   l582:;	  G->pos= yypos582; G->thunkpos= yythunkpos582;
-  }  if (!yymatchChar(G, '`')) goto l581;
-  l583:;	
-  {  int yypos584= G->pos, yythunkpos584= G->thunkpos;  if (!yymatchChar(G, '`')) goto l584;  goto l583;
-  l584:;	  G->pos= yypos584; G->thunkpos= yythunkpos584;
-  }  goto l575;
+  }  if (!yymatchChar(G, '`')) goto l581;  yymatchClassRun(G, (unsigned char *)"\000\000\000\000\000\000\000\000\000\000\000\000\001\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\100\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000");  goto l575;
   l581:;	  G->pos= yypos575; G->thunkpos= yythunkpos575;
   {  int yypos585= G->pos, yythunkpos585= G->thunkpos;  if (!yy_Sp(G)) { goto l585; }  if (!yy_Ticks4(G)) { goto l585; }  goto l560;
   l585:;	  G->pos= yypos585; G->thunkpos= yythunkpos585;
@@ -3028,25 +2918,11 @@ YY_RULE(int) yy_Code(GREG *G)
   l560:;	  G->pos= yypos560; G->thunkpos= yythunkpos560;
   }  yyText(G, G->begin, G->end);  if (!(YY_END)) goto l558;  if (!yy_Sp(G)) { goto l558; }  if (!yy_Ticks4(G)) { goto l558; }  goto l464;
   l558:;	  G->pos= yypos464; G->thunkpos= yythunkpos464;  if (!yy_Ticks5(G)) { goto l463; }  if (!yy_Sp(G)) { goto l463; }  yyText(G, G->begin, G->end);  if (!(YY_BEGIN)) goto l463;
-  {  int yypos591= G->pos, yythunkpos591= G->thunkpos;
-  {  int yypos595= G->pos, yythunkpos595= G->thunkpos;  if (!yymatchChar(G, '`')) goto l595;  goto l592;
-  l595:;	  G->pos= yypos595; G->thunkpos= yythunkpos595;
-  }  if (!yy_Nonspacechar(G)) { goto l592; }
-  l593:;	
-  {  int yypos594= G->pos, yythunkpos594= G->thunkpos;
-  {  int yypos596= G->pos, yythunkpos596= G->thunkpos;  if (!yymatchChar(G, '`')) goto l596;  goto l594;
-  l596:;	  G->pos= yypos596; G->thunkpos= yythunkpos596;
-  }  if (!yy_Nonspacechar(G)) { goto l594; }  goto l593;
-  l594:;	  G->pos= yypos594; G->thunkpos= yythunkpos594;
-  }  goto l591;
+  {  int yypos591= G->pos, yythunkpos591= G->thunkpos;  if (!yymatchClassRun(G, (unsigned char *)"\377\331\377\377\376\377\377\377\377\377\377\377\376\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\273\377\377\377\377\377\377\377\377\376\376\377\377\376\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377")) goto l592;  goto l591;
   l592:;	  G->pos= yypos591; G->thunkpos= yythunkpos591;
   {  int yypos598= G->pos, yythunkpos598= G->thunkpos;  if (!yy_Ticks5(G)) { goto l598; }  goto l597;
   l598:;	  G->pos= yypos598; G->thunkpos= yythunkpos598;
-  }  if (!yymatchChar(G, '`')) goto l597;
-  l599:;	
-  {  int yypos600= G->pos, yythunkpos600= G->thunkpos;  if (!yymatchChar(G, '`')) goto l600;  goto l599;
-  l600:;	  G->pos= yypos600; G->thunkpos= yythunkpos600;
-  }  goto l591;
+  }  if (!yymatchChar(G, '`')) goto l597;  yymatchClassRun(G, (unsigned char *)"\000\000\000\000\000\000\000\000\000\000\000\000\001\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\100\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000");  goto l591;
   l597:;	  G->pos= yypos591; G->thunkpos= yythunkpos591;
   {  int yypos601= G->pos, yythunkpos601= G->thunkpos;  if (!yy_Sp(G)) { goto l601; }  if (!yy_Ticks5(G)) { goto l601; }  goto l463;
   l601:;	  G->pos= yypos601; G->thunkpos= yythunkpos601;
@@ -3062,25 +2938,11 @@ YY_RULE(int) yy_Code(GREG *G)
   l591:;	
   l589:;	
   {  int yypos590= G->pos, yythunkpos590= G->thunkpos;
-  {  int yypos605= G->pos, yythunkpos605= G->thunkpos;
-  {  int yypos609= G->pos, yythunkpos609= G->thunkpos;  if (!yymatchChar(G, '`')) goto l609;  goto l606;
-  l609:;	  G->pos= yypos609; G->thunkpos= yythunkpos609;
-  }  if (!yy_Nonspacechar(G)) { goto l606; }
-  l607:;	
-  {  int yypos608= G->pos, yythunkpos608= G->thunkpos;
-  {  int yypos610= G->pos, yythunkpos610= G->thunkpos;  if (!yymatchChar(G, '`')) goto l610;  goto l608;
-  l610:;	  G->pos= yypos610; G->thunkpos= yythunkpos610;
-  }  if (!yy_Nonspacechar(G)) { goto l608; }  goto l607;
-  l608:;	  G->pos= yypos608; G->thunkpos= yythunkpos608;
-  }  goto l605;
+  {  int yypos605= G->pos, yythunkpos605= G->thunkpos;  if (!yymatchClassRun(G, (unsigned char *)"\377\331\377\377\376\377\377\377\377\377\377\377\376\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\273\377\377\377\377\377\377\377\377\376\376\377\377\376\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377")) goto l606;  goto l605;
   l606:;	  G->pos= yypos605; G->thunkpos= yythunkpos605;
   {  int yypos612= G->pos, yythunkpos612= G->thunkpos;  if (!yy_Ticks5(G)) { goto l612; }  goto l611;
   l612:;	  G->pos= yypos612; G->thunkpos= yythunkpos612;
-  }  if (!yymatchChar(G, '`')) goto l611;
-  l613:;	
-  {  int yypos614= G->pos, yythunkpos614= G->thunkpos;  if (!yymatchChar(G, '`')) goto l614;  goto l613;
-  l614:;	  G->pos= yypos614; G->thunkpos= yythunkpos614;
-  }  goto l605;
+  }  if (!yymatchChar(G, '`')) goto l611;  yymatchClassRun(G, (unsigned char *)"\000\000\000\000\000\000\000\000\000\000\000\000\001\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\100\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000");  goto l605;
   l611:;	  G->pos= yypos605; G->thunkpos= yythunkpos605;
   {  int yypos615= G->pos, yythunkpos615= G->thunkpos;  if (!yy_Sp(G)) { goto l615; }  if (!yy_Ticks5(G)) { goto l615; }  goto l590;
   l615:;	  G->pos= yypos615; G->thunkpos= yythunkpos615;
@@ -3106,7 +2968,7 @@ YY_RULE(int) yy_Code(GREG *G)
 }
 YY_RULE(int) yy_InlineNote(GREG *G)
 {  int yypos0= G->pos, yythunkpos0= G->thunkpos;  yyDo(G, yyPush, 1, 0);
-  yyprintf((stderr, "%s\n", "InlineNote"));  yyText(G, G->begin, G->end);  if (!( extension(EXT_NOTES) )) goto l619;  if (!yymatchString(G, "^[")) goto l619;  if (!yy_StartList(G)) { goto l619; }  yyDo(G, yySet, -1, 0);
+  yyprintf((stderr, "%s\n", "InlineNote"));  yyText(G, G->begin, G->end);  if (!( extension(yydata, EXT_NOTES) )) goto l619;  if (!yymatchString(G, "^[")) goto l619;  if (!yy_StartList(G)) { goto l619; }  yyDo(G, yySet, -1, 0);
   {  int yypos622= G->pos, yythunkpos622= G->thunkpos;  if (!yymatchChar(G, ']')) goto l622;  goto l619;
   l622:;	  G->pos= yypos622; G->thunkpos= yythunkpos622;
   }  if (!yy_Inline(G)) { goto l619; }  yyDo(G, yy_1_InlineNote, G->begin, G->end);
@@ -3125,7 +2987,7 @@ YY_RULE(int) yy_InlineNote(GREG *G)
 }
 YY_RULE(int) yy_NoteReference(GREG *G)
 {  int yypos0= G->pos, yythunkpos0= G->thunkpos;  yyDo(G, yyPush, 1, 0);
-  yyprintf((stderr, "%s\n", "NoteReference"));  yyText(G, G->begin, G->end);  if (!( extension(EXT_NOTES) )) goto l624;  if (!yy_RawNoteReference(G)) { goto l624; }  yyDo(G, yySet, -1, 0);  yyDo(G, yy_1_NoteReference, G->begin, G->end);
+  yyprintf((stderr, "%s\n", "NoteReference"));  yyText(G, G->begin, G->end);  if (!( extension(yydata, EXT_NOTES) )) goto l624;  if (!yy_RawNoteReference(G)) { goto l624; }  yyDo(G, yySet, -1, 0);  yyDo(G, yy_1_NoteReference, G->begin, G->end);
   yyprintf((stderr, "  ok   %s @ %s\n", "NoteReference", G->buf+G->pos));  yyDo(G, yyPop, 1, 0);
   return 1;
   l624:;	  G->pos= yypos0; G->thunkpos= yythunkpos0;
@@ -3133,7 +2995,12 @@ YY_RULE(int) yy_NoteReference(GREG *G)
   return 0;
 }
 YY_RULE(int) yy_Link(GREG *G)
-{  int yypos0= G->pos, yythunkpos0= G->thunkpos;
+{
+#ifdef YY_MEMO
+  int yymemopos= G->pos, yymemothunkpos= G->thunkpos;
+  switch (yyMemoFetch(G, 163)) { case 0: return 0; case 1: return 1; }
+#endif
+  int yypos0= G->pos, yythunkpos0= G->thunkpos;
   yyprintf((stderr, "%s\n", "Link"));
   {  int yypos626= G->pos, yythunkpos626= G->thunkpos;  if (!yy_ExplicitLink(G)) { goto l627; }  goto l626;
   l627:;	  G->pos= yypos626; G->thunkpos= yythunkpos626;  if (!yy_ReferenceLink(G)) { goto l628; }  goto l626;
@@ -3141,9 +3008,15 @@ YY_RULE(int) yy_Link(GREG *G)
   }
   l626:;	
   yyprintf((stderr, "  ok   %s @ %s\n", "Link", G->buf+G->pos));
+#ifdef YY_MEMO
+  yyMemoStore(G, 163, yymemopos, yymemothunkpos, 1);
+#endif
   return 1;
   l625:;	  G->pos= yypos0; G->thunkpos= yythunkpos0;
   yyprintf((stderr, "  fail %s @ %s\n", "Link", G->buf+G->pos));
+#ifdef YY_MEMO
+  yyMemoStore(G, 163, yymemopos, yymemothunkpos, 0);
+#endif
   return 0;
 }
 YY_RULE(int) yy_Image(GREG *G)
@@ -3160,38 +3033,56 @@ YY_RULE(int) yy_Image(GREG *G)
   return 0;
 }
 YY_RULE(int) yy_Emph(GREG *G)
-{  int yypos0= G->pos, yythunkpos0= G->thunkpos;
+{
+#ifdef YY_MEMO
+  int yymemopos= G->pos, yymemothunkpos= G->thunkpos;
+  switch (yyMemoFetch(G, 161)) { case 0: return 0; case 1: return 1; }
+#endif
+  int yypos0= G->pos, yythunkpos0= G->thunkpos;
   yyprintf((stderr, "%s\n", "Emph"));
   {  int yypos633= G->pos, yythunkpos633= G->thunkpos;  if (!yy_EmphStar(G)) { goto l634; }  goto l633;
   l634:;	  G->pos= yypos633; G->thunkpos= yythunkpos633;  if (!yy_EmphUl(G)) { goto l632; }
   }
   l633:;	
   yyprintf((stderr, "  ok   %s @ %s\n", "Emph", G->buf+G->pos));
+#ifdef YY_MEMO
+  yyMemoStore(G, 161, yymemopos, yymemothunkpos, 1);
+#endif
   return 1;
   l632:;	  G->pos= yypos0; G->thunkpos= yythunkpos0;
   yyprintf((stderr, "  fail %s @ %s\n", "Emph", G->buf+G->pos));
+#ifdef YY_MEMO
+  yyMemoStore(G, 161, yymemopos, yymemothunkpos, 0);
+#endif
   return 0;
 }
 YY_RULE(int) yy_Strong(GREG *G)
-{  int yypos0= G->pos, yythunkpos0= G->thunkpos;
+{
+#ifdef YY_MEMO
+  int yymemopos= G->pos, yymemothunkpos= G->thunkpos;
+  switch (yyMemoFetch(G, 160)) { case 0: return 0; case 1: return 1; }
+#endif
+  int yypos0= G->pos, yythunkpos0= G->thunkpos;
   yyprintf((stderr, "%s\n", "Strong"));
   {  int yypos636= G->pos, yythunkpos636= G->thunkpos;  if (!yy_StrongStar(G)) { goto l637; }  goto l636;
   l637:;	  G->pos= yypos636; G->thunkpos= yythunkpos636;  if (!yy_StrongUl(G)) { goto l635; }
   }
   l636:;	
   yyprintf((stderr, "  ok   %s @ %s\n", "Strong", G->buf+G->pos));
+#ifdef YY_MEMO
+  yyMemoStore(G, 160, yymemopos, yymemothunkpos, 1);
+#endif
   return 1;
   l635:;	  G->pos= yypos0; G->thunkpos= yythunkpos0;
   yyprintf((stderr, "  fail %s @ %s\n", "Strong", G->buf+G->pos));
+#ifdef YY_MEMO
+  yyMemoStore(G, 160, yymemopos, yymemothunkpos, 0);
+#endif
   return 0;
 }
 YY_RULE(int) yy_Space(GREG *G)
 {  int yypos0= G->pos, yythunkpos0= G->thunkpos;
-  yyprintf((stderr, "%s\n", "Space"));  if (!yy_Spacechar(G)) { goto l638; }
-  l639:;	
-  {  int yypos640= G->pos, yythunkpos640= G->thunkpos;  if (!yy_Spacechar(G)) { goto l640; }  goto l639;
-  l640:;	  G->pos= yypos640; G->thunkpos= yythunkpos640;
-  }  yyDo(G, yy_1_Space, G->begin, G->end);
+  yyprintf((stderr, "%s\n", "Space"));  if (!yymatchClassRun(G, (unsigned char *)"\000\002\000\000\001\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\004\000\000\000\000\000\000\000\000\001\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000")) goto l638;  yyDo(G, yy_1_Space, G->begin, G->end);
   yyprintf((stderr, "  ok   %s @ %s\n", "Space", G->buf+G->pos));
   return 1;
   l638:;	  G->pos= yypos0; G->thunkpos= yythunkpos0;
@@ -3217,11 +3108,7 @@ YY_RULE(int) yy_Str(GREG *G)
   l645:;	
   {  int yypos646= G->pos, yythunkpos646= G->thunkpos;
   {  int yypos647= G->pos, yythunkpos647= G->thunkpos;  if (!yy_NormalChar(G)) { goto l648; }  goto l647;
-  l648:;	  G->pos= yypos647; G->thunkpos= yythunkpos647;  if (!yymatchChar(G, '_')) goto l646;
-  l649:;	
-  {  int yypos650= G->pos, yythunkpos650= G->thunkpos;  if (!yymatchChar(G, '_')) goto l650;  goto l649;
-  l650:;	  G->pos= yypos650; G->thunkpos= yythunkpos650;
-  }
+  l648:;	  G->pos= yypos647; G->thunkpos= yythunkpos647;  if (!yymatchClassRun(G, (unsigned char *)"\000\000\000\000\000\000\000\000\000\000\000\200\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\040\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000")) goto l646;
   {  int yypos651= G->pos, yythunkpos651= G->thunkpos;  if (!yy_Alphanumeric(G)) { goto l646; }  G->pos= yypos651; G->thunkpos= yythunkpos651;
   }
   }
@@ -5083,17 +4970,7 @@ YY_RULE(int) yy_HtmlAttribute(GREG *G)
   }  if (!yy_Spnl(G)) { goto l1232; }
   {  int yypos1239= G->pos, yythunkpos1239= G->thunkpos;  if (!yymatchChar(G, '=')) goto l1239;  if (!yy_Spnl(G)) { goto l1239; }
   {  int yypos1241= G->pos, yythunkpos1241= G->thunkpos;  if (!yy_Quoted(G)) { goto l1242; }  goto l1241;
-  l1242:;	  G->pos= yypos1241; G->thunkpos= yythunkpos1241;
-  {  int yypos1245= G->pos, yythunkpos1245= G->thunkpos;  if (!yymatchChar(G, '>')) goto l1245;  goto l1239;
-  l1245:;	  G->pos= yypos1245; G->thunkpos= yythunkpos1245;
-  }  if (!yy_Nonspacechar(G)) { goto l1239; }
-  l1243:;	
-  {  int yypos1244= G->pos, yythunkpos1244= G->thunkpos;
-  {  int yypos1246= G->pos, yythunkpos1246= G->thunkpos;  if (!yymatchChar(G, '>')) goto l1246;  goto l1244;
-  l1246:;	  G->pos= yypos1246; G->thunkpos= yythunkpos1246;
-  }  if (!yy_Nonspacechar(G)) { goto l1244; }  goto l1243;
-  l1244:;	  G->pos= yypos1244; G->thunkpos= yythunkpos1244;
-  }
+  l1242:;	  G->pos= yypos1241; G->thunkpos= yythunkpos1241;  if (!yymatchClassRun(G, (unsigned char *)"\377\331\377\377\376\377\377\277\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\373\377\377\377\377\377\377\377\377\376\376\377\377\376\367\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377")) goto l1239;
   }
   l1241:;	  goto l1240;
   l1239:;	  G->pos= yypos1239; G->thunkpos= yythunkpos1239;
@@ -5239,15 +5116,7 @@ YY_RULE(int) yy_ListItem(GREG *G)
 }
 YY_RULE(int) yy_Enumerator(GREG *G)
 {  int yypos0= G->pos, yythunkpos0= G->thunkpos;
-  yyprintf((stderr, "%s\n", "Enumerator"));  if (!yy_NonindentSpace(G)) { goto l1283; }  if (!yymatchClass(G, (unsigned char *)"\000\000\000\000\000\000\377\003\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000")) goto l1283;
-  l1284:;	
-  {  int yypos1285= G->pos, yythunkpos1285= G->thunkpos;  if (!yymatchClass(G, (unsigned char *)"\000\000\000\000\000\000\377\003\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000")) goto l1285;  goto l1284;
-  l1285:;	  G->pos= yypos1285; G->thunkpos= yythunkpos1285;
-  }  if (!yymatchChar(G, '.')) goto l1283;  if (!yy_Spacechar(G)) { goto l1283; }
-  l1286:;	
-  {  int yypos1287= G->pos, yythunkpos1287= G->thunkpos;  if (!yy_Spacechar(G)) { goto l1287; }  goto l1286;
-  l1287:;	  G->pos= yypos1287; G->thunkpos= yythunkpos1287;
-  }
+  yyprintf((stderr, "%s\n", "Enumerator"));  if (!yy_NonindentSpace(G)) { goto l1283; }  if (!yymatchClassRun(G, (unsigned char *)"\000\000\000\000\000\000\377\003\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\010\010\010\010\010\010\010\010\010\010\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000")) goto l1283;  if (!yymatchChar(G, '.')) goto l1283;  if (!yymatchClassRun(G, (unsigned char *)"\000\002\000\000\001\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\004\000\000\000\000\000\000\000\000\001\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000")) goto l1283;
   yyprintf((stderr, "  ok   %s @ %s\n", "Enumerator", G->buf+G->pos));
   return 1;
   l1283:;	  G->pos= yypos0; G->thunkpos= yythunkpos0;
@@ -5345,11 +5214,7 @@ YY_RULE(int) yy_Bullet(GREG *G)
   l1316:;	  G->pos= yypos1315; G->thunkpos= yythunkpos1315;  if (!yymatchChar(G, '*')) goto l1317;  goto l1315;
   l1317:;	  G->pos= yypos1315; G->thunkpos= yythunkpos1315;  if (!yymatchChar(G, '-')) goto l1313;
   }
-  l1315:;	  if (!yy_Spacechar(G)) { goto l1313; }
-  l1318:;	
-  {  int yypos1319= G->pos, yythunkpos1319= G->thunkpos;  if (!yy_Spacechar(G)) { goto l1319; }  goto l1318;
-  l1319:;	  G->pos= yypos1319; G->thunkpos= yythunkpos1319;
-  }
+  l1315:;	  if (!yymatchClassRun(G, (unsigned char *)"\000\002\000\000\001\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\004\000\000\000\000\000\000\000\000\001\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000")) goto l1313;
   yyprintf((stderr, "  ok   %s @ %s\n", "Bullet", G->buf+G->pos));
   return 1;
   l1313:;	  G->pos= yypos0; G->thunkpos= yythunkpos0;
@@ -5469,22 +5334,8 @@ YY_RULE(int) yy_Endline(GREG *G)
 YY_RULE(int) yy_RawLine(GREG *G)
 {  int yypos0= G->pos, yythunkpos0= G->thunkpos;
   yyprintf((stderr, "%s\n", "RawLine"));
-  {  int yypos1353= G->pos, yythunkpos1353= G->thunkpos;  yyText(G, G->begin, G->end);  if (!(YY_BEGIN)) goto l1354;
-  l1355:;	
-  {  int yypos1356= G->pos, yythunkpos1356= G->thunkpos;
-  {  int yypos1357= G->pos, yythunkpos1357= G->thunkpos;  if (!yymatchChar(G, '\r')) goto l1357;  goto l1356;
-  l1357:;	  G->pos= yypos1357; G->thunkpos= yythunkpos1357;
-  }
-  {  int yypos1358= G->pos, yythunkpos1358= G->thunkpos;  if (!yymatchChar(G, '\n')) goto l1358;  goto l1356;
-  l1358:;	  G->pos= yypos1358; G->thunkpos= yythunkpos1358;
-  }  if (!yymatchDot(G)) goto l1356;  goto l1355;
-  l1356:;	  G->pos= yypos1356; G->thunkpos= yythunkpos1356;
-  }  if (!yy_Newline(G)) { goto l1354; }  yyText(G, G->begin, G->end);  if (!(YY_END)) goto l1354;  goto l1353;
-  l1354:;	  G->pos= yypos1353; G->thunkpos= yythunkpos1353;  yyText(G, G->begin, G->end);  if (!(YY_BEGIN)) goto l1352;  if (!yymatchDot(G)) goto l1352;
-  l1359:;	
-  {  int yypos1360= G->pos, yythunkpos1360= G->thunkpos;  if (!yymatchDot(G)) goto l1360;  goto l1359;
-  l1360:;	  G->pos= yypos1360; G->thunkpos= yythunkpos1360;
-  }  yyText(G, G->begin, G->end);  if (!(YY_END)) goto l1352;  if (!yy_Eof(G)) { goto l1352; }
+  {  int yypos1353= G->pos, yythunkpos1353= G->thunkpos;  yyText(G, G->begin, G->end);  if (!(YY_BEGIN)) goto l1354;  yymatchClassRun(G, (unsigned char *)"\377\333\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\376\377\377\376\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377");  if (!yy_Newline(G)) { goto l1354; }  yyText(G, G->begin, G->end);  if (!(YY_END)) goto l1354;  goto l1353;
+  l1354:;	  G->pos= yypos1353; G->thunkpos= yythunkpos1353;  yyText(G, G->begin, G->end);  if (!(YY_BEGIN)) goto l1352;  if (!yymatchClassRun(G, (unsigned char *)"\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377")) goto l1352;  yyText(G, G->begin, G->end);  if (!(YY_END)) goto l1352;  if (!yy_Eof(G)) { goto l1352; }
   }
   l1353:;	
   yyprintf((stderr, "  ok   %s @ %s\n", "RawLine", G->buf+G->pos));
@@ -5495,11 +5346,7 @@ YY_RULE(int) yy_RawLine(GREG *G)
 }
 YY_RULE(int) yy_SetextBottom2(GREG *G)
 {  int yypos0= G->pos, yythunkpos0= G->thunkpos;
-  yyprintf((stderr, "%s\n", "SetextBottom2"));  if (!yymatchString(G, "---")) goto l1361;
-  l1362:;	
-  {  int yypos1363= G->pos, yythunkpos1363= G->thunkpos;  if (!yymatchChar(G, '-')) goto l1363;  goto l1362;
-  l1363:;	  G->pos= yypos1363; G->thunkpos= yythunkpos1363;
-  }  if (!yy_Newline(G)) { goto l1361; }
+  yyprintf((stderr, "%s\n", "SetextBottom2"));  if (!yymatchString(G, "---")) goto l1361;  yymatchClassRun(G, (unsigned char *)"\000\000\000\000\000\040\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\004\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000");  if (!yy_Newline(G)) { goto l1361; }
   yyprintf((stderr, "  ok   %s @ %s\n", "SetextBottom2", G->buf+G->pos));
   return 1;
   l1361:;	  G->pos= yypos0; G->thunkpos= yythunkpos0;
@@ -5508,11 +5355,7 @@ YY_RULE(int) yy_SetextBottom2(GREG *G)
 }
 YY_RULE(int) yy_SetextBottom1(GREG *G)
 {  int yypos0= G->pos, yythunkpos0= G->thunkpos;
-  yyprintf((stderr, "%s\n", "SetextBottom1"));  if (!yymatchString(G, "===")) goto l1364;
-  l1365:;	
-  {  int yypos1366= G->pos, yythunkpos1366= G->thunkpos;  if (!yymatchChar(G, '=')) goto l1366;  goto l1365;
-  l1366:;	  G->pos= yypos1366; G->thunkpos= yythunkpos1366;
-  }  if (!yy_Newline(G)) { goto l1364; }
+  yyprintf((stderr, "%s\n", "SetextBottom1"));  if (!yymatchString(G, "===")) goto l1364;  yymatchClassRun(G, (unsigned char *)"\000\000\000\000\000\000\000\040\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\010\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000");  if (!yy_Newline(G)) { goto l1364; }
   yyprintf((stderr, "  ok   %s @ %s\n", "SetextBottom1", G->buf+G->pos));
   return 1;
   l1364:;	  G->pos= yypos0; G->thunkpos= yythunkpos0;
@@ -5589,11 +5432,7 @@ YY_RULE(int) yy_AtxHeading(GREG *G)
   {  int yypos1389= G->pos, yythunkpos1389= G->thunkpos;  if (!yy_Sp(G)) { goto l1389; }  goto l1390;
   l1389:;	  G->pos= yypos1389; G->thunkpos= yythunkpos1389;
   }
-  l1390:;	
-  l1391:;	
-  {  int yypos1392= G->pos, yythunkpos1392= G->thunkpos;  if (!yymatchChar(G, '#')) goto l1392;  goto l1391;
-  l1392:;	  G->pos= yypos1392; G->thunkpos= yythunkpos1392;
-  }  if (!yy_Sp(G)) { goto l1387; }  goto l1388;
+  l1390:;	  yymatchClassRun(G, (unsigned char *)"\000\000\000\000\010\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\004\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000");  if (!yy_Sp(G)) { goto l1387; }  goto l1388;
   l1387:;	  G->pos= yypos1387; G->thunkpos= yythunkpos1387;
   }
   l1388:;	  if (!yy_Newline(G)) { goto l1382; }  yyDo(G, yy_2_AtxHeading, G->begin, G->end);
@@ -5621,7 +5460,12 @@ YY_RULE(int) yy_AtxStart(GREG *G)
   return 0;
 }
 YY_RULE(int) yy_Inline(GREG *G)
-{  int yypos0= G->pos, yythunkpos0= G->thunkpos;
+{
+#ifdef YY_MEMO
+  int yymemopos= G->pos, yymemothunkpos= G->thunkpos;
+  switch (yyMemoFetch(G, 22)) { case 0: return 0; case 1: return 1; }
+#endif
+  int yypos0= G->pos, yythunkpos0= G->thunkpos;
   yyprintf((stderr, "%s\n", "Inline"));
   {  int yypos1401= G->pos, yythunkpos1401= G->thunkpos;  if (!yy_Str(G)) { goto l1402; }  goto l1401;
   l1402:;	  G->pos= yypos1401; G->thunkpos= yythunkpos1401;  if (!yy_Endline(G)) { goto l1403; }  goto l1401;
@@ -5642,18 +5486,20 @@ YY_RULE(int) yy_Inline(GREG *G)
   }
   l1401:;	
   yyprintf((stderr, "  ok   %s @ %s\n", "Inline", G->buf+G->pos));
+#ifdef YY_MEMO
+  yyMemoStore(G, 22, yymemopos, yymemothunkpos, 1);
+#endif
   return 1;
   l1400:;	  G->pos= yypos0; G->thunkpos= yythunkpos0;
   yyprintf((stderr, "  fail %s @ %s\n", "Inline", G->buf+G->pos));
+#ifdef YY_MEMO
+  yyMemoStore(G, 22, yymemopos, yymemothunkpos, 0);
+#endif
   return 0;
 }
 YY_RULE(int) yy_Sp(GREG *G)
 {
-  yyprintf((stderr, "%s\n", "Sp"));
-  l1418:;	
-  {  int yypos1419= G->pos, yythunkpos1419= G->thunkpos;  if (!yy_Spacechar(G)) { goto l1419; }  goto l1418;
-  l1419:;	  G->pos= yypos1419; G->thunkpos= yythunkpos1419;
-  }
+  yyprintf((stderr, "%s\n", "Sp"));  yymatchClassRun(G, (unsigned char *)"\000\002\000\000\001\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\004\000\000\000\000\000\000\000\000\001\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000");
   yyprintf((stderr, "  ok   %s @ %s\n", "Sp", G->buf+G->pos));
   return 1;
 }
@@ -5684,11 +5530,7 @@ YY_RULE(int) yy_AtxInline(GREG *G)
   {  int yypos1428= G->pos, yythunkpos1428= G->thunkpos;  if (!yy_Sp(G)) { goto l1428; }  goto l1429;
   l1428:;	  G->pos= yypos1428; G->thunkpos= yythunkpos1428;
   }
-  l1429:;	
-  l1430:;	
-  {  int yypos1431= G->pos, yythunkpos1431= G->thunkpos;  if (!yymatchChar(G, '#')) goto l1431;  goto l1430;
-  l1431:;	  G->pos= yypos1431; G->thunkpos= yythunkpos1431;
-  }  if (!yy_Sp(G)) { goto l1427; }  if (!yy_Newline(G)) { goto l1427; }  goto l1425;
+  l1429:;	  yymatchClassRun(G, (unsigned char *)"\000\000\000\000\010\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\004\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000");  if (!yy_Sp(G)) { goto l1427; }  if (!yy_Newline(G)) { goto l1427; }  goto l1425;
   l1427:;	  G->pos= yypos1427; G->thunkpos= yythunkpos1427;
   }  if (!yy_Inline(G)) { goto l1425; }
   yyprintf((stderr, "  ok   %s @ %s\n", "AtxInline", G->buf+G->pos));
@@ -5891,7 +5733,7 @@ YY_RULE(int) yy_Reference(GREG *G)
 }
 YY_RULE(int) yy_Note(GREG *G)
 {  int yypos0= G->pos, yythunkpos0= G->thunkpos;  yyDo(G, yyPush, 2, 0);
-  yyprintf((stderr, "%s\n", "Note"));  yyText(G, G->begin, G->end);  if (!( extension(EXT_NOTES) )) goto l1490;  if (!yy_NonindentSpace(G)) { goto l1490; }  if (!yy_RawNoteReference(G)) { goto l1490; }  yyDo(G, yySet, -2, 0);  if (!yymatchChar(G, ':')) goto l1490;  if (!yy_Sp(G)) { goto l1490; }  if (!yy_StartList(G)) { goto l1490; }  yyDo(G, yySet, -1, 0);  if (!yy_RawNoteBlock(G)) { goto l1490; }  yyDo(G, yy_1_Note, G->begin, G->end);
+  yyprintf((stderr, "%s\n", "Note"));  yyText(G, G->begin, G->end);  if (!( extension(yydata, EXT_NOTES) )) goto l1490;  if (!yy_NonindentSpace(G)) { goto l1490; }  if (!yy_RawNoteReference(G)) { goto l1490; }  yyDo(G, yySet, -2, 0);  if (!yymatchChar(G, ':')) goto l1490;  if (!yy_Sp(G)) { goto l1490; }  if (!yy_StartList(G)) { goto l1490; }  yyDo(G, yySet, -1, 0);  if (!yy_RawNoteBlock(G)) { goto l1490; }  yyDo(G, yy_1_Note, G->begin, G->end);
   l1491:;	
   {  int yypos1492= G->pos, yythunkpos1492= G->thunkpos;
   {  int yypos1493= G->pos, yythunkpos1493= G->thunkpos;  if (!yy_Indent(G)) { goto l1492; }  G->pos= yypos1493; G->thunkpos= yythunkpos1493;
@@ -6019,6 +5861,7 @@ YY_PARSE(int) YY_NAME(parse_from)(GREG *G, yyrule yystart)
   (void)yymatchChar;
   (void)yymatchString;
   (void)yymatchClass;
+  (void)yymatchClassRun;
   (void)yyDo;
   (void)yyText;
   (void)yyDone;
@@ -6027,6 +5870,10 @@ YY_PARSE(int) YY_NAME(parse_from)(GREG *G, yyrule yystart)
   (void)yyPush;
   (void)yyPop;
   (void)yySet;
+#ifdef YY_MEMO
+  (void)yyMemoFetch;
+  (void)yyMemoStore;
+#endif
 }
 
 YY_PARSE(int) YY_NAME(parse)(GREG *G)
@@ -6044,6 +5891,10 @@ YY_PARSE(void) YY_NAME(deinit)(GREG *G)
     if (G->text) YY_FREE(G->text);
     if (G->thunks) YY_FREE(G->thunks);
     if (G->vals) YY_FREE(G->vals);
+#ifdef YY_MEMO
+    if (G->memos) YY_FREE(G->memos);
+    if (G->memothunks) YY_FREE(G->memothunks);
+#endif
 }
 YY_PARSE(GREG *) YY_NAME(parse_new)(YY_XTYPE data)
 {
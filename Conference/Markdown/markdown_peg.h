@@ -61,13 +61,34 @@ struct Element {
 
 typedef struct Element element;
 
-element * parse_references(NSString *string, int extensions);
-element * parse_notes(NSString *string, int extensions, element *reference_list);
-element * parse_markdown(NSString *string, int extensions, element *reference_list, element *note_list);
-void free_element_list(element * elt);
-void free_element(element *elt);
-void print_element_list(NSMutableString *out, element *elt, int format, int exts, NSDictionary* current);
-void print_element_list_attr(NSMutableAttributedString *out, element *elt, int exts, NSDictionary __unsafe_unretained *attributes[], NSDictionary *current);
+/* Owner of the elements, links and strings made while converting a document. */
+typedef struct Arena Arena;
+
+Arena * new_arena(void);
+void free_arena(Arena *arena);
+element * parse_references(Arena *arena, const char *string, NSUInteger length, int extensions);
+element * parse_notes(Arena *arena, const char *string, NSUInteger length, int extensions, element *reference_list);
+element * parse_markdown(Arena *arena, const char *string, NSUInteger length, int extensions, element *reference_list, element *note_list);
+element * parse_document(Arena *arena, const char *string, NSUInteger length, int extensions, element **reference_list, element **note_list);
+
+/* Growable UTF-8 buffer the text output formats are printed into.
+ * The bytes are always NUL-terminated and are released with free(). */
+typedef struct Buffer {
+    char        *bytes;
+    NSUInteger  length;
+    NSUInteger  capacity;
+} Buffer;
+
+void init_buffer(Buffer *buf, NSUInteger capacity);
+void print_element_list(Buffer *out, element *elt, int format, int exts);
+
+/* Interned text attributes for each nesting of elements, shared by every
+ * document printed with the same attribute set. */
+@class MarkdownStyle;
+
+MarkdownStyle * style_root(NSDictionary *attributes);
+void clear_style_roots(void);
+void print_element_list_attr(NSMutableAttributedString *out, element *elt, int exts, MarkdownStyle *root);
 
 
 /* vim:set ts=4 sw=4: */
@@ -1,114 +1,80 @@
 /* parsing_functions.c - Functions for parsing markdown and
- * freeing element lists. */
+ * managing the arenas that hold element lists. */
 
-void parse_from(yyrule yystart)
+/* parse_from - run the parser from rule 'yystart' over md's input.
+ * All parser state is carried in 'md', so calls do not interfere. */
+static void parse_from(struct Markdown *md, yyrule yystart)
 {
     GREG g;
     memset(&g, 0, sizeof(g));
-    yyparse_from(&g, yystart);    /* first pass, just to collect references */
+    g.data = md;
+    yyparse_from(&g, yystart);
     yydeinit(&g);
 }
 
-static void free_element_contents(element elt);
-
-/* free_element_list - free list of elements recursively */
-void free_element_list(element * elt) {
-    element * next = NULL;
-    while (elt != NULL) {
-        next = elt->next;
-        free_element_contents(*elt);
-        if (elt->children != NULL) {
-            free_element_list(elt->children);
-            elt->children = NULL;
-        }
-        free(elt);
-        elt = next;
-    }
+/* new_arena - make an empty arena to hold the elements of one conversion */
+Arena * new_arena(void) {
+    Arena *arena = malloc(sizeof(Arena));
+    arena->chunks = NULL;
+    arena->objects = [[NSMutableArray alloc] init];
+    return arena;
 }
 
-/* free_element_contents - free element contents depending on type */
-static void free_element_contents(element elt) {
-    switch (elt.key) {
-      case STRING:
-      case SPACE:
-      case RAW:
-      case HTMLBLOCK:
-      case HTML:
-      case VERBATIM:
-      case CODE:
-      case NOTE:
-        [elt.contents.str release];
-        elt.contents.str = nil;
-        break;
-      case LINK:
-      case IMAGE:
-      case REFERENCE:
-        [elt.contents.link->url release];
-        elt.contents.link->url = nil;
-        [elt.contents.link->title release];
-        elt.contents.link->title = nil;
-        free_element_list(elt.contents.link->label);
-        free(elt.contents.link);
-        elt.contents.link = NULL;
-        break;
-      default:
-        ;
+/* free_arena - free every element and link made in the arena, and
+ * release the objects they refer to */
+void free_arena(Arena *arena) {
+    struct ArenaChunk *chunk = arena->chunks;
+    while (chunk != NULL) {
+        struct ArenaChunk *next = chunk->next;
+        free(chunk);
+        chunk = next;
     }
+    [arena->objects release];
+    free(arena);
 }
 
-/* free_element - free element and contents */
-void free_element(element *elt) {
-    free_element_contents(*elt);
-    free(elt);
-}
-
-element * parse_references(NSString *string, int extensions) {
-    md.syntax_extensions = extensions;
+element * parse_references(Arena *arena, const char *string, NSUInteger length, int extensions) {
+    struct Markdown md = { { string, length, 0 }, NULL, NULL, NULL, extensions, arena, NULL };
 
-    struct Input saved = md.input;
-    md.input.charbuf  = string;
-    md.input.position = 0;
-  
-    parse_from(yy_References);           /* first pass, just to collect references */
-
-    md.input = saved;
+    parse_from(&md, yy_References);           /* first pass, just to collect references */
+    resolve_pending(&md);
 
     return md.references;
 }
 
-element * parse_notes(NSString *string, int extensions, element *reference_list) {
-    md.notes = NULL;
-    md.syntax_extensions = extensions;
-
-    if (extension(EXT_NOTES)) {
-        md.references = reference_list;
-
-        struct Input saved = md.input;
-        md.input.charbuf  = string;
-        md.input.position = 0;
+element * parse_notes(Arena *arena, const char *string, NSUInteger length, int extensions, element *reference_list) {
+    struct Markdown md = { { string, length, 0 }, reference_list, NULL, NULL, extensions, arena, NULL };
 
-        parse_from(yy_Notes);           /* second pass for notes */
-
-        md.input = saved;
+    if (extension(&md, EXT_NOTES)) {
+        parse_from(&md, yy_Notes);           /* second pass for notes */
+        resolve_pending(&md);
     }
 
     return md.notes;
 }
 
-element * parse_markdown(NSString *string, int extensions, element *reference_list, element *note_list) {
-    md.syntax_extensions = extensions;
-    md.references = reference_list;
-    md.notes = note_list;
-
-    struct Input saved = md.input;
-    md.input.charbuf  = string;
-    md.input.position = 0;
-  
-    parse_from(yy_Doc);
+element * parse_markdown(Arena *arena, const char *string, NSUInteger length, int extensions, element *reference_list, element *note_list) {
+    struct Markdown md = { { string, length, 0 }, reference_list, note_list, NULL, extensions, arena, NULL };
 
-    md.input = saved;
+    parse_from(&md, yy_Doc);
+    resolve_pending(&md);
 
     return md.parse_result;
 }
 
-/* vim:set ts=4 sw=4: */
+/* parse_document - parse a whole document in a single pass.  References
+ * and notes are blocks of the document itself, so the top level of the
+ * result serves as both lists, and links to them are resolved once the
+ * parse is done.  The lists are returned for use with parse_markdown. */
+element * parse_document(Arena *arena, const char *string, NSUInteger length, int extensions, element **reference_list, element **note_list) {
+    struct Markdown md = { { string, length, 0 }, NULL, NULL, NULL, extensions, arena, NULL };
+
+    parse_from(&md, yy_Doc);
+    md.references = md.parse_result;
+    md.notes = extension(&md, EXT_NOTES) ? md.parse_result : NULL;
+    resolve_pending(&md);
+
+    *reference_list = md.references;
+    *note_list = md.notes;
+    return md.parse_result;
+}
@@ -87,6 +87,29 @@ void Rule_setExpression(Node *node, Node *expression)
     start= node;
 }
 
+/* Rule_beMemo - mark a rule whose results should be memoized by position
+   when the generated parser is compiled with YY_MEMO defined. */
+Node *Rule_beMemo(Node *rule)
+{
+  assert(rule);
+  assert(Rule == rule->type);
+  rule->rule.flags |= RuleMemo;
+  return rule;
+}
+
+/* Rules_beMemo - mark each rule in a comma- or space-separated list of
+   names for memoization.  Call it after the grammar has been read and
+   before it is compiled; markdown_parser.m is generated with
+   "Inline,Label,Link,Emph,Strong".  A misspelt name shows up as a rule
+   used but not defined. */
+void Rules_beMemo(const char *names)
+{
+  char *copy= strdup(names), *name, *last;
+  for (name= strtok_r(copy, ", ", &last);  name;  name= strtok_r(0, ", ", &last))
+    Rule_beMemo(findRule(name));
+  free(copy);
+}
+
 Node *makeVariable(char *name)
 {
   Node *node;
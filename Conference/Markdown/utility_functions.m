@@ -27,29 +27,80 @@ static element *reverse(element *list) {
 }
 
 /* concat_string_list - concatenates string contents of list of STRING elements.
- * Frees STRING elements as they are added to the concatenation. */
+ * The elements themselves stay in the arena until it is freed. */
 static NSMutableString *concat_string_list(element *list) {
-    NSMutableString *result = [[[NSMutableString alloc] init] autorelease];
-    element *next;
+    NSMutableString *result = [[NSMutableString alloc] init];
     while (list != NULL) {
         assert(list->key == STRING);
         assert(list->contents.str != NULL);
         [result appendString:list->contents.str];
-        next = list->next;
-        free_element(list);
-        list = next;
+        list = list->next;
     }
     return result;
 }
 
 /**********************************************************************
 
-  Global variables used in parsing
+  Arena allocation.
+  Every element and link made while converting a document is carved
+  out of a chain of chunks that never move, so pointers stay valid as
+  lists are built. Objective-C objects referenced from elements are
+  retained by the arena. free_arena releases everything at once.
+
+ ***********************************************************************/
+
+#define ARENA_CHUNK_SIZE (16 * 1024)
+
+struct ArenaChunk {
+    struct ArenaChunk *next;
+    size_t used;
+    size_t size;
+    char data[];
+};
+
+struct Arena {
+    struct ArenaChunk *chunks;  /* Most recent chunk first. */
+    NSMutableArray *objects;    /* Objects owned by the arena. */
+};
+
+/* arena_alloc - return 'size' bytes from the arena, aligned for any element. */
+static void * arena_alloc(Arena *arena, size_t size) {
+    struct ArenaChunk *chunk = arena->chunks;
+    size = (size + 15) & ~(size_t) 15;
+    if (chunk == NULL || chunk->size - chunk->used < size) {
+        size_t chunk_size = size > ARENA_CHUNK_SIZE ? size : ARENA_CHUNK_SIZE;
+        chunk = malloc(sizeof(struct ArenaChunk) + chunk_size);
+        chunk->next = arena->chunks;
+        chunk->used = 0;
+        chunk->size = chunk_size;
+        arena->chunks = chunk;
+    }
+    void *result = chunk->data + chunk->used;
+    chunk->used += size;
+    return result;
+}
+
+/* arena_own - transfer ownership of a retained object to the arena. */
+static id arena_own(Arena *arena, id object) {
+    if (object != nil) {
+        [arena->objects addObject:object];
+        [object release];
+    }
+    return object;
+}
+
+/**********************************************************************
+
+  Parser state.
+  Everything a parse reads or writes lives in a struct Markdown that
+  is passed to the generated parser through its data slot (YY_XTYPE),
+  so independent documents may be parsed concurrently.
 
  ***********************************************************************/
 
 struct Input {
-    NSString *charbuf;     /* Buffer of characters to be parsed. */
+    const char *charbuf;   /* UTF-8 buffer of characters to be parsed. */
+    NSUInteger length;     /* Number of bytes in charbuf. */
     NSUInteger position;   /* Curent index into charbuf. */
 };
 
@@ -59,9 +110,20 @@ struct Markdown {
     element *notes;        /* List of footnotes found. */
     element *parse_result; /* Results of parse. */
     int syntax_extensions; /* Syntax extensions selected. */
+    Arena *arena;          /* Owner of all elements made by the parse. */
+    struct Pending *pending; /* Reference links and notes to resolve, most recent first. */
 };
 
-static struct Markdown md = { { nil, 0 }, NULL, NULL, NULL, 0 };
+/* A reference link or note reference whose target is looked up once the
+ * parse is over, so that references and notes need not be collected
+ * in a separate pass before the document is parsed. */
+struct Pending {
+    int key;               /* LINK or NOTE. */
+    element *elt;          /* Holds the fallback text until resolved. */
+    element *label;        /* Link text of a reference link. */
+    element *name;         /* Reference label or note name to look up. */
+    struct Pending *next;
+};
 
 /**********************************************************************
 
@@ -72,8 +134,8 @@ static struct Markdown md = { { nil, 0 }, NULL, NULL, NULL, 0 };
  ***********************************************************************/
 
 /* mk_element - generic constructor for element */
-static element * mk_element(int key) {
-    element *result = malloc(sizeof(element));
+static element * mk_element(struct Markdown *md, int key) {
+    element *result = arena_alloc(md->arena, sizeof(element));
     result->key = key;
     result->children = NULL;
     result->next = NULL;
@@ -82,49 +144,53 @@ static element * mk_element(int key) {
 }
 
 /* mk_str - constructor for STRING element */
-static element * mk_str(const char *string) {
+static element * mk_str(struct Markdown *md, const char *string) {
     element *result;
+    NSMutableString *str;
     assert(string != NULL);
-    result = mk_element(STRING);
-    result->contents.str = [[NSMutableString alloc] initWithCString:string encoding:NSASCIIStringEncoding];
+    result = mk_element(md, STRING);
+    str = [[NSMutableString alloc] initWithCString:string encoding:NSUTF8StringEncoding];
+    if (str == nil) /* not valid UTF-8, keep the bytes anyway */
+        str = [[NSMutableString alloc] initWithCString:string encoding:NSISOLatin1StringEncoding];
+    result->contents.str = arena_own(md->arena, str);
     return result;
 }
 
 /* mk_str_from_list - makes STRING element by concatenating a
  * reversed list of strings, adding optional extra newline */
-static element * mk_str_from_list(element *list, bool extra_newline) {
+static element * mk_str_from_list(struct Markdown *md, element *list, bool extra_newline) {
     element *result;
     NSMutableString *c = concat_string_list(reverse(list));
     if (extra_newline)
         [c appendString:@"\n"];
-    result = mk_element(STRING);
-    result->contents.str = [c retain];
+    result = mk_element(md, STRING);
+    result->contents.str = arena_own(md->arena, c);
     return result;
 }
 
 /* mk_list - makes new list with key 'key' and children the reverse of 'lst'.
  * This is designed to be used with cons to build lists in a parser action.
  * The reversing is necessary because cons adds to the head of a list. */
-static element * mk_list(int key, element *lst) {
+static element * mk_list(struct Markdown *md, int key, element *lst) {
     element *result;
-    result = mk_element(key);
+    result = mk_element(md, key);
     result->children = reverse(lst);
     return result;
 }
 
 /* mk_link - constructor for LINK element */
-static element * mk_link(element *label, NSString *url, NSString *title) {
+static element * mk_link(struct Markdown *md, element *label, NSString *url, NSString *title) {
     element *result;
-    result = mk_element(LINK);
-    result->contents.link = malloc(sizeof(Link));
+    result = mk_element(md, LINK);
+    result->contents.link = arena_alloc(md->arena, sizeof(Link));
     result->contents.link->label = label;
-    result->contents.link->url = [url retain];
-    result->contents.link->title = [title retain];
+    result->contents.link->url = arena_own(md->arena, [url retain]);
+    result->contents.link->title = arena_own(md->arena, [title retain]);
     return result;
 }
 /* extension = returns true if extension is selected */
-static bool extension(int ext) {
-    return (md.syntax_extensions & ext);
+static bool extension(struct Markdown *md, int ext) {
+    return (md->syntax_extensions & ext);
 }
 
 /* match_inlines - returns true if inline lists match (case-insensitive...) */
@@ -172,12 +238,12 @@ static bool match_inlines(element *l1, element *l2) {
 
 /* find_reference - return true if link found in references matching label.
  * 'link' is modified with the matching url and title. */
-static bool find_reference(Link *result, element *label) {
-    element *cur = md.references;  /* pointer to walk up list of references */
+static bool find_reference(struct Markdown *md, Link *result, element *label) {
+    element *cur = md->references;  /* pointer to walk up list of references */
     Link *curitem;
     while (cur != NULL) {
         curitem = cur->contents.link;
-        if (match_inlines(label, curitem->label)) {
+        if (cur->key == REFERENCE && match_inlines(label, curitem->label)) {
             *result = *curitem;
             return true;
         }
@@ -190,10 +256,10 @@ static bool find_reference(Link *result, element *label) {
 /* find_note - return true if note found in notes matching label.
    if found, 'result' is set to point to matched note. */
 
-static bool find_note(element **result, NSString *label) {
-   element *cur = md.notes;  /* pointer to walk up list of notes */
+static bool find_note(struct Markdown *md, element **result, NSString *label) {
+   element *cur = md->notes;  /* pointer to walk up list of notes */
    while (cur != NULL) {
-       if ([label isEqualToString:cur->contents.str] == NSOrderedSame) {
+       if (cur->key == NOTE && cur->contents.str != nil && [label isEqualToString:cur->contents.str]) {
            *result = cur;
            return true;
        }
@@ -203,28 +269,80 @@ static bool find_note(element **result, NSString *label) {
    return false;
 }
 
+/* defer - record that 'elt' is a reference link (LINK) or note reference
+ * (NOTE) to the target named by 'name'. 'elt' is printed as is if no
+ * target is found. */
+static void defer(struct Markdown *md, int key, element *elt, element *label, element *name) {
+    struct Pending *pending = arena_alloc(md->arena, sizeof(struct Pending));
+    pending->key = key;
+    pending->elt = elt;
+    pending->label = label;
+    pending->name = name;
+    pending->next = md->pending;
+    md->pending = pending;
+}
+
+/* resolve_pending - turn deferred reference links into links and deferred
+ * note references into notes, in the order they were parsed. */
+static void resolve_pending(struct Markdown *md) {
+    struct Pending *list = NULL;
+    while (md->pending != NULL) {
+        struct Pending *next = md->pending->next;
+        md->pending->next = list;
+        list = md->pending;
+        md->pending = next;
+    }
+    for (; list != NULL; list = list->next) {
+        element *elt = list->elt;
+        if (list->key == NOTE) {
+            element *match;
+            if (find_note(md, &match, list->name->contents.str)) {
+                assert(match->children != NULL);
+                elt->key = NOTE;
+                elt->contents.str = nil;
+                elt->children = match->children;
+            }
+        } else {
+            Link match;
+            if (find_reference(md, &match, list->name)) {
+                elt->key = LINK;
+                elt->contents.link = arena_alloc(md->arena, sizeof(Link));
+                *elt->contents.link = match;
+                elt->contents.link->label = list->label;
+                elt->children = NULL;
+            }
+        }
+    }
+}
+
 /**********************************************************************
 
   Definitions for leg parser generator.
   YY_INPUT is the function the parser calls to get new input.
-  We take all new input from (static) charbuf.
+  We copy as much of the parse's UTF-8 charbuf as the parser
+  buffer will hold on each call.
 
  ***********************************************************************/
 
 # define YYSTYPE element *
+# define YY_XTYPE struct Markdown *
+/* Memoize the inline rules (Inline, Label, Link, Emph, Strong) so that runs
+ * of unmatched '*', '_' or '[' cannot make the parse time exponential.
+ * greg emits the memo calls in those rules when they are passed to
+ * Rules_beMemo before the parser is generated. */
+# define YY_MEMO 1
 #ifdef __DEBUG__
 # define YY_DEBUG 1
 #endif
 
 #define YY_INPUT(buf, result, max_size, data)                         \
 {                                                                     \
-    NSInteger yyc;                                                    \
-    if (md.input.position < md.input.charbuf.length) {                \
-        yyc= [md.input.charbuf characterAtIndex:md.input.position++]; \
-    } else {                                                          \
-        yyc= EOF;                                                     \
-    }                                                                 \
-    result= (EOF == yyc) ? 0 : (*(buf) = yyc, 1);                     \
+    NSUInteger yyn= (data)->input.length - (data)->input.position;    \
+    if (yyn > (NSUInteger)(max_size))                                 \
+        yyn= (max_size);                                              \
+    memcpy((buf), (data)->input.charbuf + (data)->input.position, yyn); \
+    (data)->input.position += yyn;                                    \
+    result= (int)yyn;                                                 \
 }
 
 
@@ -0,0 +1,59 @@
+/**********************************************************************
+
+  markdown_timing.m - checks that inputs which backtrack badly in the
+  inline rules still render quickly. Built and run by "nuke markdown-timing";
+  it exits with a nonzero status if any input is too slow.
+
+ ***********************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <mach/mach_time.h>
+#import "markdown_lib.h"
+
+/* No input here should take more than this; without memoization of the
+ * inline rules, each of them takes time exponential in its length. */
+#define LIMIT_SECONDS 1.0
+
+static NSString *repeat(NSString *piece, NSUInteger count) {
+    return [@"" stringByPaddingToLength:[piece length] * count withString:piece startingAtIndex:0];
+}
+
+static double seconds_to_render(NSString *text) {
+    static mach_timebase_info_data_t timebase;
+    if (!timebase.denom)
+        mach_timebase_info(&timebase);
+    uint64_t start = mach_absolute_time();
+    @autoreleasepool {
+        markdown_to_nsstring(text, EXT_NONE, HTML_FORMAT);
+    }
+    uint64_t elapsed = mach_absolute_time() - start;
+    return (double) elapsed * timebase.numer / timebase.denom / 1e9;
+}
+
+int main(int argc, const char *argv[]) {
+    @autoreleasepool {
+        struct { const char *name; NSString *text; } inputs[] = {
+            { "unclosed '*' nesting", repeat(@"*a ", 2000) },
+            { "unclosed '**' nesting", repeat(@"**a ", 2000) },
+            { "unclosed '_' nesting", repeat(@"_a ", 2000) },
+            { "alternating '*' and '_'", repeat(@"*_", 2000) },
+            { "run of '['", repeat(@"[", 5000) },
+            { "run of unclosed labels", repeat(@"[a", 5000) },
+            { "labels without targets", repeat(@"[a](", 2000) },
+            { "emphasis inside unclosed labels", repeat(@"[*a ", 2000) },
+        };
+        int failures = 0;
+        for (size_t i = 0; i < sizeof(inputs) / sizeof(inputs[0]); i++) {
+            double seconds = seconds_to_render(inputs[i].text);
+            BOOL ok = seconds < LIMIT_SECONDS;
+            printf("%-32s %8.3fs%s\n", inputs[i].name, seconds, ok ? "" : "  TOO SLOW");
+            if (!ok)
+                failures++;
+        }
+        return failures ? 1 : 0;
+    }
+}
+
+/* vim: set ts=4 sw=4 : */